@@ -4,7 +4,7 @@
 #include <uuid/modbus.h>
 
 static uuid::log::PrintHandler log_handler{Serial};
-static uuid::modbus::SerialClient client{Serial1};
+static uuid::modbus::SerialClient client{Serial1, 19200, uuid::modbus::SerialParity::EVEN, 1};
 
 void setup() {
 	Serial.begin(115200);
@@ -14,7 +14,7 @@ void setup() {
 
 void loop() {
 	static uuid::log::Logger logger{F("example")};
-	static std::shared_ptr<const uuid::modbus::RegisterDataResponse> response;
+	static uuid::modbus::ResponseHandle<const uuid::modbus::RegisterDataResponse> response;
 	static uint16_t address = 0x00A0;
 
 	uuid::loop();
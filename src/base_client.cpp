@@ -0,0 +1,214 @@
+/*
+ * uuid-modbus - Microcontroller asynchronous Modbus library
+ * Copyright 2021-2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <uuid/modbus.h>
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+
+#include <uuid/log.h>
+
+namespace uuid {
+
+namespace modbus {
+
+void BaseClient::finish(size_t index) {
+	// Remove the request before calling the callback so that it can queue
+	// another request
+	auto &request = requests_[index];
+	ResponseHandle<Response> completed{&request.response()};
+	auto callback = request.callback();
+	uint8_t function_code = request.function_code();
+
+	request.complete();
+	requests_.erase(index);
+	callback(*completed);
+
+	if (attachable(function_code)) {
+		static_cast<RegisterDataResponse&>(*completed).complete_attached();
+	}
+}
+
+bool BaseClient::abandoned(const Request &request) const {
+	// Writes must still be transmitted even if nothing is waiting for them
+	switch (request.function_code()) {
+	case FunctionCode::READ_COILS:
+	case FunctionCode::READ_DISCRETE_INPUTS:
+	case FunctionCode::READ_HOLDING_REGISTERS:
+	case FunctionCode::READ_INPUT_REGISTERS:
+	case FunctionCode::READ_EXCEPTION_STATUS:
+		break;
+
+	default:
+		return false;
+	}
+
+	if (request.response_referenced() || request.callback()) {
+		return false;
+	}
+
+	if (attachable(request.function_code())) {
+		return !static_cast<const RegisterDataResponse&>(request.response()).attached_;
+	}
+
+	return true;
+}
+
+void BaseClient::expire() {
+	const uint32_t now_ms = ::millis();
+	size_t i = 0;
+
+	// Completing a request calls its callback, which could change the queue,
+	// so start again from the front after each one
+	while (i < requests_.size()) {
+		auto &request = requests_[i];
+		auto &response = request.response();
+
+		if (response.status() == ResponseStatus::QUEUED) {
+			uint32_t timeout_ms = requests_.timeout_ms(i);
+
+			if (timeout_ms != 0 && now_ms - requests_.queued_ms(i) >= timeout_ms) {
+				logger.notice(F("Request for function %02X to device %u expired in queue"),
+					request.function_code(), request.device());
+				response.status(ResponseStatus::FAILURE_EXPIRED);
+				finish(i);
+				i = 0;
+				continue;
+			} else if (abandoned(request)) {
+				response.status(ResponseStatus::FAILURE_CANCELLED);
+				finish(i);
+				i = 0;
+				continue;
+			} else if (device_unavailable(request.device())) {
+				response.status(ResponseStatus::FAILURE_UNAVAILABLE);
+				finish(i);
+				i = 0;
+				continue;
+			}
+		}
+
+		i++;
+	}
+}
+
+bool BaseClient::cancel(const Response &response) {
+	for (size_t i = 0; i < requests_.size(); i++) {
+		if (&requests_[i].response() == &response) {
+			if (response.status() != ResponseStatus::QUEUED) {
+				return false;
+			}
+
+			requests_[i].response().status(ResponseStatus::FAILURE_CANCELLED);
+			finish(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool BaseClient::queue_timeout_ms(const Response &response, uint32_t timeout_ms) {
+	for (size_t i = 0; i < requests_.size(); i++) {
+		if (&requests_[i].response() == &response) {
+			if (response.status() != ResponseStatus::QUEUED) {
+				return false;
+			}
+
+			requests_.timeout_ms(i, timeout_ms);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32_t BaseClient::next_expiry_us() const {
+	const uint32_t now_ms = ::millis();
+	uint32_t next_us = WAIT_FOR_INPUT;
+
+	for (size_t i = 0; i < requests_.size(); i++) {
+		uint32_t timeout_ms = requests_.timeout_ms(i);
+
+		if (timeout_ms == 0
+				|| requests_[i].response().status() != ResponseStatus::QUEUED) {
+			continue;
+		}
+
+		uint32_t elapsed_ms = now_ms - requests_.queued_ms(i);
+		uint64_t expiry_us = elapsed_ms >= timeout_ms
+			? 0 : (timeout_ms - elapsed_ms) * 1000ULL;
+
+		next_us = std::min<uint64_t>(next_us, expiry_us);
+	}
+
+	return next_us;
+}
+
+void BaseClient::parse_response(Request &request, frame_buffer_t &frame, uint16_t len, uint32_t rtt_us) {
+	auto &response = request.response();
+
+	if (request.device() == DeviceAddressType::BROADCAST) {
+		response.status(ResponseStatus::FAILURE_UNEXPECTED);
+		logger.err(F("Received unexpected broadcast response with function code %02X from device %u"),
+			frame[1], frame[0]);
+		return;
+	}
+
+	if (frame[0] != request.device()) {
+		response.status(ResponseStatus::FAILURE_ADDRESS);
+		logger.err(F("Received function %02X from device %u, expected device %u"),
+			frame[1], frame[0], request.device());
+		return;
+	}
+
+	if ((frame[1] & ~0x80) != request.function_code()) {
+		response.status(ResponseStatus::FAILURE_FUNCTION);
+		logger.err(F("Received function %02X from device %u, expected function %02X"),
+			frame[1], frame[0], request.function_code());
+		return;
+	}
+
+	if (static_cast<int32_t>(rtt_us) >= 0) {
+		update_round_trip_time(request.device(), rtt_us);
+	}
+
+	device_response(request.device());
+
+	if (frame[1] & 0x80) {
+		if (len < 3) {
+			response.status(ResponseStatus::FAILURE_LENGTH);
+			logger.err(F("Exception with no code for function %02X from device %u"),
+				frame[1] & ~0x80, frame[0]);
+		} else {
+			response.status(ResponseStatus::EXCEPTION);
+			response.exception_code(frame[2]);
+			logger.notice(F("Exception code %02X for function %02X from device %u"),
+				response.exception_code(), frame[1] & ~0x80, frame[0]);
+		}
+		return;
+	}
+
+	response.status(response.parse(frame, len));
+}
+
+} // namespace modbus
+
+} // namespace uuid
@@ -0,0 +1,269 @@
+/*
+ * uuid-modbus - Microcontroller asynchronous Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <uuid/modbus.h>
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+
+namespace uuid {
+
+namespace modbus {
+
+ResponseHandle<const BitDataResponse> BaseClient::read_coils(
+		uint16_t device, uint16_t address, uint16_t size, uint16_t timeout_ms,
+		RequestPriority priority) {
+	return read_coils(device, address, size, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const BitDataResponse> BaseClient::read_coils(
+		uint16_t device, uint16_t address, uint16_t size,
+		const ResponseCallback<BitDataResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	auto response = ResponsePool::make<BitDataResponse>();
+
+	if (response->done()) {
+		callback(*response);
+		return response;
+	}
+
+	if (device < DeviceAddressType::MIN_UNICAST
+			|| device > DeviceAddressType::MAX_UNICAST
+			|| size < 1 || size > MAX_READ_BITS) {
+		response->status(ResponseStatus::FAILURE_INVALID);
+	} else {
+		if (timeout_ms == 0) {
+			timeout_ms = unicast_timeout_ms(device);
+		}
+
+		response->quantity_ = size;
+
+		if (!requests_.emplace<RegisterRequest>(priority, device,
+				FunctionCode::READ_COILS, timeout_ms, address, size,
+				response, callback)) {
+			response->status(ResponseStatus::FAILURE_QUEUE_FULL);
+		}
+	}
+
+	if (response->done()) {
+		callback(*response);
+	}
+
+	return response;
+}
+
+ResponseHandle<const BitDataResponse> BaseClient::read_discrete_inputs(
+		uint16_t device, uint16_t address, uint16_t size, uint16_t timeout_ms,
+		RequestPriority priority) {
+	return read_discrete_inputs(device, address, size, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const BitDataResponse> BaseClient::read_discrete_inputs(
+		uint16_t device, uint16_t address, uint16_t size,
+		const ResponseCallback<BitDataResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	auto response = ResponsePool::make<BitDataResponse>();
+
+	if (response->done()) {
+		callback(*response);
+		return response;
+	}
+
+	if (device < DeviceAddressType::MIN_UNICAST
+			|| device > DeviceAddressType::MAX_UNICAST
+			|| size < 1 || size > MAX_READ_BITS) {
+		response->status(ResponseStatus::FAILURE_INVALID);
+	} else {
+		if (timeout_ms == 0) {
+			timeout_ms = unicast_timeout_ms(device);
+		}
+
+		response->quantity_ = size;
+
+		if (!requests_.emplace<RegisterRequest>(priority, device,
+				FunctionCode::READ_DISCRETE_INPUTS, timeout_ms, address, size,
+				response, callback)) {
+			response->status(ResponseStatus::FAILURE_QUEUE_FULL);
+		}
+	}
+
+	if (response->done()) {
+		callback(*response);
+	}
+
+	return response;
+}
+
+ResponseHandle<const RegisterWriteResponse> BaseClient::write_coil(
+		uint16_t device, uint16_t address, bool value, uint16_t timeout_ms,
+		RequestPriority priority) {
+	return write_coil(device, address, value, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterWriteResponse> BaseClient::write_coil(
+		uint16_t device, uint16_t address, bool value,
+		const ResponseCallback<RegisterWriteResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	auto response = ResponsePool::make<RegisterWriteResponse>();
+
+	if (response->done()) {
+		callback(*response);
+		return response;
+	}
+
+	if (device > DeviceAddressType::MAX_UNICAST) {
+		response->status(ResponseStatus::FAILURE_INVALID);
+	} else {
+		if (timeout_ms == 0) {
+			if (device == DeviceAddressType::BROADCAST) {
+				timeout_ms = default_broadcast_timeout_ms_;
+			} else {
+				timeout_ms = unicast_timeout_ms(device);
+			}
+		}
+
+		if (!requests_.emplace<RegisterRequest>(priority, device,
+				FunctionCode::WRITE_SINGLE_COIL, timeout_ms, address,
+				value ? 0xFF00 : 0x0000, response, callback)) {
+			response->status(ResponseStatus::FAILURE_QUEUE_FULL);
+		}
+	}
+
+	if (response->done()) {
+		callback(*response);
+	}
+
+	return response;
+}
+
+ResponseHandle<const RegisterWriteResponse> BaseClient::write_coils(
+		uint16_t device, uint16_t address, const uint8_t *values, uint16_t size,
+		uint16_t timeout_ms, RequestPriority priority) {
+	return write_coils(device, address, values, size, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterWriteResponse> BaseClient::write_coils(
+		uint16_t device, uint16_t address, const uint8_t *values, uint16_t size,
+		const ResponseCallback<RegisterWriteResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	auto response = ResponsePool::make<RegisterWriteResponse>();
+
+	if (response->done()) {
+		callback(*response);
+		return response;
+	}
+
+	if (device > DeviceAddressType::MAX_UNICAST
+			|| values == nullptr || size < 1 || size > MAX_WRITE_BITS) {
+		response->status(ResponseStatus::FAILURE_INVALID);
+	} else {
+		if (timeout_ms == 0) {
+			if (device == DeviceAddressType::BROADCAST) {
+				timeout_ms = default_broadcast_timeout_ms_;
+			} else {
+				timeout_ms = unicast_timeout_ms(device);
+			}
+		}
+
+		if (!requests_.emplace<BitValuesRequest>(priority, device,
+				FunctionCode::WRITE_MULTIPLE_COILS, timeout_ms, address,
+				values, size, response, callback)) {
+			response->status(ResponseStatus::FAILURE_QUEUE_FULL);
+		}
+	}
+
+	if (response->done()) {
+		callback(*response);
+	}
+
+	return response;
+}
+
+BitValuesRequest::BitValuesRequest(uint16_t device, uint8_t function_code,
+		uint16_t timeout_ms, uint16_t address, const uint8_t *values,
+		uint16_t size, const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback)
+		: RegisterRequest(device, function_code, timeout_ms, address, size,
+			response, callback), values_(values) {
+}
+
+uint16_t BitValuesRequest::encode(frame_buffer_t &frame) {
+	uint16_t len = RegisterRequest::encode(frame);
+	uint8_t bytes = (data() + 7) / 8;
+
+	frame[len++] = bytes;
+	std::copy(values_, values_ + bytes, &frame[len]);
+	len += bytes;
+
+	if (data() % 8) {
+		// Unused bits in the last byte must be zero
+		frame[len - 1] &= (1 << (data() % 8)) - 1;
+	}
+
+	return len;
+}
+
+bool BitData::assign(const uint8_t *data, size_t len, uint16_t bits) {
+	if (len > CAPACITY || bits > len * 8) {
+		return false;
+	}
+
+	std::copy(data, data + len, values_.begin());
+	size_ = len;
+	bits_ = bits;
+	return true;
+}
+
+ResponseStatus BitDataResponse::parse(frame_buffer_t &frame, uint16_t len) {
+	if (len < 3) {
+		logger.err(F("Incomplete message for function %02X from device %u, expected 3+ received %u"),
+			frame[1], frame[0], len);
+		return ResponseStatus::FAILURE_LENGTH;
+	} else if (!check_length(frame, len, 3 + frame[2])) {
+		return ResponseStatus::FAILURE_LENGTH;
+	}
+
+	if (frame[2] > BitData::CAPACITY) {
+		logger.err(F("Invalid message for function %02X from device %u, byte count %u is too large"),
+			frame[1], frame[0], frame[2]);
+		return ResponseStatus::FAILURE_LENGTH;
+	}
+
+	if (!data_.assign(&frame[3], frame[2], quantity_)) {
+		logger.err(F("Invalid message for function %02X from device %u, byte count %u is too small for %u values"),
+			frame[1], frame[0], frame[2], quantity_);
+		return ResponseStatus::FAILURE_LENGTH;
+	}
+
+	return ResponseStatus::SUCCESS;
+}
+
+uint16_t BitDataResponse::expected_length(const frame_buffer_t &frame, uint16_t len) const {
+	if (len < 3) {
+		return 0;
+	}
+
+	return 3 + frame[2];
+}
+
+} // namespace modbus
+
+} // namespace uuid
@@ -0,0 +1,91 @@
+/*
+ * uuid-modbus - Microcontroller asynchronous Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <uuid/modbus.h>
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if UUID_MODBUS_CRC_TABLE_SIZE != 256 && UUID_MODBUS_CRC_TABLE_SIZE != 16
+# error "UUID_MODBUS_CRC_TABLE_SIZE must be 256 or 16"
+#endif
+
+namespace uuid {
+
+namespace modbus {
+
+//! @cond false
+template<uint16_t... I>
+struct CRCTableIndices {};
+
+template<uint16_t N, uint16_t... I>
+struct MakeCRCTableIndices : MakeCRCTableIndices<N - 1, N - 1, I...> {};
+
+template<uint16_t... I>
+struct MakeCRCTableIndices<0, I...> {
+	using type = CRCTableIndices<I...>;
+};
+
+static constexpr uint16_t crc_shift(uint16_t crc, uint8_t bits) {
+	return bits == 0 ? crc : crc_shift((crc & 0x0001)
+		? ((crc >> 1) ^ CRC16::POLYNOMIAL) : (crc >> 1), bits - 1);
+}
+
+template<uint16_t... I>
+static constexpr std::array<uint16_t, sizeof...(I)> crc_table(uint8_t bits,
+		CRCTableIndices<I...>) {
+	return {{ crc_shift(I, bits)... }};
+}
+
+#if UUID_MODBUS_CRC_TABLE_SIZE == 256
+static constexpr std::array<uint16_t, 256> CRC_TABLE PROGMEM
+	= crc_table(8, MakeCRCTableIndices<256>::type{});
+#else
+static constexpr std::array<uint16_t, 16> CRC_TABLE PROGMEM
+	= crc_table(4, MakeCRCTableIndices<16>::type{});
+#endif
+//! @endcond
+
+uint16_t CRC16::calculate(const uint8_t *data, size_t len) {
+	CRC16 crc;
+
+	crc.update(data, len);
+	return crc.value();
+}
+
+void CRC16::update(uint8_t data) {
+#if UUID_MODBUS_CRC_TABLE_SIZE == 256
+	value_ = (value_ >> 8) ^ pgm_read_word(&CRC_TABLE[(value_ ^ data) & 0xFF]);
+#else
+	value_ = (value_ >> 4) ^ pgm_read_word(&CRC_TABLE[(value_ ^ data) & 0x0F]);
+	value_ = (value_ >> 4) ^ pgm_read_word(&CRC_TABLE[(value_ ^ (data >> 4)) & 0x0F]);
+#endif
+}
+
+void CRC16::update(const uint8_t *data, size_t len) {
+	while (len-- > 0) {
+		update(*data++);
+	}
+}
+
+} // namespace modbus
+
+} // namespace uuid
@@ -0,0 +1,263 @@
+/*
+ * uuid-modbus - Microcontroller asynchronous Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <uuid/modbus.h>
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstdint>
+
+#include <uuid/log.h>
+
+namespace uuid {
+
+namespace modbus {
+
+void BaseClient::adaptive_timeout_ms(uint16_t min_timeout_ms, uint16_t max_timeout_ms) {
+	min_adaptive_timeout_ms_ = std::min(min_timeout_ms, max_timeout_ms);
+	max_adaptive_timeout_ms_ = max_timeout_ms;
+}
+
+uint32_t BaseClient::round_trip_time_us(uint16_t device) const {
+	auto *state = find_device(device);
+
+	return state ? state->srtt_us : 0;
+}
+
+void BaseClient::circuit_breaker(uint8_t threshold, uint32_t min_retry_ms, uint32_t max_retry_ms) {
+	circuit_breaker_threshold_ = threshold;
+	min_circuit_retry_ms_ = std::min(min_retry_ms, max_retry_ms);
+	max_circuit_retry_ms_ = max_retry_ms;
+}
+
+CircuitState BaseClient::circuit_state(uint16_t device) const {
+	auto *state = find_device(device);
+
+	return state ? state->circuit : CircuitState::CLOSED;
+}
+
+uint8_t BaseClient::consecutive_timeouts(uint16_t device) const {
+	auto *state = find_device(device);
+
+	return state ? state->timeouts : 0;
+}
+
+const BaseClient::DeviceState* BaseClient::find_device(uint16_t device) const {
+	if (device == DeviceAddressType::BROADCAST) {
+		return nullptr;
+	}
+
+	for (auto &state : devices_) {
+		if (state.device == device) {
+			return &state;
+		}
+	}
+
+	return nullptr;
+}
+
+BaseClient::DeviceState& BaseClient::device_state(uint16_t device) {
+	const uint32_t now_ms = ::millis();
+	DeviceState *oldest = &devices_[0];
+
+	for (auto &state : devices_) {
+		if (state.device == device) {
+			state.used_ms = now_ms;
+			return state;
+		}
+
+		if (state.device == DeviceAddressType::BROADCAST) {
+			if (oldest->device != DeviceAddressType::BROADCAST) {
+				oldest = &state;
+			}
+		} else if (oldest->device != DeviceAddressType::BROADCAST
+				&& now_ms - state.used_ms > now_ms - oldest->used_ms) {
+			oldest = &state;
+		}
+	}
+
+	*oldest = DeviceState{};
+	oldest->device = device;
+	oldest->used_ms = now_ms;
+	return *oldest;
+}
+
+uint16_t BaseClient::unicast_timeout_ms(uint16_t device) const {
+	auto *state = find_device(device);
+
+	if (max_adaptive_timeout_ms_ == 0 || state == nullptr || state->srtt_us == 0) {
+		return default_unicast_timeout_ms_;
+	}
+
+	uint64_t timeout_us = state->srtt_us + std::max(4 * state->rttvar_us, min_timeout_margin_us_);
+	timeout_us <<= state->backoff;
+
+	uint64_t timeout_ms = (timeout_us + 999) / 1000;
+
+	return std::max<uint64_t>(min_adaptive_timeout_ms_,
+		std::min<uint64_t>(timeout_ms, max_adaptive_timeout_ms_));
+}
+
+void BaseClient::update_round_trip_time(uint16_t device, uint32_t rtt_us) {
+	auto &state = device_state(device);
+
+	// Round-trip time estimation from RFC 6298 (with a minimum of 1µs so that
+	// an estimate of 0 means that there isn't one)
+	rtt_us = std::max(rtt_us, UINT32_C(1));
+
+	if (state.srtt_us == 0) {
+		state.srtt_us = rtt_us;
+		state.rttvar_us = rtt_us / 2;
+	} else {
+		uint32_t error_us = state.srtt_us > rtt_us ? state.srtt_us - rtt_us : rtt_us - state.srtt_us;
+
+		state.rttvar_us = state.rttvar_us - state.rttvar_us / 4 + error_us / 4;
+		state.srtt_us = std::max(state.srtt_us - state.srtt_us / 8 + rtt_us / 8, UINT32_C(1));
+	}
+
+	state.backoff = 0;
+}
+
+void BaseClient::device_timeout(uint16_t device) {
+	DeviceState *state;
+
+	if (circuit_breaker_threshold_ == 0) {
+		// Devices without a round-trip time estimate use the default timeout
+		// so there's no need to replace the state of another device
+		state = const_cast<DeviceState*>(find_device(device));
+
+		if (state == nullptr) {
+			return;
+		}
+	} else {
+		state = &device_state(device);
+	}
+
+	if (state->backoff < MAX_TIMEOUT_BACKOFF) {
+		state->backoff++;
+		state->used_ms = ::millis();
+	}
+
+	if (circuit_breaker_threshold_ == 0) {
+		return;
+	}
+
+	if (state->timeouts < UINT8_MAX) {
+		state->timeouts++;
+	}
+
+	// Failed retries are handled by device_retry_failed()
+	if (state->circuit == CircuitState::CLOSED
+			&& state->timeouts >= circuit_breaker_threshold_) {
+		state->circuit = CircuitState::OPEN;
+		state->opened_ms = state->used_ms;
+		state->retry_backoff = 0;
+
+		logger.warning(F("Device %u is not responding"), device);
+	}
+}
+
+void BaseClient::device_response(uint16_t device) {
+	auto *state = const_cast<DeviceState*>(find_device(device));
+
+	if (state == nullptr) {
+		return;
+	}
+
+	if (state->circuit != CircuitState::CLOSED) {
+		logger.notice(F("Device %u is responding again"), device);
+	}
+
+	state->timeouts = 0;
+	state->retry_backoff = 0;
+	state->circuit = CircuitState::CLOSED;
+}
+
+bool BaseClient::device_unavailable(uint16_t device) const {
+	if (circuit_breaker_threshold_ == 0) {
+		return false;
+	}
+
+	auto *state = find_device(device);
+
+	if (state == nullptr) {
+		return false;
+	}
+
+	switch (state->circuit) {
+	case CircuitState::OPEN:
+		return ::millis() - state->opened_ms < retry_interval_ms(*state);
+
+	case CircuitState::HALF_OPEN:
+		// Only one request is sent until the device responds or times out
+		for (size_t i = 0; i < requests_.size(); i++) {
+			if (requests_[i].device() == device
+					&& requests_[i].response().status() != ResponseStatus::QUEUED) {
+				return true;
+			}
+		}
+		return false;
+
+	case CircuitState::CLOSED:
+	default:
+		return false;
+	}
+}
+
+void BaseClient::device_retry(uint16_t device) {
+	if (circuit_breaker_threshold_ == 0) {
+		return;
+	}
+
+	auto *state = const_cast<DeviceState*>(find_device(device));
+
+	if (state != nullptr && state->circuit == CircuitState::OPEN) {
+		state->circuit = CircuitState::HALF_OPEN;
+	}
+}
+
+void BaseClient::device_retry_failed(uint16_t device) {
+	auto *state = const_cast<DeviceState*>(find_device(device));
+
+	// Only a timeout of the request sent after the retry interval opens the
+	// circuit breaker again
+	if (state == nullptr || state->circuit != CircuitState::HALF_OPEN) {
+		return;
+	}
+
+	if (state->retry_backoff < MAX_RETRY_BACKOFF) {
+		state->retry_backoff++;
+	}
+
+	state->circuit = CircuitState::OPEN;
+	state->opened_ms = ::millis();
+	state->used_ms = state->opened_ms;
+
+	logger.notice(F("Device %u is still not responding"), device);
+}
+
+uint32_t BaseClient::retry_interval_ms(const DeviceState &state) const {
+	uint64_t interval_ms = static_cast<uint64_t>(min_circuit_retry_ms_) << state.retry_backoff;
+
+	return std::min<uint64_t>(interval_ms, max_circuit_retry_ms_);
+}
+
+} // namespace modbus
+
+} // namespace uuid
@@ -23,28 +23,44 @@
 #include <algorithm>
 #include <cstdarg>
 #include <cstdint>
-#include <memory>
-
-#include <make_unique.cpp>
 
 namespace uuid {
 
 namespace modbus {
 
-std::shared_ptr<const ExceptionStatusResponse> SerialClient::read_exception_status(
-		uint16_t device, uint16_t timeout_ms) {
-	auto response = std::make_shared<ExceptionStatusResponse>();
+ResponseHandle<const ExceptionStatusResponse> BaseClient::read_exception_status(
+		uint16_t device, uint16_t timeout_ms,
+		RequestPriority priority) {
+	return read_exception_status(device, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const ExceptionStatusResponse> BaseClient::read_exception_status(
+		uint16_t device, const ResponseCallback<ExceptionStatusResponse> &callback,
+		uint16_t timeout_ms, RequestPriority priority) {
+	auto response = ResponsePool::make<ExceptionStatusResponse>();
+
+	if (response->done()) {
+		callback(*response);
+		return response;
+	}
 
 	if (device < DeviceAddressType::MIN_UNICAST
 			|| device > DeviceAddressType::MAX_UNICAST) {
 		response->status(ResponseStatus::FAILURE_INVALID);
 	} else {
 		if (timeout_ms == 0) {
-			timeout_ms = default_unicast_timeout_ms_;
+			timeout_ms = unicast_timeout_ms(device);
 		}
 
-		requests_.push_back(std::make_unique<Request>(device,
-			FunctionCode::READ_EXCEPTION_STATUS, timeout_ms, response));
+		if (!requests_.emplace<Request>(priority, device,
+				FunctionCode::READ_EXCEPTION_STATUS, timeout_ms, response,
+				callback)) {
+			response->status(ResponseStatus::FAILURE_QUEUE_FULL);
+		}
+	}
+
+	if (response->done()) {
+		callback(*response);
 	}
 
 	return response;
@@ -60,6 +76,11 @@ ResponseStatus ExceptionStatusResponse::parse(frame_buffer_t &frame, uint16_t le
 	return ResponseStatus::SUCCESS;
 }
 
+uint16_t ExceptionStatusResponse::expected_length(const frame_buffer_t &frame __attribute__((unused)),
+		uint16_t len __attribute__((unused))) const {
+	return 3;
+}
+
 } // namespace modbus
 
 } // namespace uuid
@@ -0,0 +1,434 @@
+/*
+ * uuid-modbus - Microcontroller asynchronous Modbus library
+ * Copyright 2021-2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <uuid/modbus.h>
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstdint>
+
+#include <uuid/log.h>
+
+namespace uuid {
+
+namespace modbus {
+
+template<typename Framing, typename ByteStream>
+void FramedClient<Framing, ByteStream>::loop() {
+	expire();
+
+	if (!stream_.connected()) {
+		disconnected();
+		return;
+	}
+
+	// When only one transaction can be outstanding, the next request is
+	// sent on the call after the previous transaction finishes
+	bool idle = Framing::MAX_TRANSACTIONS > 1
+		|| (transactions_[0].response == nullptr && framing_.rx_size() == 0);
+
+	receive(input());
+
+	do {
+		if (tx_transaction_ != nullptr) {
+			transmit();
+
+			if (tx_transaction_ != nullptr) {
+				return;
+			}
+		}
+	} while (idle && encode());
+}
+
+template<typename Framing, typename ByteStream>
+uint32_t FramedClient<Framing, ByteStream>::next_event_us() const {
+	const uint32_t now_us = ::micros();
+	const uint32_t frame_timeout_us = this->frame_timeout_us();
+
+	auto remaining_us = [now_us] (uint32_t start_us, uint64_t duration_us) -> uint32_t {
+		// The start time is in the future while a request is being transmitted
+		int64_t elapsed_us = static_cast<int32_t>(now_us - start_us);
+
+		if (elapsed_us >= static_cast<int64_t>(duration_us)) {
+			return 0;
+		}
+
+		return std::min<uint64_t>(duration_us - elapsed_us, WAIT_FOR_INPUT - 1);
+	};
+
+	if (tx_transaction_ != nullptr) {
+		// Wait for space in the transmit buffer
+		return stream_.character_time_us();
+	}
+
+	uint32_t next_us = next_expiry_us();
+	bool frame_gap = frame_timeout_us != 0 && (framing_.rx_size() != 0 || frame_gap_);
+	uint8_t outstanding = 0;
+
+	if (frame_gap) {
+		next_us = std::min(next_us, remaining_us(last_rx_us_, frame_timeout_us));
+	}
+
+	for (auto &transaction : transactions_) {
+		if (transaction.response == nullptr) {
+			continue;
+		}
+
+		outstanding++;
+
+		if (frame_timeout_us != 0 && framing_.rx_size() != 0) {
+			// The response has started, so wait for the end of the frame
+			continue;
+		}
+
+		auto &request = requests_[find_request(transaction)];
+
+		next_us = std::min(next_us, remaining_us(transaction.sent_us, request.timeout_ms() * 1000ULL));
+	}
+
+	if (!frame_gap && outstanding < window_ && stream_.connected()) {
+		for (size_t i = 0; i < requests_.size(); i++) {
+			if (requests_[i].response().status() == ResponseStatus::QUEUED) {
+				return 0;
+			}
+		}
+	}
+
+	return next_us;
+}
+
+template<typename Framing, typename ByteStream>
+void FramedClient<Framing, ByteStream>::disconnected() {
+	for (auto &transaction : transactions_) {
+		if (transaction.response != nullptr) {
+			auto &request = requests_[find_request(transaction)];
+
+			request.response().status(ResponseStatus::FAILURE_DISCONNECTED);
+			logger.notice(F("Disconnected while waiting for response to function %02X from device %u"),
+				request.function_code(), request.device());
+			close(transaction);
+		}
+	}
+
+	tx_transaction_ = nullptr;
+	framing_.rx_reset();
+}
+
+template<typename Framing, typename ByteStream>
+bool FramedClient<Framing, ByteStream>::encode() {
+	if (frame_timeout_us() != 0 && (framing_.rx_size() != 0 || frame_gap_)) {
+		// Wait for the end of the current message frame and the inter-frame gap
+		return false;
+	}
+
+	Transaction *transaction = nullptr;
+	uint8_t outstanding = 0;
+
+	for (auto &other : transactions_) {
+		if (other.response != nullptr) {
+			outstanding++;
+		} else if (transaction == nullptr) {
+			transaction = &other;
+		}
+	}
+
+	if (outstanding >= window_) {
+		return false;
+	}
+
+	size_t index = 0;
+
+	// Requests that are in progress are always at the front of the queue
+	while (index < requests_.size()
+			&& requests_[index].response().status() != ResponseStatus::QUEUED) {
+		index++;
+	}
+
+	if (index == requests_.size()) {
+		return false;
+	}
+
+	if (Framing::MAX_TRANSACTIONS == 1 && framing_.rx_size() != 0) {
+		// Data that was received while idle can't be part of the response
+		// to the next request
+		unexpected();
+	}
+
+	auto &request = requests_[index];
+	auto &response = request.response();
+
+	if (device_unavailable(request.device())) {
+		response.status(ResponseStatus::FAILURE_UNAVAILABLE);
+		finish(index);
+		return true;
+	}
+
+	if (!framing_.encode(request, next_id_)) {
+		response.status(ResponseStatus::FAILURE_INVALID);
+		finish(index);
+		return true;
+	}
+
+	device_retry(request.device());
+
+	transaction->response = &response;
+	transaction->id = next_id_++;
+	transaction->sent_us = ::micros();
+	tx_transaction_ = transaction;
+	tx_length_ = 0;
+	response.status(ResponseStatus::TRANSMIT);
+	return true;
+}
+
+template<typename Framing, typename ByteStream>
+void FramedClient<Framing, ByteStream>::transmit() {
+	while (framing_.tx_pending()) {
+		size_t len;
+		const uint8_t *data = framing_.tx_data(len);
+
+		len = stream_.write(data, len);
+
+		if (len == 0) {
+			return;
+		}
+
+		framing_.tx_advance(len);
+		tx_length_ += len;
+	}
+
+	auto &request = requests_[find_request(*tx_transaction_)];
+	const uint32_t now_us = ::micros();
+
+	// The request has been sent when the last character has left the transmit
+	// buffer, which is after it has been written unless writing was delayed
+	uint32_t sent_us = tx_transaction_->sent_us + tx_length_ * stream_.character_time_us();
+
+	tx_transaction_->sent_us = static_cast<int32_t>(sent_us - now_us) > 0 ? sent_us : now_us;
+	request.response().status(ResponseStatus::WAITING);
+	tx_transaction_ = nullptr;
+}
+
+template<typename Framing, typename ByteStream>
+uint32_t FramedClient<Framing, ByteStream>::input() {
+	const uint32_t now_us = ::micros();
+	bool received = false;
+
+	if (Framing::MAX_TRANSACTIONS == 1 && tx_transaction_ != nullptr) {
+		// The request is still in the buffer that is used to receive
+		return now_us;
+	}
+
+	while (true) {
+		int available = stream_.available();
+
+		if (available <= 0) {
+			break;
+		}
+
+		size_t space;
+		uint8_t *buffer = framing_.rx_space(space);
+
+		if (space == 0) {
+			// Discard data that doesn't fit in the frame buffer
+			while (available-- > 0 && stream_.read() != -1) {
+				received = true;
+			}
+			continue;
+		}
+
+		size_t len = stream_.read(buffer, std::min(static_cast<size_t>(available), space));
+
+		if (len == 0) {
+			break;
+		}
+
+		if (framing_.rx_size() == 0) {
+			// All of the data available now is one burst with a single timestamp
+			first_rx_us_ = now_us;
+		}
+
+		received = true;
+
+		switch (framing_.rx_advance(len)) {
+		case FrameState::PARTIAL:
+			break;
+
+		case FrameState::COMPLETE:
+			complete();
+			break;
+
+		case FrameState::INVALID:
+			// The start of the next message frame can't be found
+			stream_.stop();
+			disconnected();
+			return now_us;
+		}
+	}
+
+	if (received) {
+		last_rx_us_ = now_us;
+	}
+
+	return now_us;
+}
+
+template<typename Framing, typename ByteStream>
+void FramedClient<Framing, ByteStream>::receive(uint32_t now_us) {
+	const uint32_t frame_timeout_us = this->frame_timeout_us();
+
+	if (framing_.rx_size() == 0) {
+		if (frame_gap_ && now_us - last_rx_us_ >= frame_timeout_us) {
+			frame_gap_ = false;
+		}
+	} else if (frame_timeout_us != 0 && now_us - last_rx_us_ >= frame_timeout_us) {
+		complete();
+	} else {
+		auto *transaction = waiting();
+
+		if (transaction != nullptr
+				&& framing_.rx_complete(requests_[find_request(*transaction)])) {
+			complete();
+
+			// The next request must still wait for the inter-frame timeout
+			frame_gap_ = (frame_timeout_us != 0);
+		} else if (Framing::MAX_TRANSACTIONS == 1 && frame_timeout_us == 0
+				&& transaction == nullptr) {
+			// Without an inter-frame timeout there is no end to data that
+			// is received while idle, so discard it now
+			complete();
+		}
+	}
+
+	for (auto &transaction : transactions_) {
+		if (transaction.response == nullptr
+				|| transaction.response->status() != ResponseStatus::WAITING) {
+			continue;
+		}
+
+		auto &request = requests_[find_request(transaction)];
+
+		// The time that the request was sent is in the future until all of it
+		// has been transmitted
+		if (static_cast<int32_t>(now_us - transaction.sent_us) < static_cast<int32_t>(request.timeout_ms() * 1000UL)) {
+			continue;
+		}
+
+		if (Framing::MAX_TRANSACTIONS == 1 && framing_.rx_size() != 0) {
+			if (frame_timeout_us == 0) {
+				// The end of the response can't be identified, so it is
+				// incomplete
+				complete();
+			}
+			continue;
+		}
+
+		if (request.device() == DeviceAddressType::BROADCAST) {
+			request.response().status(ResponseStatus::SUCCESS);
+		} else {
+			request.response().status(ResponseStatus::FAILURE_TIMEOUT);
+			logger.notice(F("Timeout waiting for response to function %02X from device %u"),
+				request.function_code(), request.device());
+			device_timeout(request.device());
+			device_retry_failed(request.device());
+		}
+
+		close(transaction);
+	}
+}
+
+template<typename Framing, typename ByteStream>
+void FramedClient<Framing, ByteStream>::complete() {
+	if (Framing::MAX_TRANSACTIONS == 1 && waiting() == nullptr) {
+		unexpected();
+		return;
+	}
+
+	uint16_t len;
+	uint16_t id;
+
+	framing_.rx_log();
+
+	ResponseStatus status = framing_.decode(len, id);
+	auto *transaction = waiting(id);
+
+	if (transaction == nullptr) {
+		logger.err(F("Received function %02X from device %u for unknown transaction %u"),
+			framing_.rx_frame()[1], framing_.rx_frame()[0], id);
+	} else {
+		auto &request = requests_[find_request(*transaction)];
+
+		if (status == ResponseStatus::SUCCESS) {
+			parse_response(request, framing_.rx_frame(), len, first_rx_us_ - transaction->sent_us);
+		} else {
+			request.response().status(status);
+		}
+
+		close(*transaction);
+	}
+
+	framing_.rx_reset();
+}
+
+template<typename Framing, typename ByteStream>
+void FramedClient<Framing, ByteStream>::unexpected() {
+	framing_.rx_log();
+	logger.err(F("Received unexpected frame while idle from device %u"), framing_.rx_frame()[0]);
+	framing_.rx_reset();
+}
+
+template<typename Framing, typename ByteStream>
+typename FramedClient<Framing, ByteStream>::Transaction *FramedClient<Framing, ByteStream>::waiting(uint16_t id) {
+	for (auto &transaction : transactions_) {
+		if (transaction.response != nullptr
+				&& transaction.response->status() == ResponseStatus::WAITING
+				&& (Framing::MAX_TRANSACTIONS == 1 || transaction.id == id)) {
+			return &transaction;
+		}
+	}
+
+	return nullptr;
+}
+
+template<typename Framing, typename ByteStream>
+size_t FramedClient<Framing, ByteStream>::find_request(const Transaction &transaction) const {
+	size_t index = 0;
+
+	while (&requests_[index].response() != transaction.response) {
+		index++;
+	}
+
+	return index;
+}
+
+template<typename Framing, typename ByteStream>
+void FramedClient<Framing, ByteStream>::close(Transaction &transaction) {
+	size_t index = find_request(transaction);
+
+	transaction.response = nullptr;
+	finish(index);
+}
+
+template class FramedClient<RtuFraming, SerialStream>;
+template class FramedClient<AsciiFraming, SerialStream>;
+template class FramedClient<RtuFraming, NetworkStream>;
+template class FramedClient<MbapFraming, NetworkStream>;
+
+} // namespace modbus
+
+} // namespace uuid
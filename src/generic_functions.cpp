@@ -23,16 +23,16 @@
 #include <algorithm>
 #include <cstdarg>
 #include <cstdint>
-#include <memory>
 
 namespace uuid {
 
 namespace modbus {
 
 Request::Request(uint16_t device, uint8_t function_code, uint16_t timeout_ms,
-		const std::shared_ptr<Response> &response)
+		const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback)
 		: device_(device), function_code_(function_code), timeout_ms_(timeout_ms),
-		response_(response) {
+		response_(response), callback_(callback) {
 }
 
 uint16_t Request::encode(frame_buffer_t &frame) {
@@ -41,6 +41,11 @@ uint16_t Request::encode(frame_buffer_t &frame) {
 	return 2;
 }
 
+uint16_t Response::expected_length(const frame_buffer_t &frame __attribute__((unused)),
+		uint16_t len __attribute__((unused))) const {
+	return 0;
+}
+
 bool Response::check_length(frame_buffer_t &frame, uint16_t actual, uint16_t expected) {
 	if (actual != expected) {
 		logger.err(F("Length mismatch for function %02X from device %u, expected %u received %u"),
@@ -20,6 +20,9 @@
 
 #include <Arduino.h>
 
+#include <cstdint>
+#include <vector>
+
 #include <uuid/log.h>
 
 #ifndef PSTR_ALIGN
@@ -36,6 +39,30 @@ static const char __pstr__loggername[] __attribute__((__aligned__(PSTR_ALIGN)))
 
 const uuid::log::Logger logger{reinterpret_cast<const __FlashStringHelper *>(__pstr__loggername), uuid::log::Facility::DAEMON};
 
+void log_frame(const __FlashStringHelper *prefix, const uint8_t *frame,
+		uint16_t len, uint16_t trailer_size) {
+	if (logger.enabled(uuid::log::Level::TRACE)) {
+		static constexpr uint8_t BYTES_PER_LINE = 16;
+		static constexpr uint8_t CHARS_PER_BYTE = 3;
+		std::vector<char> message(CHARS_PER_BYTE * BYTES_PER_LINE + 1);
+		uint8_t pos = 0;
+
+		for (uint16_t i = 0; i < len; i++) {
+			snprintf_P(&message[CHARS_PER_BYTE * pos++], CHARS_PER_BYTE + 1,
+				PSTR("%c%02X"),
+				(i == MESSAGE_HEADER_SIZE || (trailer_size > 0 && i == len - trailer_size))
+					? '\'' : ' ',
+				frame[i]);
+
+			if (pos == BYTES_PER_LINE || i == len - 1) {
+				logger.trace(F("%S%s"), prefix, message.data());
+				pos = 0;
+				prefix = F("  ");
+			}
+		}
+	}
+}
+
 } // namespace modbus
 
 } // namespace uuid
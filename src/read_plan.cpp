@@ -0,0 +1,208 @@
+/*
+ * uuid-modbus - Microcontroller asynchronous Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <uuid/modbus.h>
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace uuid {
+
+namespace modbus {
+
+RegisterReadPlan::RegisterReadPlan(RegisterPoint *points, size_t size)
+		: points_(points), size_(size) {
+}
+
+size_t RegisterReadPlan::plan(uint32_t byte_time_us, uint32_t frame_overhead_us,
+		uint32_t turnaround_us) {
+	auto valid = [] (const RegisterPoint &point) {
+		return point.device >= DeviceAddressType::MIN_UNICAST
+			&& point.device <= DeviceAddressType::MAX_UNICAST
+			&& (point.function_code == FunctionCode::READ_HOLDING_REGISTERS
+				|| point.function_code == FunctionCode::READ_INPUT_REGISTERS);
+	};
+
+	std::sort(points_, points_ + size_,
+		[&valid] (const RegisterPoint &a, const RegisterPoint &b) {
+			if (valid(a) != valid(b)) {
+				return valid(a);
+			} else if (a.device != b.device) {
+				return a.device < b.device;
+			} else if (a.function_code != b.function_code) {
+				return a.function_code < b.function_code;
+			} else {
+				return a.address < b.address;
+			}
+		});
+
+	valid_ = 0;
+	for (size_t i = 0; i < size_; i++) {
+		if (valid(points_[i])) {
+			points_[i].status = ResponseStatus::QUEUED;
+			valid_++;
+		} else {
+			points_[i].status = ResponseStatus::FAILURE_INVALID;
+		}
+		points_[i].block_start_ = false;
+	}
+
+	const uint32_t overhead_us = (REQUEST_SIZE + RESPONSE_OVERHEAD) * byte_time_us
+		+ 2 * frame_overhead_us + turnaround_us;
+	const uint32_t register_us = 2 * byte_time_us;
+
+	// Find the minimum cost to read every register up to and including each
+	// register, where the last request starts at any previous register that
+	// is within range
+	for (size_t i = 0; i < valid_; i++) {
+		uint32_t best = std::numeric_limits<uint32_t>::max();
+
+		for (size_t j = i + 1; j-- > 0; ) {
+			if (!same_group(points_[j], points_[i])
+					|| points_[i].address - points_[j].address >= MAX_READ_REGISTERS) {
+				break;
+			}
+
+			if (can_start(j)) {
+				uint32_t cost = (j > 0 ? points_[j - 1].cost_us_ : 0) + overhead_us
+					+ (points_[i].address - points_[j].address + 1) * register_us;
+
+				best = std::min(best, cost);
+			}
+		}
+
+		points_[i].cost_us_ = best;
+	}
+
+	// Mark the start of each request by working back from the end, using the
+	// longest request that has the minimum cost
+	blocks_ = 0;
+	for (size_t i = valid_; i > 0; ) {
+		size_t end = i - 1;
+		size_t start = end;
+
+		for (size_t j = end + 1; j-- > 0; ) {
+			if (!same_group(points_[j], points_[end])
+					|| points_[end].address - points_[j].address >= MAX_READ_REGISTERS) {
+				break;
+			}
+
+			if (!can_start(j)) {
+				continue;
+			}
+
+			uint32_t cost = (j > 0 ? points_[j - 1].cost_us_ : 0) + overhead_us
+				+ (points_[end].address - points_[j].address + 1) * register_us;
+
+			if (cost == points_[end].cost_us_) {
+				start = j;
+			}
+		}
+
+		points_[start].block_start_ = true;
+		blocks_++;
+		i = start;
+	}
+
+	completed_ = 0;
+	return blocks_;
+}
+
+bool RegisterReadPlan::can_start(size_t index) const {
+	return index == 0
+		|| !same_group(points_[index - 1], points_[index])
+		|| points_[index - 1].address != points_[index].address;
+}
+
+size_t RegisterReadPlan::block_end(size_t start) const {
+	size_t end = start + 1;
+
+	while (end < valid_ && !points_[end].block_start_) {
+		end++;
+	}
+
+	return end;
+}
+
+void RegisterReadPlan::submit(BaseClient &client, uint16_t timeout_ms,
+		RequestPriority priority) {
+	client_ = &client;
+	timeout_ms_ = timeout_ms;
+	priority_ = priority;
+	completed_ = 0;
+	next_ = 0;
+	queue();
+}
+
+void RegisterReadPlan::queue() {
+	queuing_ = true;
+
+	while (next_ < valid_ && queued_ < PIPELINE_DEPTH) {
+		RegisterReadPlan *plan = this;
+		size_t start = next_;
+		size_t end = block_end(start);
+		uint16_t size = points_[end - 1].address - points_[start].address + 1;
+		auto callback = [plan, start] (const RegisterDataResponse &response) {
+			plan->block_complete(start, response);
+		};
+
+		next_ = end;
+		queued_++;
+
+		if (points_[start].function_code == FunctionCode::READ_HOLDING_REGISTERS) {
+			client_->read_holding_registers(points_[start].device,
+				points_[start].address, size, callback, timeout_ms_, priority_);
+		} else {
+			client_->read_input_registers(points_[start].device,
+				points_[start].address, size, callback, timeout_ms_, priority_);
+		}
+	}
+
+	queuing_ = false;
+}
+
+void RegisterReadPlan::block_complete(size_t start, const RegisterDataResponse &response) {
+	size_t end = block_end(start);
+
+	for (size_t i = start; i < end; i++) {
+		uint16_t offset = points_[i].address - points_[start].address;
+
+		if (response.status() != ResponseStatus::SUCCESS) {
+			points_[i].status = response.status();
+		} else if (offset >= response.data().size()) {
+			points_[i].status = ResponseStatus::FAILURE_LENGTH;
+		} else {
+			points_[i].value = response.data()[offset];
+			points_[i].status = ResponseStatus::SUCCESS;
+		}
+	}
+
+	queued_--;
+	completed_++;
+
+	if (!queuing_) {
+		queue();
+	}
+}
+
+} // namespace modbus
+
+} // namespace uuid
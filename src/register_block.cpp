@@ -0,0 +1,173 @@
+/*
+ * uuid-modbus - Microcontroller asynchronous Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <uuid/modbus.h>
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace uuid {
+
+namespace modbus {
+
+ResponseHandle<const RegisterBlockResponse> BaseClient::read_holding_register_block(
+		uint16_t device, uint16_t address, uint16_t *values, uint32_t size,
+		uint16_t timeout_ms, RequestPriority priority) {
+	return read_register_block(FunctionCode::READ_HOLDING_REGISTERS, device,
+		address, values, size, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterBlockResponse> BaseClient::read_holding_register_block(
+		uint16_t device, uint16_t address, uint16_t *values, uint32_t size,
+		const ResponseCallback<RegisterBlockResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	return read_register_block(FunctionCode::READ_HOLDING_REGISTERS, device,
+		address, values, size, callback, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterBlockResponse> BaseClient::read_input_register_block(
+		uint16_t device, uint16_t address, uint16_t *values, uint32_t size,
+		uint16_t timeout_ms, RequestPriority priority) {
+	return read_register_block(FunctionCode::READ_INPUT_REGISTERS, device,
+		address, values, size, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterBlockResponse> BaseClient::read_input_register_block(
+		uint16_t device, uint16_t address, uint16_t *values, uint32_t size,
+		const ResponseCallback<RegisterBlockResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	return read_register_block(FunctionCode::READ_INPUT_REGISTERS, device,
+		address, values, size, callback, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterBlockResponse> BaseClient::read_register_block(
+		uint8_t function_code, uint16_t device, uint16_t address,
+		uint16_t *values, uint32_t size,
+		const ResponseCallback<RegisterBlockResponse> &callback,
+		uint16_t timeout_ms, RequestPriority priority) {
+	auto response = ResponsePool::make<RegisterBlockResponse>();
+
+	if (response->done()) {
+		callback(*response);
+		return response;
+	}
+
+	if (device < DeviceAddressType::MIN_UNICAST
+			|| device > DeviceAddressType::MAX_UNICAST
+			|| values == nullptr || size < 1
+			|| size > MAX_READ_BLOCK_REGISTERS - address) {
+		response->status(ResponseStatus::FAILURE_INVALID);
+		callback(*response);
+		return response;
+	}
+
+	response->client_ = this;
+	response->self_ = response;
+	response->callback_ = callback;
+	response->values_ = values;
+	response->size_ = size;
+	response->address_ = address;
+	response->timeout_ms_ = timeout_ms;
+	response->priority_ = priority;
+	response->chunks_ = (size + MAX_READ_REGISTERS - 1) / MAX_READ_REGISTERS;
+	response->device_ = device;
+	response->function_code_ = function_code;
+	response->queue();
+
+	return response;
+}
+
+void RegisterBlockResponse::queue() {
+	queuing_ = true;
+
+	while (next_chunk_ < chunks_ && queued_ < PIPELINE_DEPTH) {
+		RegisterBlockResponse *block = this;
+		uint16_t index = next_chunk_++;
+		uint32_t offset = static_cast<uint32_t>(index) * MAX_READ_REGISTERS;
+		uint16_t size = std::min<uint32_t>(size_ - offset, MAX_READ_REGISTERS);
+		auto callback = [block, index] (const RegisterDataResponse &response) {
+			block->chunk_complete(index, response);
+		};
+
+		queued_++;
+
+		if (function_code_ == FunctionCode::READ_HOLDING_REGISTERS) {
+			client_->read_holding_registers(device_, address_ + offset, size,
+				callback, timeout_ms_, priority_);
+		} else {
+			client_->read_input_registers(device_, address_ + offset, size,
+				callback, timeout_ms_, priority_);
+		}
+	}
+
+	queuing_ = false;
+
+	if (queued_ == 0 && next_chunk_ == chunks_) {
+		// Release the reference to this response after calling the callback
+		ResponseHandle<RegisterBlockResponse> self{std::move(self_)};
+
+		status(result_);
+		callback_(*this);
+	}
+}
+
+void RegisterBlockResponse::chunk_complete(uint16_t index,
+		const RegisterDataResponse &response) {
+	uint32_t offset = static_cast<uint32_t>(index) * MAX_READ_REGISTERS;
+	size_t size = std::min<uint32_t>(size_ - offset, MAX_READ_REGISTERS);
+	ResponseStatus status = response.status();
+
+	if (status == ResponseStatus::SUCCESS) {
+		if (response.data().size() < size) {
+			logger.err(F("Received %u of %u registers from device %u"),
+				static_cast<unsigned int>(response.data().size()),
+				static_cast<unsigned int>(size), device_);
+			status = ResponseStatus::FAILURE_LENGTH;
+		} else {
+			std::copy(response.data().begin(), response.data().begin() + size,
+				&values_[offset]);
+		}
+	}
+
+	if (status != ResponseStatus::SUCCESS) {
+		failed_[index / 8] |= 1 << (index % 8);
+		failed_chunks_++;
+
+		if (result_ == ResponseStatus::SUCCESS) {
+			result_ = status;
+		}
+	}
+
+	queued_--;
+
+	if (!queuing_) {
+		queue();
+	}
+}
+
+ResponseStatus RegisterBlockResponse::parse(frame_buffer_t &frame __attribute__((unused)),
+		uint16_t len __attribute__((unused))) {
+	return ResponseStatus::FAILURE_UNEXPECTED;
+}
+
+} // namespace modbus
+
+} // namespace uuid
@@ -0,0 +1,269 @@
+/*
+ * uuid-modbus - Microcontroller asynchronous Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <uuid/modbus.h>
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace uuid {
+
+namespace modbus {
+
+RegisterCache::RegisterCache(BaseClient &client, RegisterCacheEntry *entries, size_t size)
+		: client_(client), entries_(entries), size_(size) {
+}
+
+ResponseHandle<const RegisterDataResponse> RegisterCache::read_holding_registers(
+		uint16_t device, uint16_t address, uint16_t size, uint32_t ttl_ms,
+		uint16_t timeout_ms, RequestPriority priority) {
+	return read(FunctionCode::READ_HOLDING_REGISTERS, device, address, size,
+		ttl_ms, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterDataResponse> RegisterCache::read_holding_registers(
+		uint16_t device, uint16_t address, uint16_t size, uint32_t ttl_ms,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	return read(FunctionCode::READ_HOLDING_REGISTERS, device, address, size,
+		ttl_ms, callback, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterDataResponse> RegisterCache::read_input_registers(
+		uint16_t device, uint16_t address, uint16_t size, uint32_t ttl_ms,
+		uint16_t timeout_ms, RequestPriority priority) {
+	return read(FunctionCode::READ_INPUT_REGISTERS, device, address, size,
+		ttl_ms, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterDataResponse> RegisterCache::read_input_registers(
+		uint16_t device, uint16_t address, uint16_t size, uint32_t ttl_ms,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	return read(FunctionCode::READ_INPUT_REGISTERS, device, address, size,
+		ttl_ms, callback, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterDataResponse> RegisterCache::read(uint8_t function_code,
+		uint16_t device, uint16_t address, uint16_t size, uint32_t ttl_ms,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	if (ttl_ms > MAX_TTL_MS) {
+		auto response = ResponsePool::make<RegisterDataResponse>();
+
+		if (!response->done()) {
+			response->status(ResponseStatus::FAILURE_INVALID);
+		}
+
+		callback(*response);
+		return response;
+	}
+
+	if (device < DeviceAddressType::MIN_UNICAST
+			|| device > DeviceAddressType::MAX_UNICAST
+			|| size < 1 || size > MAX_READ_REGISTERS) {
+		// Let the client report the invalid request
+		return client_read(function_code, device, address, size, callback,
+			timeout_ms, priority);
+	}
+
+	const uint32_t now_ms = ::millis();
+	bool hit = true;
+
+	for (uint16_t i = 0; i < size; i++) {
+		auto *entry = find(device, function_code, address + i);
+
+		if (entry == nullptr || expired(*entry, now_ms)) {
+			hit = false;
+			break;
+		}
+	}
+
+	if (hit) {
+		auto response = ResponsePool::make<RegisterDataResponse>();
+
+		if (!response->done()) {
+			for (uint16_t i = 0; i < size; i++) {
+				response->data_.push_back(find(device, function_code, address + i)->value_);
+			}
+
+			response->status(ResponseStatus::SUCCESS);
+			hits_++;
+		}
+
+		callback(*response);
+		return response;
+	}
+
+	misses_++;
+
+	for (size_t i = 0; i < pending_.size(); i++) {
+		auto &pending = pending_[i];
+
+		if (pending.device != DeviceAddressType::BROADCAST) {
+			continue;
+		}
+
+		pending.callback = callback;
+		pending.ttl_ms = ttl_ms;
+		pending.address = address;
+		pending.device = device;
+		pending.function_code = function_code;
+
+		return client_read(function_code, device, address, size,
+			[this, i] (const RegisterDataResponse &response) {
+				read_complete(i, response);
+			}, timeout_ms, priority);
+	}
+
+	// Too many reads in progress to store the values when they complete
+	return client_read(function_code, device, address, size, callback,
+		timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterDataResponse> RegisterCache::client_read(uint8_t function_code,
+		uint16_t device, uint16_t address, uint16_t size,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	if (function_code == FunctionCode::READ_HOLDING_REGISTERS) {
+		return client_.read_holding_registers(device, address, size, callback,
+			timeout_ms, priority);
+	} else {
+		return client_.read_input_registers(device, address, size, callback,
+			timeout_ms, priority);
+	}
+}
+
+void RegisterCache::read_complete(size_t index, const RegisterDataResponse &response) {
+	auto &pending = pending_[index];
+	auto callback = pending.callback;
+
+	if (response.success()) {
+		const uint32_t expires_ms = ::millis() + pending.ttl_ms;
+
+		for (size_t i = 0; i < response.data().size(); i++) {
+			store(pending.device, pending.function_code, pending.address + i,
+				response.data()[i], expires_ms);
+		}
+	}
+
+	pending.callback = nullptr;
+	pending.device = DeviceAddressType::BROADCAST;
+	callback(response);
+}
+
+size_t RegisterCache::slot(uint8_t device, uint8_t function_code, uint16_t address) const {
+	const uint32_t key = (static_cast<uint32_t>(device) << 24)
+		| (static_cast<uint32_t>(function_code) << 16) | address;
+
+	// Fibonacci hashing spreads consecutive addresses across the table
+	return (key * UINT32_C(2654435769)) % size_;
+}
+
+RegisterCacheEntry* RegisterCache::find(uint8_t device, uint8_t function_code, uint16_t address) {
+	if (size_ == 0) {
+		return nullptr;
+	}
+
+	size_t pos = slot(device, function_code, address);
+
+	for (size_t i = 0; i < std::min(size_, static_cast<size_t>(MAX_PROBES)); i++) {
+		auto &entry = entries_[pos];
+
+		if (entry.device_ == DeviceAddressType::BROADCAST) {
+			break;
+		}
+
+		if (entry.device_ == device && entry.function_code_ == function_code
+				&& entry.address_ == address) {
+			return &entry;
+		}
+
+		pos = (pos + 1) % size_;
+	}
+
+	return nullptr;
+}
+
+void RegisterCache::store(uint8_t device, uint8_t function_code, uint16_t address,
+		uint16_t value, uint32_t expires_ms) {
+	if (size_ == 0) {
+		return;
+	}
+
+	const uint32_t now_ms = ::millis();
+	size_t pos = slot(device, function_code, address);
+	RegisterCacheEntry *replace = nullptr;
+
+	// Expired entries are not removed so that the search for a register can
+	// stop at the first unused entry
+	for (size_t i = 0; i < std::min(size_, static_cast<size_t>(MAX_PROBES)); i++) {
+		auto &entry = entries_[pos];
+
+		if (entry.device_ == DeviceAddressType::BROADCAST) {
+			if (replace == nullptr) {
+				replace = &entry;
+			}
+			break;
+		}
+
+		if (entry.device_ == device && entry.function_code_ == function_code
+				&& entry.address_ == address) {
+			replace = &entry;
+			break;
+		}
+
+		if (replace == nullptr || (!expired(*replace, now_ms)
+				&& static_cast<int32_t>(entry.expires_ms_ - replace->expires_ms_) < 0)) {
+			replace = &entry;
+		}
+
+		pos = (pos + 1) % size_;
+	}
+
+	replace->expires_ms_ = expires_ms;
+	replace->address_ = address;
+	replace->value_ = value;
+	replace->device_ = device;
+	replace->function_code_ = function_code;
+}
+
+void RegisterCache::invalidate(uint16_t device, uint8_t function_code,
+		uint16_t address, uint16_t size) {
+	const uint32_t now_ms = ::millis();
+
+	for (uint16_t i = 0; i < size; i++) {
+		auto *entry = find(device, function_code, address + i);
+
+		if (entry != nullptr) {
+			entry->expires_ms_ = now_ms;
+		}
+	}
+}
+
+void RegisterCache::clear() {
+	for (size_t i = 0; i < size_; i++) {
+		entries_[i] = RegisterCacheEntry{};
+	}
+}
+
+} // namespace modbus
+
+} // namespace uuid
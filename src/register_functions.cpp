@@ -23,59 +23,118 @@
 #include <algorithm>
 #include <cstdarg>
 #include <cstdint>
-#include <memory>
-
-#include <make_unique.cpp>
+#include <utility>
 
 namespace uuid {
 
 namespace modbus {
 
-std::shared_ptr<const RegisterDataResponse> SerialClient::read_holding_registers(
-		uint16_t device, uint16_t address, uint16_t size, uint16_t timeout_ms) {
-	auto response = std::make_shared<RegisterDataResponse>();
+ResponseHandle<const RegisterDataResponse> BaseClient::read_holding_registers(
+		uint16_t device, uint16_t address, uint16_t size, uint16_t timeout_ms,
+		RequestPriority priority) {
+	return read_holding_registers(device, address, size, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterDataResponse> BaseClient::read_holding_registers(
+		uint16_t device, uint16_t address, uint16_t size,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	auto response = ResponsePool::make<RegisterDataResponse>();
+
+	if (response->done()) {
+		callback(*response);
+		return response;
+	}
 
 	if (device < DeviceAddressType::MIN_UNICAST
 			|| device > DeviceAddressType::MAX_UNICAST
-			|| size < 1 || size > 0x007D) {
+			|| size < 1 || size > MAX_READ_REGISTERS) {
 		response->status(ResponseStatus::FAILURE_INVALID);
 	} else {
 		if (timeout_ms == 0) {
-			timeout_ms = default_unicast_timeout_ms_;
+			timeout_ms = unicast_timeout_ms(device);
 		}
 
-		requests_.push_back(std::make_unique<RegisterRequest>(device,
-			FunctionCode::READ_HOLDING_REGISTERS, timeout_ms, address, size,
-			response));
+		if (coalesce_read(FunctionCode::READ_HOLDING_REGISTERS, device, address,
+				size, response, callback, priority)) {
+			return response;
+		}
+
+		if (!requests_.emplace<RegisterRequest>(priority, device,
+				FunctionCode::READ_HOLDING_REGISTERS, timeout_ms, address, size,
+				response, callback)) {
+			response->status(ResponseStatus::FAILURE_QUEUE_FULL);
+		}
+	}
+
+	if (response->done()) {
+		callback(*response);
 	}
 
 	return response;
 }
 
-std::shared_ptr<const RegisterDataResponse> SerialClient::read_input_registers(
-		uint16_t device, uint16_t address, uint16_t size, uint16_t timeout_ms) {
-	auto response = std::make_shared<RegisterDataResponse>();
+ResponseHandle<const RegisterDataResponse> BaseClient::read_input_registers(
+		uint16_t device, uint16_t address, uint16_t size, uint16_t timeout_ms,
+		RequestPriority priority) {
+	return read_input_registers(device, address, size, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterDataResponse> BaseClient::read_input_registers(
+		uint16_t device, uint16_t address, uint16_t size,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	auto response = ResponsePool::make<RegisterDataResponse>();
+
+	if (response->done()) {
+		callback(*response);
+		return response;
+	}
 
 	if (device < DeviceAddressType::MIN_UNICAST
 			|| device > DeviceAddressType::MAX_UNICAST
-			|| size < 1 || size > 0x007D) {
+			|| size < 1 || size > MAX_READ_REGISTERS) {
 		response->status(ResponseStatus::FAILURE_INVALID);
 	} else {
 		if (timeout_ms == 0) {
-			timeout_ms = default_unicast_timeout_ms_;
+			timeout_ms = unicast_timeout_ms(device);
+		}
+
+		if (coalesce_read(FunctionCode::READ_INPUT_REGISTERS, device, address,
+				size, response, callback, priority)) {
+			return response;
 		}
 
-		requests_.push_back(std::make_unique<RegisterRequest>(device,
-			FunctionCode::READ_INPUT_REGISTERS, timeout_ms, address, size,
-			response));
+		if (!requests_.emplace<RegisterRequest>(priority, device,
+				FunctionCode::READ_INPUT_REGISTERS, timeout_ms, address, size,
+				response, callback)) {
+			response->status(ResponseStatus::FAILURE_QUEUE_FULL);
+		}
+	}
+
+	if (response->done()) {
+		callback(*response);
 	}
 
 	return response;
 }
 
-std::shared_ptr<const RegisterWriteResponse> SerialClient::write_holding_register(
-		uint16_t device, uint16_t address, uint16_t value, uint16_t timeout_ms) {
-	auto response = std::make_shared<RegisterWriteResponse>();
+ResponseHandle<const RegisterWriteResponse> BaseClient::write_holding_register(
+		uint16_t device, uint16_t address, uint16_t value, uint16_t timeout_ms,
+		RequestPriority priority) {
+	return write_holding_register(device, address, value, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterWriteResponse> BaseClient::write_holding_register(
+		uint16_t device, uint16_t address, uint16_t value,
+		const ResponseCallback<RegisterWriteResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	auto response = ResponsePool::make<RegisterWriteResponse>();
+
+	if (response->done()) {
+		callback(*response);
+		return response;
+	}
 
 	if (device > DeviceAddressType::MAX_UNICAST) {
 		response->status(ResponseStatus::FAILURE_INVALID);
@@ -84,22 +143,203 @@ std::shared_ptr<const RegisterWriteResponse> SerialClient::write_holding_registe
 			if (device == DeviceAddressType::BROADCAST) {
 				timeout_ms = default_broadcast_timeout_ms_;
 			} else {
-				timeout_ms = default_unicast_timeout_ms_;
+				timeout_ms = unicast_timeout_ms(device);
+			}
+		}
+
+		if (write_behind_) {
+			if (coalesce_write(device, address, value, response, callback, priority)) {
+				return response;
 			}
+
+			if (!requests_.emplace<RegisterWriteBehindRequest>(priority, device,
+					timeout_ms, address, value, response, callback)) {
+				response->status(ResponseStatus::FAILURE_QUEUE_FULL);
+			}
+		} else if (!requests_.emplace<RegisterRequest>(priority, device,
+				FunctionCode::WRITE_SINGLE_REGISTER, timeout_ms, address, value,
+				response, callback)) {
+			response->status(ResponseStatus::FAILURE_QUEUE_FULL);
 		}
+	}
 
-		requests_.push_back(std::make_unique<RegisterRequest>(device,
-			FunctionCode::WRITE_SINGLE_REGISTER, timeout_ms, address, value,
-			response));
+	if (response->done()) {
+		callback(*response);
 	}
 
 	return response;
 }
 
+ResponseHandle<const RegisterWriteResponse> BaseClient::write_holding_registers(
+		uint16_t device, uint16_t address, const uint16_t *values, uint16_t size,
+		uint16_t timeout_ms, RequestPriority priority) {
+	return write_holding_registers(device, address, values, size, nullptr,
+		timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterWriteResponse> BaseClient::write_holding_registers(
+		uint16_t device, uint16_t address, const uint16_t *values, uint16_t size,
+		const ResponseCallback<RegisterWriteResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	auto response = ResponsePool::make<RegisterWriteResponse>();
+
+	if (response->done()) {
+		callback(*response);
+		return response;
+	}
+
+	if (device > DeviceAddressType::MAX_UNICAST
+			|| values == nullptr || size < 1 || size > MAX_WRITE_REGISTERS) {
+		response->status(ResponseStatus::FAILURE_INVALID);
+	} else {
+		if (timeout_ms == 0) {
+			if (device == DeviceAddressType::BROADCAST) {
+				timeout_ms = default_broadcast_timeout_ms_;
+			} else {
+				timeout_ms = unicast_timeout_ms(device);
+			}
+		}
+
+		if (!requests_.emplace<RegisterValuesRequest>(priority, device,
+				FunctionCode::WRITE_MULTIPLE_REGISTERS, timeout_ms, address,
+				values, size, response, callback)) {
+			response->status(ResponseStatus::FAILURE_QUEUE_FULL);
+		}
+	}
+
+	if (response->done()) {
+		callback(*response);
+	}
+
+	return response;
+}
+
+ResponseHandle<const RegisterDataResponse> BaseClient::read_write_holding_registers(
+		uint16_t device, uint16_t read_address, uint16_t read_size,
+		uint16_t write_address, const uint16_t *values, uint16_t write_size,
+		uint16_t timeout_ms, RequestPriority priority) {
+	return read_write_holding_registers(device, read_address, read_size,
+		write_address, values, write_size, nullptr, timeout_ms, priority);
+}
+
+ResponseHandle<const RegisterDataResponse> BaseClient::read_write_holding_registers(
+		uint16_t device, uint16_t read_address, uint16_t read_size,
+		uint16_t write_address, const uint16_t *values, uint16_t write_size,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority) {
+	auto response = ResponsePool::make<RegisterDataResponse>();
+
+	if (response->done()) {
+		callback(*response);
+		return response;
+	}
+
+	if (device < DeviceAddressType::MIN_UNICAST
+			|| device > DeviceAddressType::MAX_UNICAST
+			|| read_size < 1 || read_size > MAX_READ_REGISTERS
+			|| values == nullptr || write_size < 1
+			|| write_size > MAX_READ_WRITE_REGISTERS) {
+		response->status(ResponseStatus::FAILURE_INVALID);
+	} else {
+		if (timeout_ms == 0) {
+			timeout_ms = unicast_timeout_ms(device);
+		}
+
+		if (!requests_.emplace<RegisterReadWriteRequest>(priority, device,
+				FunctionCode::READ_WRITE_MULTIPLE_REGISTERS, timeout_ms,
+				read_address, read_size, write_address, values, write_size,
+				response, callback)) {
+			response->status(ResponseStatus::FAILURE_QUEUE_FULL);
+		}
+	}
+
+	if (response->done()) {
+		callback(*response);
+	}
+
+	return response;
+}
+
+bool BaseClient::coalesce_read(uint8_t function_code, uint16_t device,
+		uint16_t address, uint16_t size,
+		const ResponseHandle<RegisterDataResponse> &response,
+		const ResponseCallback<RegisterDataResponse> &callback,
+		RequestPriority priority) {
+	// Search from the most recent request so that a read is never attached to
+	// an earlier request that would miss the effect of a queued write
+	for (size_t i = requests_.size(); i > 0; i--) {
+		auto &request = requests_[i - 1];
+
+		if (request.device() != device
+				&& request.device() != DeviceAddressType::BROADCAST) {
+			continue;
+		}
+
+		if (request.response().status() != ResponseStatus::QUEUED) {
+			break;
+		}
+
+		if (request.function_code() != function_code) {
+			if (request.function_code() == FunctionCode::READ_HOLDING_REGISTERS
+					|| request.function_code() == FunctionCode::READ_INPUT_REGISTERS) {
+				continue;
+			}
+			break;
+		}
+
+		// Read requests for these function codes are always RegisterRequests
+		auto &read = static_cast<RegisterRequest&>(request);
+
+		// Don't delay the read by attaching it to a request with a lower priority
+		if (address >= read.address()
+				&& address + size <= read.address() + read.data()
+				&& requests_.priority(i - 1) >= priority) {
+			static_cast<RegisterDataResponse&>(read.response()).attach(
+				response, address - read.address(), size, callback);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool BaseClient::coalesce_write(uint16_t device, uint16_t address, uint16_t value,
+		const ResponseHandle<RegisterWriteResponse> &response,
+		const ResponseCallback<RegisterWriteResponse> &callback,
+		RequestPriority priority) {
+	for (size_t i = requests_.size(); i > 0; i--) {
+		auto &request = requests_[i - 1];
+
+		if (request.device() != device
+				&& request.device() != DeviceAddressType::BROADCAST
+				&& device != DeviceAddressType::BROADCAST) {
+			continue;
+		}
+
+		// Only the most recent request to the device can be used, otherwise
+		// the order of requests to the device would change
+		if (request.device() != device
+				|| request.response().status() != ResponseStatus::QUEUED
+				|| requests_.priority(i - 1) < priority
+				|| !request.merge_write(address, value)) {
+			return false;
+		}
+
+		// The register values are set when the request is complete
+		response->address_ = address;
+		static_cast<RegisterDataResponse&>(request.response()).attach(
+			response, 0, 0, callback);
+		return true;
+	}
+
+	return false;
+}
+
 RegisterRequest::RegisterRequest(uint16_t device, uint8_t function_code,
 		uint16_t timeout_ms, uint16_t address, uint16_t data,
-		const std::shared_ptr<Response> &response)
-		: Request(device, function_code, timeout_ms, response),
+		const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback)
+		: Request(device, function_code, timeout_ms, response, callback),
 		address_(address), data_(data) {
 }
 
@@ -113,6 +353,130 @@ uint16_t RegisterRequest::encode(frame_buffer_t &frame) {
 	return 6;
 }
 
+RegisterValuesRequest::RegisterValuesRequest(uint16_t device,
+		uint8_t function_code, uint16_t timeout_ms, uint16_t address,
+		const uint16_t *values, uint16_t size,
+		const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback)
+		: RegisterRequest(device, function_code, timeout_ms, address, size,
+			response, callback), values_(values) {
+}
+
+uint16_t RegisterValuesRequest::encode(frame_buffer_t &frame) {
+	return encode_values(frame, RegisterRequest::encode(frame));
+}
+
+uint16_t RegisterValuesRequest::encode_values(frame_buffer_t &frame, uint16_t len) const {
+	frame[len++] = data() * 2;
+
+	for (uint16_t i = 0; i < data(); i++) {
+		frame[len++] = values_[i] >> 8;
+		frame[len++] = values_[i] & 0xFF;
+	}
+
+	return len;
+}
+
+RegisterReadWriteRequest::RegisterReadWriteRequest(uint16_t device,
+		uint8_t function_code, uint16_t timeout_ms, uint16_t read_address,
+		uint16_t read_size, uint16_t write_address, const uint16_t *values,
+		uint16_t write_size, const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback)
+		: RegisterValuesRequest(device, function_code, timeout_ms,
+			write_address, values, write_size, response, callback),
+		read_address_(read_address), read_size_(read_size) {
+}
+
+RegisterWriteBehindRequest::RegisterWriteBehindRequest(uint16_t device,
+		uint16_t timeout_ms, uint16_t address, uint16_t value,
+		const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback)
+		: Request(device, FunctionCode::WRITE_SINGLE_REGISTER, timeout_ms,
+			response, callback), first_address_(address), address_(address) {
+	values_[0] = value;
+}
+
+uint16_t RegisterWriteBehindRequest::encode(frame_buffer_t &frame) {
+	uint16_t len = Request::encode(frame);
+
+	frame[len++] = address_ >> 8;
+	frame[len++] = address_ & 0xFF;
+
+	if (function_code() == FunctionCode::WRITE_SINGLE_REGISTER) {
+		frame[len++] = values_[0] >> 8;
+		frame[len++] = values_[0] & 0xFF;
+	} else {
+		frame[len++] = size_ >> 8;
+		frame[len++] = size_ & 0xFF;
+		frame[len++] = size_ * 2;
+
+		for (uint16_t i = 0; i < size_; i++) {
+			frame[len++] = values_[i] >> 8;
+			frame[len++] = values_[i] & 0xFF;
+		}
+	}
+
+	return len;
+}
+
+bool RegisterWriteBehindRequest::merge_write(uint16_t address, uint16_t value) {
+	if (address >= address_ && address - address_ < size_) {
+		values_[address - address_] = value;
+		return true;
+	}
+
+	if (size_ == CAPACITY) {
+		return false;
+	}
+
+	if (address == address_ + size_) {
+		values_[size_] = value;
+	} else if (address_ > 0 && address == address_ - 1) {
+		std::copy_backward(values_.begin(), values_.begin() + size_, values_.begin() + size_ + 1);
+		values_[0] = value;
+		address_ = address;
+	} else {
+		return false;
+	}
+
+	size_++;
+	function_code(FunctionCode::WRITE_MULTIPLE_REGISTERS);
+	return true;
+}
+
+void RegisterWriteBehindRequest::complete() {
+	auto &response = static_cast<RegisterWriteResponse&>(this->response());
+
+	if (response.status() != ResponseStatus::SUCCESS) {
+		return;
+	}
+
+	response.address_ = first_address_;
+	response.data_.clear();
+	response.data_.push_back(values_[first_address_ - address_]);
+
+	for (auto *attached = static_cast<RegisterWriteResponse*>(response.attached_.get());
+			attached != nullptr;
+			attached = static_cast<RegisterWriteResponse*>(attached->attached_.get())) {
+		attached->data_.push_back(values_[attached->address_ - address_]);
+	}
+}
+
+uint16_t RegisterReadWriteRequest::encode(frame_buffer_t &frame) {
+	uint16_t len = Request::encode(frame);
+
+	frame[len++] = read_address() >> 8;
+	frame[len++] = read_address() & 0xFF;
+	frame[len++] = read_size() >> 8;
+	frame[len++] = read_size() & 0xFF;
+	frame[len++] = address() >> 8;
+	frame[len++] = address() & 0xFF;
+	frame[len++] = data() >> 8;
+	frame[len++] = data() & 0xFF;
+
+	return encode_values(frame, len);
+}
+
 ResponseStatus RegisterDataResponse::parse(frame_buffer_t &frame, uint16_t len) {
 	if (len < 3) {
 		logger.err(F("Incomplete message for function %02X from device %u, expected 3+ received %u"),
@@ -124,26 +488,84 @@ ResponseStatus RegisterDataResponse::parse(frame_buffer_t &frame, uint16_t len)
 		logger.err(F("Invalid message for function %02X from device %u, byte count %u is not a multiple of 2"),
 			frame[1], frame[0], frame[2]);
 		return ResponseStatus::FAILURE_LENGTH;
+	} else if (frame[2] > RegisterData::CAPACITY * 2) {
+		logger.err(F("Invalid message for function %02X from device %u, byte count %u is too large"),
+			frame[1], frame[0], frame[2]);
+		return ResponseStatus::FAILURE_LENGTH;
 	}
 
 	for (uint16_t i = 0; i < frame[2]; i += 2) {
-		data_.emplace_back((frame[3 + i] << 8) | frame[4 + i]);
+		if (!data_.push_back((frame[3 + i] << 8) | frame[4 + i])) {
+			return ResponseStatus::FAILURE_LENGTH;
+		}
 	}
 
 	return ResponseStatus::SUCCESS;
 }
 
+void RegisterDataResponse::attach(const ResponseHandle<RegisterDataResponse> &response,
+		uint16_t offset, uint16_t size,
+		const ResponseCallback<RegisterDataResponse> &callback) {
+	RegisterDataResponse *last = this;
+
+	while (last->attached_) {
+		last = last->attached_.get();
+	}
+
+	response->attached_offset_ = offset;
+	response->attached_size_ = size;
+	response->attached_callback_ = callback;
+	last->attached_ = response;
+}
+
+void RegisterDataResponse::complete_attached() {
+	ResponseHandle<RegisterDataResponse> next{std::move(attached_)};
+
+	while (next) {
+		auto &response = *next;
+
+		if (status() != ResponseStatus::SUCCESS) {
+			response.exception_code(exception_code());
+			response.status(status());
+		} else if (response.attached_offset_ + response.attached_size_ > data_.size()) {
+			response.status(ResponseStatus::FAILURE_LENGTH);
+		} else {
+			for (uint16_t i = 0; i < response.attached_size_; i++) {
+				response.data_.push_back(data_[response.attached_offset_ + i]);
+			}
+
+			response.status(ResponseStatus::SUCCESS);
+		}
+
+		response.attached_callback_(response);
+		next = std::move(response.attached_);
+	}
+}
+
+uint16_t RegisterDataResponse::expected_length(const frame_buffer_t &frame, uint16_t len) const {
+	if (len < 3) {
+		return 0;
+	}
+
+	return 3 + frame[2];
+}
+
 ResponseStatus RegisterWriteResponse::parse(frame_buffer_t &frame, uint16_t len) {
 	if (!check_length(frame, len, 6)) {
 		return ResponseStatus::FAILURE_LENGTH;
 	}
 
 	address_ = (frame[2] << 8) | frame[3];
-	data_.emplace_back((frame[4] << 8) | frame[5]);
+	data_.push_back((frame[4] << 8) | frame[5]);
 
 	return ResponseStatus::SUCCESS;
 }
 
+uint16_t RegisterWriteResponse::expected_length(const frame_buffer_t &frame __attribute__((unused)),
+		uint16_t len __attribute__((unused))) const {
+	return 6;
+}
+
 } // namespace modbus
 
 } // namespace uuid
@@ -0,0 +1,78 @@
+/*
+ * uuid-modbus - Microcontroller asynchronous Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <uuid/modbus.h>
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace uuid {
+
+namespace modbus {
+
+RequestQueue::RequestQueue() {
+	for (size_t i = 0; i < CAPACITY; i++) {
+		order_[i] = i;
+	}
+}
+
+RequestQueue::~RequestQueue() {
+	while (!empty()) {
+		pop_front();
+	}
+}
+
+void RequestQueue::erase(size_t index) {
+	uint8_t slot = order_[index];
+
+	(*this)[index].~Request();
+	std::copy(order_.begin() + index + 1, order_.begin() + size_, order_.begin() + index);
+	order_[size_ - 1] = slot;
+	size_--;
+}
+
+void RequestQueue::insert(uint8_t slot, RequestPriority priority) {
+	size_t pos = size_;
+
+	// Never overtake requests that are in progress
+	while (pos > 0) {
+		uint8_t previous = order_[pos - 1];
+
+		if (priority_[previous] >= priority || overtaken_[previous] >= MAX_OVERTAKEN
+				|| (*this)[pos - 1].response().status() != ResponseStatus::QUEUED) {
+			break;
+		}
+
+		pos--;
+	}
+
+	for (size_t i = pos; i < size_; i++) {
+		overtaken_[order_[i]]++;
+	}
+
+	std::copy_backward(order_.begin() + pos, order_.begin() + size_, order_.begin() + size_ + 1);
+	order_[pos] = slot;
+	size_++;
+}
+
+} // namespace modbus
+
+} // namespace uuid
@@ -0,0 +1,83 @@
+/*
+ * uuid-modbus - Microcontroller asynchronous Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <uuid/modbus.h>
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstddef>
+#include <functional>
+
+#include <uuid/log.h>
+
+namespace uuid {
+
+namespace modbus {
+
+std::array<ResponsePool::storage_t, ResponsePool::CAPACITY> ResponsePool::responses_;
+std::array<bool, ResponsePool::CAPACITY> ResponsePool::used_{};
+
+size_t ResponsePool::available() {
+	size_t count = 0;
+
+	for (size_t i = 0; i < CAPACITY; i++) {
+		if (!used_[i]) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+void* ResponsePool::allocate() {
+	for (size_t i = 0; i < CAPACITY; i++) {
+		if (!used_[i]) {
+			used_[i] = true;
+			return &responses_[i];
+		}
+	}
+
+	logger.err(F("No responses available"));
+	return nullptr;
+}
+
+void ResponsePool::release(const Response *response) {
+	const void *storage = response;
+	std::less<const void*> before;
+
+	// Pointers to different objects can only be ordered with std::less
+	if (before(storage, &responses_.front()) || before(&responses_.back(), storage)) {
+		return;
+	}
+
+	size_t i = static_cast<const storage_t*>(storage) - responses_.data();
+
+	response->~Response();
+	used_[i] = false;
+}
+
+void Response::release() const {
+	if (--references_ == 0) {
+		ResponsePool::release(this);
+	}
+}
+
+} // namespace modbus
+
+} // namespace uuid
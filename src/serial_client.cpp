@@ -21,9 +21,7 @@
 #include <Arduino.h>
 
 #include <algorithm>
-#include <cstdarg>
 #include <cstdint>
-#include <memory>
 
 #include <uuid/log.h>
 
@@ -31,257 +29,355 @@ namespace uuid {
 
 namespace modbus {
 
-SerialClient::SerialClient(::HardwareSerial &serial) : serial_(serial) {
+SerialClient::SerialClient(::HardwareSerial &serial) : FramedClient(SerialStream{serial}) {
 }
 
-void SerialClient::loop() {
-	if (requests_.empty() || idle_frame_) {
-		idle();
+SerialClient::SerialClient(::HardwareSerial &serial, uint32_t baud_rate,
+		SerialParity parity, uint8_t stop_bits) : FramedClient(SerialStream{serial}) {
+	line_config(baud_rate, parity, stop_bits);
+}
+
+void SerialClient::line_config(uint32_t baud_rate, SerialParity parity,
+		uint8_t stop_bits) {
+	stream_.line_config(baud_rate, parity, stop_bits);
+	min_timeout_margin_us_ = stream_.inter_frame_timeout_us();
+}
+
+AsciiClient::AsciiClient(::HardwareSerial &serial) : FramedClient(SerialStream{serial}) {
+}
+
+AsciiClient::AsciiClient(::HardwareSerial &serial, uint32_t baud_rate,
+		SerialParity parity, uint8_t stop_bits) : FramedClient(SerialStream{serial}) {
+	line_config(baud_rate, parity, stop_bits);
+}
+
+void AsciiClient::line_config(uint32_t baud_rate, SerialParity parity,
+		uint8_t stop_bits) {
+	stream_.line_config(baud_rate, parity, stop_bits);
+	min_timeout_margin_us_ = stream_.inter_frame_timeout_us();
+}
+
+void SerialStream::line_config(uint32_t baud_rate, SerialParity parity,
+		uint8_t stop_bits) {
+	if (baud_rate == 0) {
 		return;
 	}
 
-	auto &response = requests_.front()->response();
+	// Start bit, 8 data bits, optional parity bit and stop bits
+	uint32_t char_bits = 1 + 8 + (parity == SerialParity::NONE ? 0 : 1) + stop_bits;
+
+	character_time_us_ = (char_bits * 1000000UL + baud_rate - 1) / baud_rate;
 
-	if (response.status() == ResponseStatus::QUEUED) {
-		idle();
+	if (baud_rate > FIXED_TIMEOUT_BAUD_RATE) {
+		inter_character_timeout_us_ = MIN_INTER_CHARACTER_TIMEOUT_US;
+		inter_frame_timeout_us_ = MIN_INTER_FRAME_TIMEOUT_US;
+	} else {
+		// 1.5 and 3.5 character times, rounded up
+		inter_character_timeout_us_ = (char_bits * 1500000UL + baud_rate - 1) / baud_rate;
+		inter_frame_timeout_us_ = (char_bits * 3500000UL + baud_rate - 1) / baud_rate;
+	}
+}
 
-		if (idle_frame_) {
-			return;
+size_t SerialStream::read(uint8_t *buffer, size_t length) {
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
+	// Copy directly from the receive buffer
+	return serial_.read(buffer, length);
+#else
+	// Stream::readBytes() waits for each byte with a timeout, which isn't
+	// necessary because the data is already available
+	size_t count = 0;
+
+	while (count < length) {
+		int value = serial_.read();
+
+		if (value < 0) {
+			break;
 		}
 
-		encode();
+		buffer[count++] = value;
 	}
 
-	if (response.status() == ResponseStatus::TRANSMIT) {
-		transmit();
-	}
+	return count;
+#endif
+}
 
-	if (response.status() == ResponseStatus::WAITING) {
-		receive();
-	}
+bool RtuFraming::encode(Request &request, uint16_t transaction __attribute__((unused))) {
+	uint16_t len = request.encode(frame_);
 
-	if (response.done()) {
-		requests_.pop_front();
+	if (len > MAX_MESSAGE_SIZE - MESSAGE_CRC_SIZE) {
+		return false;
 	}
+
+	crc_.reset();
+	crc_.update(frame_.data(), len);
+	frame_[len++] = crc_.value() & 0xFF;
+	frame_[len++] = crc_.value() >> 8;
+
+	tx_pos_ = 0;
+	tx_size_ = len;
+
+	log_frame(F("->"), frame_.data(), len, MESSAGE_CRC_SIZE);
+	return true;
 }
 
-void SerialClient::idle() {
-	uint32_t now_ms = input();
+void RtuFraming::tx_advance(size_t len) {
+	tx_pos_ += len;
 
-	if (frame_pos_ == 0) {
-		return;
-	} else {
-		idle_frame_ = true;
+	if (tx_pos_ == tx_size_) {
+		tx_pos_ = 0;
+		tx_size_ = 0;
 	}
+}
 
-	if (now_ms - last_rx_ms_ >= INTER_FRAME_TIMEOUT_MS) {
-		log_frame(F("<-"));
-		logger.err(F("Received unexpected frame while idle from device %u"), frame_[0]);
-		frame_pos_ = 0;
-		idle_frame_ = false;
+FrameState RtuFraming::rx_advance(size_t len) {
+	if (rx_pos_ == 0) {
+		crc_.reset();
 	}
+
+	// The CRC covers everything except the last two bytes
+	uint16_t crc_start = std::max(rx_pos_, MESSAGE_CRC_SIZE) - MESSAGE_CRC_SIZE;
+
+	rx_pos_ += len;
+
+	uint16_t crc_end = std::max(rx_pos_, MESSAGE_CRC_SIZE) - MESSAGE_CRC_SIZE;
+
+	crc_.update(&frame_[crc_start], crc_end - crc_start);
+	return FrameState::PARTIAL;
 }
 
-void SerialClient::encode() {
-	auto &request = *requests_.front().get();
-	auto &response = request.response();
+bool RtuFraming::rx_complete(const Request &request) const {
+	if (request.device() == DeviceAddressType::BROADCAST
+			|| rx_pos_ < MESSAGE_HEADER_SIZE + MESSAGE_CRC_SIZE
+			|| frame_[0] != request.device()
+			|| (frame_[1] & ~0x80) != request.function_code()) {
+		return false;
+	}
 
-	frame_pos_ = request.encode(frame_);
+	uint16_t len = rx_pos_ - MESSAGE_CRC_SIZE;
+	uint16_t expected;
 
-	if (frame_pos_ > MAX_MESSAGE_SIZE - MESSAGE_CRC_SIZE) {
-		response.status(ResponseStatus::FAILURE_INVALID);
-		return;
+	if (frame_[1] & 0x80) {
+		expected = 3;
+	} else {
+		expected = request.response().expected_length(frame_, len);
 	}
 
-	uint16_t crc = calc_crc();
-	frame_[frame_pos_++] = crc & 0xFF;
-	frame_[frame_pos_++] = crc >> 8;
+	if (expected == 0 || len != expected) {
+		return false;
+	}
 
-	tx_frame_size_ = frame_pos_;
-	response.status(ResponseStatus::TRANSMIT);
+	uint16_t act_crc = (frame_[rx_pos_ - 1] << 8) | frame_[rx_pos_ - 2];
 
-	log_frame(F("->"));
-	frame_pos_ = 0;
+	return act_crc == crc_.value();
 }
 
-void SerialClient::transmit() {
-	while (frame_pos_ < tx_frame_size_) {
-		int available = serial_.availableForWrite();
+ResponseStatus RtuFraming::decode(uint16_t &len, uint16_t &transaction) {
+	len = 0;
+	transaction = 0;
 
-		if (available <= 0) {
-			return;
-		}
+	if (rx_pos_ < MESSAGE_HEADER_SIZE + MESSAGE_CRC_SIZE) {
+		logger.err(F("Received short frame from device %u"), frame_[0]);
+		return ResponseStatus::FAILURE_TOO_SHORT;
+	}
 
-		int len = std::min(available, tx_frame_size_ - frame_pos_);
+	if (rx_pos_ > MAX_MESSAGE_SIZE) {
+		logger.err(F("Received oversized frame from device %u"), frame_[0]);
+		return ResponseStatus::FAILURE_TOO_LONG;
+	}
 
-		serial_.write(&frame_[frame_pos_], len);
-		frame_pos_ += len;
+	uint16_t act_crc = (frame_[rx_pos_ - 1] << 8) | frame_[rx_pos_ - 2];
+	uint16_t exp_crc = crc_.value();
 
-		last_tx_ms_ = ::millis();
+	if (exp_crc != act_crc) {
+		logger.err(F("Received frame with invalid CRC %04X from device %u with function %02X, expected %04X"),
+			act_crc, frame_[0], frame_[1], exp_crc);
+		return ResponseStatus::FAILURE_CRC;
 	}
 
-	frame_pos_ = 0;
-	requests_.front()->response().status(ResponseStatus::WAITING);
+	len = rx_pos_ - MESSAGE_CRC_SIZE;
+	return ResponseStatus::SUCCESS;
 }
 
-uint32_t SerialClient::input() {
-	uint32_t now_ms = ::millis();
-	int data = 0;
+void RtuFraming::rx_log() const {
+	log_frame(F("<-"), frame_.data(), rx_pos_, MESSAGE_CRC_SIZE);
+}
 
-	do {
-		int available = serial_.available();
+bool AsciiFraming::encode(Request &request, uint16_t transaction __attribute__((unused))) {
+	uint16_t len = request.encode(frame_);
 
-		if (available <= 0) {
-			break;
-		}
+	if (len > MAX_MESSAGE_SIZE - MESSAGE_CRC_SIZE) {
+		return false;
+	}
 
-		while (available-- > 0) {
-			data = serial_.read();
+	uint8_t lrc = 0;
 
-			if (data == -1) {
-				break;
-			}
+	for (uint16_t i = 0; i < len; i++) {
+		lrc += frame_[i];
+	}
 
-			if (frame_pos_ < frame_.size()) {
-				frame_[frame_pos_++] = data;
-			}
+	frame_[len++] = static_cast<uint8_t>(-lrc);
 
-			now_ms = ::millis();
-			last_rx_ms_ = now_ms;
-		}
-	} while (data != -1);
+	tx_pos_ = 0;
+	// Start character, 2 characters per byte, CR LF
+	tx_size_ = 1 + 2 * len + 2;
 
-	return now_ms;
+	log_frame(F("->"), frame_.data(), len, MESSAGE_LRC_SIZE);
+	return true;
 }
 
-void SerialClient::receive() {
-	uint32_t now_ms = input();
+uint8_t AsciiFraming::tx_char(uint16_t pos) const {
+	if (pos == 0) {
+		return ':';
+	} else if (pos == tx_size_ - 2) {
+		return '\r';
+	} else if (pos == tx_size_ - 1) {
+		return '\n';
+	} else {
+		pos--;
 
-	if (frame_pos_ == 0) {
-		auto &request = *requests_.front().get();
+		uint8_t value = frame_[pos / 2];
 
-		if ((now_ms - last_tx_ms_) >= request.timeout_ms()) {
-			if (request.device() == DeviceAddressType::BROADCAST) {
-				request.response().status(ResponseStatus::SUCCESS);
-			} else {
-				request.response().status(ResponseStatus::FAILURE_TIMEOUT);
-				logger.notice(F("Timeout waiting for response to function %02X from device %u"),
-					frame_[1], frame_[0]);
-			}
+		if (pos % 2 == 0) {
+			value >>= 4;
+		} else {
+			value &= 0xF;
 		}
-	} else if (now_ms - last_rx_ms_ >= INTER_FRAME_TIMEOUT_MS) {
-		complete();
-		frame_pos_ = 0;
+
+		return value < 10 ? ('0' + value) : ('A' + value - 10);
 	}
 }
 
-void SerialClient::complete() {
-	auto &request = *requests_.front().get();
-	auto &response = request.response();
+const uint8_t *AsciiFraming::tx_data(size_t &len) {
+	len = 0;
 
-	log_frame(F("<-"));
-
-	if (frame_pos_ < MESSAGE_HEADER_SIZE + MESSAGE_CRC_SIZE) {
-		response.status(ResponseStatus::FAILURE_TOO_SHORT);
-		logger.err(F("Received short frame from device %u"), frame_[0]);
-		return;
+	for (uint16_t pos = tx_pos_; pos < tx_size_ && len < tx_chars_.size(); pos++) {
+		tx_chars_[len++] = tx_char(pos);
 	}
 
-	if (frame_pos_ > MAX_MESSAGE_SIZE) {
-		response.status(ResponseStatus::FAILURE_TOO_LONG);
-		logger.err(F("Received oversized frame from device %u"), frame_[0]);
-		return;
-	}
+	return tx_chars_.data();
+}
 
-	uint16_t act_crc = (frame_[frame_pos_ - 1] << 8) | frame_[frame_pos_ - 2];
-	frame_pos_ -= MESSAGE_CRC_SIZE;
-	uint16_t exp_crc = calc_crc();
+void AsciiFraming::tx_advance(size_t len) {
+	tx_pos_ += len;
 
-	if (exp_crc != act_crc) {
-		response.status(ResponseStatus::FAILURE_CRC);
-		logger.err(F("Received frame with invalid CRC %04X from device %u with function %02X, expected %04X"),
-			act_crc, frame_[0], frame_[1], exp_crc);
-		return;
+	if (tx_pos_ == tx_size_) {
+		tx_pos_ = 0;
+		tx_size_ = 0;
 	}
+}
 
-	if (request.device() == DeviceAddressType::BROADCAST) {
-		response.status(ResponseStatus::FAILURE_UNEXPECTED);
-		logger.err(F("Received unexpected broadcast response with function code %02X from device %u"),
-			frame_[1], frame_[0]);
-		return;
-	}
+FrameState AsciiFraming::rx_advance(size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		uint8_t c = rx_chars_[i];
+
+		if (c == ':') {
+			// Start of a new frame (discarding any incomplete frame)
+			rx_pos_ = 1;
+			rx_len_ = 0;
+			rx_lrc_ = 0;
+			rx_nibble_ = false;
+			rx_cr_ = false;
+			rx_end_ = false;
+			rx_error_ = false;
+			continue;
+		}
 
-	if (frame_[0] != request.device()) {
-		response.status(ResponseStatus::FAILURE_ADDRESS);
-		logger.err(F("Received function %02X from device %u, expected device %u"),
-			frame_[1], frame_[0], request.device());
-		return;
-	}
+		if (rx_pos_ == 0) {
+			// Ignore everything before the start of a frame
+			continue;
+		}
 
-	if ((frame_[1] & ~0x80) != request.function_code()) {
-		response.status(ResponseStatus::FAILURE_FUNCTION);
-		logger.err(F("Received function %02X from device %u, expected function %02X"),
-			frame_[1], frame_[0], request.function_code());
-		return;
-	}
+		if (rx_pos_ < UINT16_MAX) {
+			rx_pos_++;
+		}
 
-	if (frame_[1] & 0x80) {
-		if (frame_pos_ < 3) {
-			response.status(ResponseStatus::FAILURE_LENGTH);
-			logger.err(F("Exception with no code for function %02X from device %u"),
-				frame_[1] & ~0x80, frame_[0]);
+		if (c == '\n') {
+			if (!rx_cr_ || rx_nibble_) {
+				rx_error_ = true;
+			}
+
+			rx_end_ = true;
+			return FrameState::COMPLETE;
+		}
+
+		if (rx_cr_) {
+			rx_error_ = true;
+			continue;
+		}
+
+		if (c == '\r') {
+			rx_cr_ = true;
+			continue;
+		}
+
+		uint8_t value;
+
+		if (c >= '0' && c <= '9') {
+			value = c - '0';
+		} else if (c >= 'A' && c <= 'F') {
+			value = c - 'A' + 10;
+		} else if (c >= 'a' && c <= 'f') {
+			value = c - 'a' + 10;
 		} else {
-			response.status(ResponseStatus::EXCEPTION);
-			response.exception_code(frame_[2]);
-			logger.notice(F("Exception code %02X for function %02X from device %u"),
-				response.exception_code(), frame_[1] & ~0x80, frame_[0]);
+			rx_error_ = true;
+			continue;
 		}
-		return;
-	}
 
-	response.status(response.parse(frame_, frame_pos_));
-}
+		if (!rx_nibble_) {
+			rx_value_ = value << 4;
+			rx_nibble_ = true;
+			continue;
+		}
 
-void SerialClient::log_frame(const __FlashStringHelper *prefix) {
-	if (logger.enabled(uuid::log::Level::TRACE)) {
-		static constexpr uint8_t BYTES_PER_LINE = 16;
-		static constexpr uint8_t CHARS_PER_BYTE = 3;
-		std::vector<char> message(CHARS_PER_BYTE * BYTES_PER_LINE + 1);
-		uint8_t pos = 0;
-
-		for (uint16_t i = 0; i < frame_pos_; i++) {
-			snprintf_P(&message[CHARS_PER_BYTE * pos++], CHARS_PER_BYTE + 1,
-				PSTR("%c%02X"),
-				(i == MESSAGE_HEADER_SIZE || i == frame_pos_ - MESSAGE_CRC_SIZE)
-					? '\'' : ' ',
-				frame_[i]);
-
-			if (pos == BYTES_PER_LINE || i == frame_pos_ - 1) {
-				logger.trace(F("%S%s"), prefix, message.data());
-				pos = 0;
-				prefix = F("  ");
-			}
+		rx_nibble_ = false;
+		value |= rx_value_;
+		rx_lrc_ += value;
+
+		if (rx_len_ < frame_.size()) {
+			frame_[rx_len_++] = value;
+		} else {
+			// Too long, but keep reading until the end of the frame
+			rx_len_ = frame_.size() + 1;
 		}
 	}
+
+	return FrameState::PARTIAL;
 }
 
-uint16_t SerialClient::calc_crc() const {
-	uint16_t crc = 0xFFFF;
+ResponseStatus AsciiFraming::decode(uint16_t &len, uint16_t &transaction) {
+	len = 0;
+	transaction = 0;
 
-	for (uint16_t i = 0; i < frame_pos_; i++) {
-		crc = crc ^ frame_[i];
+	if (!rx_end_ || rx_len_ < MESSAGE_HEADER_SIZE + MESSAGE_LRC_SIZE) {
+		logger.err(F("Received short frame from device %u"), rx_len_ > 0 ? frame_[0] : 0);
+		return ResponseStatus::FAILURE_TOO_SHORT;
+	}
 
-		for (uint8_t b = 0; b < 8; b++) {
-			if (crc & 0x0001) {
-				crc >>= 1;
-				crc ^= 0xA001;
-			} else {
-				crc >>= 1;
-			}
-		}
+	if (rx_len_ > MAX_MESSAGE_SIZE) {
+		logger.err(F("Received oversized frame from device %u"), frame_[0]);
+		return ResponseStatus::FAILURE_TOO_LONG;
 	}
 
-	return crc;
+	if (rx_error_) {
+		logger.err(F("Received frame with invalid characters from device %u with function %02X"),
+			frame_[0], frame_[1]);
+		return ResponseStatus::FAILURE_CRC;
+	}
+
+	if (rx_lrc_ != 0) {
+		uint8_t act_lrc = frame_[rx_len_ - 1];
+
+		logger.err(F("Received frame with invalid LRC %02X from device %u with function %02X, expected %02X"),
+			act_lrc, frame_[0], frame_[1], static_cast<uint8_t>(act_lrc - rx_lrc_));
+		return ResponseStatus::FAILURE_CRC;
+	}
+
+	len = rx_len_ - MESSAGE_LRC_SIZE;
+	return ResponseStatus::SUCCESS;
+}
+
+void AsciiFraming::rx_log() const {
+	log_frame(F("<-"), frame_.data(), std::min(rx_len_, static_cast<uint16_t>(frame_.size())), MESSAGE_LRC_SIZE);
 }
 
 } // namespace modbus
@@ -0,0 +1,111 @@
+/*
+ * uuid-modbus - Microcontroller asynchronous Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <uuid/modbus.h>
+
+#include <Arduino.h>
+
+#include <cstdint>
+
+#include <uuid/log.h>
+
+namespace uuid {
+
+namespace modbus {
+
+TcpClient::TcpClient(::Client &client) : FramedClient(NetworkStream{client}) {
+}
+
+RtuTcpClient::RtuTcpClient(::Client &client) : FramedClient(NetworkStream{client}) {
+}
+
+void TcpClient::window(uint8_t window) {
+	if (window < 1) {
+		window_ = 1;
+	} else if (window > MAX_WINDOW) {
+		window_ = MAX_WINDOW;
+	} else {
+		window_ = window;
+	}
+}
+
+bool MbapFraming::encode(Request &request, uint16_t transaction) {
+	uint16_t len = request.encode(tx_frame_);
+
+	if (len > MAX_MESSAGE_SIZE - MESSAGE_CRC_SIZE) {
+		return false;
+	}
+
+	tx_header_[0] = transaction >> 8;
+	tx_header_[1] = transaction & 0xFF;
+	tx_header_[2] = 0; // Protocol identifier
+	tx_header_[3] = 0;
+	tx_header_[4] = len >> 8;
+	tx_header_[5] = len & 0xFF;
+
+	tx_pos_ = 0;
+	tx_size_ = HEADER_SIZE + len;
+
+	log_frame(F("->"), tx_frame_.data(), len);
+	return true;
+}
+
+void MbapFraming::tx_advance(size_t len) {
+	tx_pos_ += len;
+
+	if (tx_pos_ == tx_size_) {
+		tx_pos_ = 0;
+		tx_size_ = 0;
+	}
+}
+
+FrameState MbapFraming::rx_advance(size_t len) {
+	rx_pos_ += len;
+
+	if (rx_pos_ == HEADER_SIZE) {
+		uint16_t protocol = (rx_header_[2] << 8) | rx_header_[3];
+		uint16_t length = (rx_header_[4] << 8) | rx_header_[5];
+
+		if (protocol != 0 || length < MESSAGE_HEADER_SIZE
+				|| length > MAX_MESSAGE_SIZE - MESSAGE_CRC_SIZE) {
+			logger.err(F("Received invalid MBAP header with protocol %04X and length %u"),
+				protocol, length);
+			return FrameState::INVALID;
+		}
+
+		rx_size_ = HEADER_SIZE + length;
+	} else if (rx_pos_ == rx_size_) {
+		return FrameState::COMPLETE;
+	}
+
+	return FrameState::PARTIAL;
+}
+
+ResponseStatus MbapFraming::decode(uint16_t &len, uint16_t &transaction) {
+	len = rx_size_ - HEADER_SIZE;
+	transaction = (rx_header_[0] << 8) | rx_header_[1];
+	return ResponseStatus::SUCCESS;
+}
+
+void MbapFraming::rx_log() const {
+	log_frame(F("<-"), rx_frame_.data(), rx_size_ - HEADER_SIZE);
+}
+
+} // namespace modbus
+
+} // namespace uuid
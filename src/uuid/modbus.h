@@ -20,13 +20,16 @@
 #define UUID_MODBUS_H_
 
 #include <Arduino.h>
+#include <Client.h>
 
+#include <algorithm>
 #include <cstdarg>
+#include <cstddef>
 #include <cstdint>
 #include <array>
-#include <deque>
-#include <memory>
-#include <vector>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 #include <uuid/log.h>
 
@@ -47,8 +50,12 @@ namespace modbus {
 constexpr uint16_t MAX_MESSAGE_SIZE = 256; /*!< Maximum size of a message. @since 0.1.0 */
 constexpr uint16_t MESSAGE_HEADER_SIZE = 2; /*!< Size of message header (device address and function code). @since 0.1.2 */
 constexpr uint16_t MESSAGE_CRC_SIZE = 2; /*!< Size of message CRC. @since 0.1.2 */
+constexpr uint16_t MESSAGE_LRC_SIZE = 1; /*!< Size of message LRC (Modbus ASCII). @since 0.3.0 */
+constexpr uint16_t MBAP_HEADER_SIZE = 7; /*!< Size of Modbus TCP MBAP header (including the unit identifier). @since 0.3.0 */
+constexpr uint16_t DEFAULT_TCP_PORT = 502; /*!< Default port for Modbus TCP. @since 0.3.0 */
 /**
- * Timeout between frames (in milliseconds).
+ * Timeout between frames (in milliseconds) when the line configuration is
+ * not known.
  *
  * 9600 bps: 4ms
  * 19200 bps: 2ms
@@ -59,13 +66,153 @@ constexpr uint16_t MESSAGE_CRC_SIZE = 2; /*!< Size of message CRC. @since 0.1.2
  * @since 0.1.0
  */
 constexpr uint32_t INTER_FRAME_TIMEOUT_MS = 5;
+constexpr uint32_t FIXED_TIMEOUT_BAUD_RATE = 19200; /*!< Baud rate above which fixed inter-character and inter-frame timeouts are used. @since 0.3.0 */
+constexpr uint32_t MIN_INTER_CHARACTER_TIMEOUT_US = 750; /*!< Inter-character timeout (in microseconds) for baud rates above FIXED_TIMEOUT_BAUD_RATE. @since 0.3.0 */
+constexpr uint32_t MIN_INTER_FRAME_TIMEOUT_US = 1750; /*!< Inter-frame timeout (in microseconds) for baud rates above FIXED_TIMEOUT_BAUD_RATE. @since 0.3.0 */
 constexpr uint16_t DEFAULT_UNICAST_TIMEOUT_MS = 10000; /*!< Default time to wait for a unicast response (in milliseconds). @since 0.2.0 */
 constexpr uint16_t DEFAULT_BROADCAST_TIMEOUT_MS = 1000; /*!< Default time to wait after a broadcast request (in milliseconds). @since 0.2.0 */
+constexpr uint16_t MAX_READ_REGISTERS = 125; /*!< Maximum number of registers in a read request. @since 0.3.0 */
+constexpr uint32_t MAX_READ_BLOCK_REGISTERS = 0x10000; /*!< Maximum number of registers in a block read (split into multiple requests). @since 0.3.0 */
+constexpr uint16_t MAX_WRITE_REGISTERS = 123; /*!< Maximum number of registers in a write request. @since 0.3.0 */
+constexpr uint16_t MAX_READ_WRITE_REGISTERS = 121; /*!< Maximum number of registers to write in a read/write request. @since 0.3.0 */
+constexpr uint16_t MAX_READ_BITS = 2000; /*!< Maximum number of coils or discrete inputs in a read request. @since 0.3.0 */
+constexpr uint16_t MAX_WRITE_BITS = 1968; /*!< Maximum number of coils in a write request. @since 0.3.0 */
 
 extern const uuid::log::Logger logger; /*!< uuid::log::Logger instance for Modbus library. @since 0.1.0 */
 
 using frame_buffer_t = std::array<uint8_t, MAX_MESSAGE_SIZE + 1>; /*!< Buffer for receiving frames. @since 0.1.0 */
 
+/**
+ * Log the contents of a message frame.
+ *
+ * @param[in] prefix Message prefix ("<-" or "->").
+ * @param[in] frame Message frame buffer, starting with the device address.
+ * @param[in] len Size of message frame.
+ * @param[in] trailer_size Size of the checksum at the end of the message
+ *                         frame.
+ * @since 0.3.0
+ */
+void log_frame(const __FlashStringHelper *prefix, const uint8_t *frame,
+	uint16_t len, uint16_t trailer_size = 0);
+
+#ifndef UUID_MODBUS_CRC_TABLE_SIZE
+/**
+ * Number of entries in the CRC lookup table.
+ *
+ * 256: One lookup per byte (512 bytes of flash).
+ * 16: Two lookups per byte (32 bytes of flash).
+ *
+ * @since 0.3.0
+ */
+# define UUID_MODBUS_CRC_TABLE_SIZE 256
+#endif
+
+#ifndef UUID_MODBUS_REQUEST_QUEUE_SIZE
+/**
+ * Maximum number of requests that can be queued.
+ *
+ * @since 0.3.0
+ */
+# define UUID_MODBUS_REQUEST_QUEUE_SIZE 16
+#endif
+
+#ifndef UUID_MODBUS_RESPONSE_POOL_SIZE
+/**
+ * Maximum number of response objects that can exist at the same time.
+ *
+ * @since 0.3.0
+ */
+# define UUID_MODBUS_RESPONSE_POOL_SIZE (UUID_MODBUS_REQUEST_QUEUE_SIZE + 4)
+#endif
+
+#ifndef UUID_MODBUS_DEVICE_TABLE_SIZE
+/**
+ * Maximum number of devices to keep response time estimates for.
+ *
+ * @since 0.3.0
+ */
+# define UUID_MODBUS_DEVICE_TABLE_SIZE 8
+#endif
+
+#ifndef UUID_MODBUS_WRITE_BEHIND_REGISTERS
+/**
+ * Maximum number of adjacent holding register writes that can be combined
+ * into one request in write-behind mode.
+ *
+ * @since 0.3.0
+ */
+# define UUID_MODBUS_WRITE_BEHIND_REGISTERS 8
+#endif
+
+#ifndef UUID_MODBUS_TCP_WINDOW_SIZE
+/**
+ * Maximum number of transactions that can be outstanding at the same time on
+ * a TCP client.
+ *
+ * @since 0.3.0
+ */
+# define UUID_MODBUS_TCP_WINDOW_SIZE 4
+#endif
+
+/**
+ * CRC-16/MODBUS calculation.
+ *
+ * Uses a lookup table generated at compile time, the size of which is
+ * configured with UUID_MODBUS_CRC_TABLE_SIZE.
+ *
+ * @since 0.3.0
+ */
+class CRC16 {
+public:
+	static constexpr uint16_t INITIAL = 0xFFFF; /*!< Initial CRC value. @since 0.3.0 */
+	static constexpr uint16_t POLYNOMIAL = 0xA001; /*!< CRC polynomial (reversed). @since 0.3.0 */
+
+	/**
+	 * Calculate the CRC of a buffer.
+	 *
+	 * @param[in] data Data to process.
+	 * @param[in] len Length of data.
+	 * @return CRC value.
+	 * @since 0.3.0
+	 */
+	static uint16_t calculate(const uint8_t *data, size_t len);
+
+	/**
+	 * Get the current CRC value.
+	 *
+	 * @return CRC value.
+	 * @since 0.3.0
+	 */
+	inline uint16_t value() const { return value_; }
+
+	/**
+	 * Reset the CRC to its initial value.
+	 *
+	 * @since 0.3.0
+	 */
+	inline void reset() { value_ = INITIAL; }
+
+	/**
+	 * Update the CRC with one byte of data.
+	 *
+	 * @param[in] data Data to process.
+	 * @since 0.3.0
+	 */
+	void update(uint8_t data);
+
+	/**
+	 * Update the CRC with a buffer of data.
+	 *
+	 * @param[in] data Data to process.
+	 * @param[in] len Length of data.
+	 * @since 0.3.0
+	 */
+	void update(const uint8_t *data, size_t len);
+
+private:
+	uint16_t value_ = INITIAL; /*!< Current CRC value. @since 0.3.0 */
+};
+
 /**
  * Device address types.
  *
@@ -79,16 +226,59 @@ enum DeviceAddressType : uint8_t {
 	MAX_UNICAST = 247, /*!< Maximum device address. @since 0.1.0 */
 };
 
+/**
+ * Serial line parity.
+ *
+ * @since 0.3.0
+ */
+enum SerialParity : uint8_t {
+	NONE, /*!< No parity bit. @since 0.3.0 */
+	EVEN, /*!< Even parity. @since 0.3.0 */
+	ODD, /*!< Odd parity. @since 0.3.0 */
+};
+
 /**
  * Function codes.
  *
  * @since 0.1.0
  */
 enum FunctionCode : uint8_t {
+	READ_COILS = 0x01, /*!< Read coils. @since 0.3.0 */
+	READ_DISCRETE_INPUTS = 0x02, /*!< Read discrete inputs. @since 0.3.0 */
 	READ_HOLDING_REGISTERS = 0x03, /*!< Read holding registers. @since 0.1.0 */
 	READ_INPUT_REGISTERS = 0x04, /*!< Read input registers. @since 0.1.0 */
+	WRITE_SINGLE_COIL = 0x05, /*!< Write single coil. @since 0.3.0 */
 	WRITE_SINGLE_REGISTER = 0x06, /*!< Write single register. @since 0.1.0 */
 	READ_EXCEPTION_STATUS = 0x07, /*!< Read exception status. @since 0.1.0 */
+	WRITE_MULTIPLE_COILS = 0x0F, /*!< Write multiple coils. @since 0.3.0 */
+	WRITE_MULTIPLE_REGISTERS = 0x10, /*!< Write multiple registers. @since 0.3.0 */
+	READ_WRITE_MULTIPLE_REGISTERS = 0x17, /*!< Read/write multiple registers. @since 0.3.0 */
+};
+
+/**
+ * Priority classes of requests.
+ *
+ * Requests are sent in order of priority and then in the order that they were
+ * queued. A request that has been overtaken by RequestQueue::MAX_OVERTAKEN
+ * requests with a higher priority will not be overtaken again.
+ *
+ * @since 0.3.0
+ */
+enum RequestPriority : uint8_t {
+	BULK, /*!< Background requests (e.g. telemetry). @since 0.3.0 */
+	INTERACTIVE, /*!< Requests from a user interface. @since 0.3.0 */
+	CONTROL, /*!< Control requests that must be sent as soon as possible. @since 0.3.0 */
+};
+
+/**
+ * States of the circuit breaker for a device.
+ *
+ * @since 0.3.0
+ */
+enum CircuitState : uint8_t {
+	CLOSED, /*!< Requests are sent to the device. @since 0.3.0 */
+	OPEN, /*!< Requests fail without being sent until it is time to retry. @since 0.3.0 */
+	HALF_OPEN, /*!< Requests are sent one at a time to check if the device is available again. @since 0.3.0 */
 };
 
 /**
@@ -111,553 +301,4410 @@ enum ResponseStatus : uint8_t {
 	FAILURE_FUNCTION, /*!< Unexpected function code in response. @since 0.1.0 */
 	FAILURE_LENGTH, /*!< Incorrect response length. @since 0.1.0 */
 	FAILURE_UNEXPECTED, /*!< Received a response to broadcast request. @since 0.1.0 */
+	FAILURE_QUEUE_FULL, /*!< Request queue is full. @since 0.3.0 */
+	FAILURE_POOL_EXHAUSTED, /*!< No response objects available. @since 0.3.0 */
+	FAILURE_CANCELLED, /*!< Request cancelled before it was transmitted. @since 0.3.0 */
+	FAILURE_EXPIRED, /*!< Request waited in the queue for too long. @since 0.3.0 */
+	FAILURE_UNAVAILABLE, /*!< Device is not responding (circuit breaker is open). @since 0.3.0 */
+	FAILURE_DISCONNECTED, /*!< Connection closed before the response was received. @since 0.3.0 */
 };
 
 /**
- * Response message.
+ * State of a message frame being received.
  *
- * This will be created when a request is submitted and then later updated with
- * the outcome. Poll the status() of the response to know when to access data.
+ * @since 0.3.0
+ */
+enum FrameState : uint8_t {
+	PARTIAL, /*!< More data is needed (or the end of the frame is not marked). @since 0.3.0 */
+	COMPLETE, /*!< Message frame has been received. @since 0.3.0 */
+	INVALID, /*!< Message frame is invalid and the start of the next frame can't be found. @since 0.3.0 */
+};
+
+//! @cond false
+template<typename... Types>
+struct MaxSizeOf;
+
+template<typename T>
+struct MaxSizeOf<T> {
+	static constexpr size_t size = sizeof(T);
+	static constexpr size_t align = alignof(T);
+};
+
+template<typename T, typename... Types>
+struct MaxSizeOf<T, Types...> {
+	static constexpr size_t size = sizeof(T) > MaxSizeOf<Types...>::size
+		? sizeof(T) : MaxSizeOf<Types...>::size;
+	static constexpr size_t align = alignof(T) > MaxSizeOf<Types...>::align
+		? alignof(T) : MaxSizeOf<Types...>::align;
+};
+//! @endcond
+
+class BaseClient;
+class Response;
+
+/**
+ * Reference counted handle to a response message.
  *
- * @since 0.1.0
+ * Behaves like a std::shared_ptr but uses a (non-atomic) reference count
+ * stored in the response. When the last handle is released the response is
+ * returned to the ResponsePool.
+ *
+ * @tparam T Type of response.
+ * @since 0.3.0
  */
-class Response {
+template<typename T>
+class ResponseHandle {
 public:
-	virtual ~Response() = default;
+	/**
+	 * Create an empty handle.
+	 *
+	 * @since 0.3.0
+	 */
+	ResponseHandle() = default;
 
 	/**
-	 * Determine if the request is complete.
+	 * Create an empty handle.
 	 *
-	 * @return True if the request is finished, otherwise false.
-	 * @since 0.1.0
+	 * @since 0.3.0
 	 */
-	inline bool done() const { return status_ >= ResponseStatus::SUCCESS; }
+	ResponseHandle(std::nullptr_t) {}
 
 	/**
-	 * Determine if the request is still pending.
+	 * Create a handle to a response.
 	 *
-	 * @return True if the request is in progress, otherwise false.
-	 * @since 0.1.0
+	 * @param[in] response Response object.
+	 * @since 0.3.0
 	 */
-	inline bool pending() const { return status_ < ResponseStatus::SUCCESS; }
+	explicit ResponseHandle(T *response) : response_(response) { acquire(); }
 
 	/**
-	 * Determine if the request was successful.
+	 * Copy a handle to a response.
 	 *
-	 * @return True if the request was successful, otherwise false.
-	 * @since 0.1.0
+	 * @param[in] other Handle to copy.
+	 * @since 0.3.0
 	 */
-	bool success() const { return status_ == ResponseStatus::SUCCESS; }
+	ResponseHandle(const ResponseHandle &other) : response_(other.response_) { acquire(); }
 
 	/**
-	 * Determine if the request returned an exception.
+	 * Copy a handle to a response of a compatible type.
 	 *
-	 * @return True if the request returned an exception, otherwise false.
-	 * @since 0.1.0
+	 * @tparam U Type of response.
+	 * @param[in] other Handle to copy.
+	 * @since 0.3.0
 	 */
-	bool exception() const { return status_ == ResponseStatus::EXCEPTION; }
+	template<typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+	ResponseHandle(const ResponseHandle<U> &other) : response_(other.get()) { acquire(); }
 
 	/**
-	 * Determine if the request failed for a reason other than an exception.
+	 * Move a handle to a response.
 	 *
-	 * @return True if the request failed (without receiving an exception),
-	 *         otherwise false.
-	 * @since 0.1.0
+	 * @param[in] other Handle to move.
+	 * @since 0.3.0
 	 */
-	bool failed() const { return status_ > ResponseStatus::EXCEPTION; }
+	ResponseHandle(ResponseHandle &&other) : response_(other.response_) { other.response_ = nullptr; }
+
+	~ResponseHandle() { release(); }
 
 	/**
-	 * Get the status of the response message.
+	 * Replace the response referenced by this handle.
 	 *
-	 * @return Status of the response message.
-	 * @since 0.1.0
+	 * @param[in] other Handle to copy.
+	 * @return Reference to this handle.
+	 * @since 0.3.0
 	 */
-	inline ResponseStatus status() const { return status_; }
+	ResponseHandle& operator=(ResponseHandle other) {
+		std::swap(response_, other.response_);
+		return *this;
+	}
 
 	/**
-	 * Set the status of the response message.
+	 * Release the response referenced by this handle.
 	 *
-	 * @param[in] status Status of the response message.
-	 * @since 0.1.0
+	 * @since 0.3.0
 	 */
-	inline void status(ResponseStatus status) { status_ = status; }
+	void reset() {
+		release();
+		response_ = nullptr;
+	}
 
 	/**
-	 * Get the exception code from the device response.
+	 * Get the response referenced by this handle.
 	 *
-	 * Valid only if the status() is ResponseStatus::EXCEPTION or exception()
-	 * returns true.
+	 * @return Response object (or nullptr if the handle is empty).
+	 * @since 0.3.0
+	 */
+	inline T* get() const { return response_; }
+
+	/**
+	 * Get the number of handles referencing the response.
 	 *
-	 * @return Exception code from the device response.
-	 * @since 0.1.0
+	 * @return Number of handles (or 0 if the handle is empty).
+	 * @since 0.3.0
 	 */
-	inline uint8_t exception_code() const { return exception_code_; }
+	inline size_t use_count() const { return response_ ? response_->references_ : 0; }
+
+	inline T& operator*() const { return *response_; } /*!< Dereference the response. @since 0.3.0 */
+	inline T* operator->() const { return response_; } /*!< Dereference the response. @since 0.3.0 */
+	inline explicit operator bool() const { return response_ != nullptr; } /*!< Check if the handle is not empty. @since 0.3.0 */
+
+private:
+	inline void acquire() {
+		if (response_) {
+			response_->acquire();
+		}
+	}
+
+	inline void release() {
+		if (response_) {
+			response_->release();
+		}
+	}
+
+	T *response_ = nullptr; /*!< Response object. @since 0.3.0 */
+};
+
+/**
+ * Compare two response handles.
+ *
+ * @return True if both handles reference the same response, otherwise false.
+ * @since 0.3.0
+ */
+template<typename T, typename U>
+inline bool operator==(const ResponseHandle<T> &a, const ResponseHandle<U> &b) { return a.get() == b.get(); }
+
+/**
+ * Compare two response handles.
+ *
+ * @return True if the handles reference different responses, otherwise false.
+ * @since 0.3.0
+ */
+template<typename T, typename U>
+inline bool operator!=(const ResponseHandle<T> &a, const ResponseHandle<U> &b) { return a.get() != b.get(); }
+
+/**
+ * Check if a response handle is empty.
+ *
+ * @return True if the handle is empty, otherwise false.
+ * @since 0.3.0
+ */
+template<typename T>
+inline bool operator==(const ResponseHandle<T> &a, std::nullptr_t) { return !a; }
 
+/**
+ * Check if a response handle is not empty.
+ *
+ * @return True if the handle is not empty, otherwise false.
+ * @since 0.3.0
+ */
+template<typename T>
+inline bool operator!=(const ResponseHandle<T> &a, std::nullptr_t) { return !!a; }
+
+/**
+ * Completion callback for a response.
+ *
+ * Stores a copy of a small function object (e.g. a function pointer or a
+ * lambda that captures no more than two pointers) without any memory
+ * allocation. The function object must be trivially copyable.
+ *
+ * @tparam T Type of response.
+ * @since 0.3.0
+ */
+template<typename T>
+class ResponseCallback {
+public:
 	/**
-	 * Set the exception code from the device response.
+	 * Maximum size of a function object.
 	 *
-	 * Valid only if the status() is ResponseStatus::EXCEPTION or exception()
-	 * returns true.
+	 * @since 0.3.0
+	 */
+	static constexpr size_t MAX_SIZE = 2 * sizeof(void*);
+
+	/**
+	 * Create an empty callback.
 	 *
-	 * @param[in] exception_code Exception code from the device response.
-	 * @since 0.1.0
+	 * @since 0.3.0
 	 */
-	inline void exception_code(uint8_t exception_code) { exception_code_ = exception_code; }
+	ResponseCallback() = default;
 
 	/**
-	 * Parse a message frame buffer and store the outcome in this response.
+	 * Create an empty callback.
 	 *
-	 * @param[in] frame Message frame buffer.
-	 * @param[in] len Size of message frame.
-	 * @return The status result of message parsing.
-	 * @since 0.1.0
+	 * @since 0.3.0
 	 */
-	virtual ResponseStatus parse(frame_buffer_t &frame, uint16_t len) = 0;
+	ResponseCallback(std::nullptr_t) {}
 
-protected:
-	Response() = default;
+	/**
+	 * Create a callback that calls a function object.
+	 *
+	 * @tparam Function Type of function object, callable as `void(const T&)`.
+	 * @param[in] function Function object to copy.
+	 * @since 0.3.0
+	 */
+	template<typename Function, typename = typename std::enable_if<
+		!std::is_base_of<ResponseCallback, Function>::value,
+		decltype(std::declval<const Function&>()(std::declval<const T&>()))>::type>
+	ResponseCallback(Function function) : invoke_(&invoke<Function>) {
+		static_assert(sizeof(Function) <= sizeof(storage_t), "Callback function object too large");
+		static_assert(alignof(Function) <= alignof(storage_t), "Callback function object alignment too large");
+		static_assert(std::is_trivially_copyable<Function>::value, "Callback function object must be trivially copyable");
+
+		new (&function_) Function(function);
+	}
 
 	/**
-	 * Check the length of the message frame is correct and log an error if it
-	 * is not.
+	 * Copy a callback for a more specific type of response.
 	 *
-	 * @param[in] frame Message frame buffer.
-	 * @param[in] actual Actual length of the message frame.
-	 * @param[in] expected Expected length of the message frame.
-	 * @return True if the message frame length matches, otherwise false.
-	 * @since 0.1.0
+	 * @tparam U Type of response.
+	 * @param[in] other Callback to copy.
+	 * @since 0.3.0
 	 */
-	bool check_length(frame_buffer_t &frame, uint16_t actual, uint16_t expected);
+	template<typename U, typename = typename std::enable_if<std::is_base_of<T, U>::value>::type>
+	ResponseCallback(const ResponseCallback<U> &other)
+		: function_(other.function_), invoke_(other.invoke_) {}
+
+	/**
+	 * Call the function object (if there is one).
+	 *
+	 * @param[in] response Completed response.
+	 * @since 0.3.0
+	 */
+	void operator()(const T &response) const {
+		if (invoke_) {
+			invoke_(&function_, response);
+		}
+	}
+
+	/**
+	 * Check if there is a function object.
+	 *
+	 * @return True if there is a function object, otherwise false.
+	 * @since 0.3.0
+	 */
+	explicit inline operator bool() const { return invoke_ != nullptr; }
 
 private:
-	ResponseStatus status_ = ResponseStatus::QUEUED; /*!< Status of response message. @since 0.1.0 */
-	uint8_t exception_code_ = 0; /*!< Device exception response. @since 0.1.0 */
+	template<typename U> friend class ResponseCallback;
+
+	/**
+	 * Storage for a function object.
+	 *
+	 * @since 0.3.0
+	 */
+	using storage_t = typename std::aligned_storage<MAX_SIZE, alignof(void*)>::type;
+
+	/**
+	 * Call a function object of a specific type.
+	 *
+	 * The response is always of type T (or derived from it) even though the
+	 * callback may have been converted to a less specific type of response.
+	 *
+	 * @tparam Function Type of function object.
+	 * @param[in] function Function object storage.
+	 * @param[in] response Completed response.
+	 * @since 0.3.0
+	 */
+	template<typename Function>
+	static void invoke(const void *function, const Response &response) {
+		(*static_cast<const Function*>(function))(static_cast<const T&>(response));
+	}
+
+	storage_t function_; /*!< Copy of function object. @since 0.3.0 */
+	void (*invoke_)(const void *function, const Response &response) = nullptr; /*!< Function to call the function object. @since 0.3.0 */
 };
 
 /**
- * Register data response message.
+ * Register values.
  *
- * This will be created when a request is submitted and then later updated with
- * the outcome. Poll the status() of the response to know when to access data.
+ * Stored inline with enough capacity for the largest response.
  *
- * @since 0.1.0
+ * @since 0.3.0
  */
-class RegisterDataResponse: public Response {
+class RegisterData {
 public:
+	static constexpr size_t CAPACITY = MAX_READ_REGISTERS; /*!< Maximum number of register values. @since 0.3.0 */
+
 	/**
-	 * Data from the device response, which may be fewer or more register values
-	 * than requested.
+	 * Get the number of register values.
 	 *
-	 * Valid only if the status() is ResponseStatus::SUCCESS.
+	 * @return Number of register values.
+	 * @since 0.3.0
+	 */
+	inline size_t size() const { return size_; }
+
+	/**
+	 * Determine if there are no register values.
 	 *
-	 * @return A reference to the data in the response.
-	 * @since 0.1.0
+	 * @return True if there are no register values, otherwise false.
+	 * @since 0.3.0
 	 */
-	inline const std::vector<uint16_t>& data() const { return data_; };
+	inline bool empty() const { return size_ == 0; }
 
 	/**
-	 * Parse a message frame buffer and store the outcome in this response.
+	 * Get a register value.
 	 *
-	 * @param[in] frame Message frame buffer.
-	 * @param[in] len Size of message frame.
-	 * @return The status result of message parsing.
-	 * @since 0.1.0
+	 * @param[in] index Position of the register value.
+	 * @return Register value.
+	 * @since 0.3.0
 	 */
-	ResponseStatus parse(frame_buffer_t &frame, uint16_t len) override;
+	inline uint16_t operator[](size_t index) const { return values_[index]; }
 
-protected:
-	std::vector<uint16_t> data_; /*!< Data from device response. @since 0.1.0 */
+	inline const uint16_t* data() const { return values_.data(); } /*!< Get the register values. @since 0.3.0 */
+	inline const uint16_t* begin() const { return values_.data(); } /*!< Get an iterator to the first register value. @since 0.3.0 */
+	inline const uint16_t* end() const { return values_.data() + size_; } /*!< Get an iterator past the last register value. @since 0.3.0 */
+
+	/**
+	 * Append a register value.
+	 *
+	 * @param[in] value Register value.
+	 * @return True if the value was added, false if there is no more space.
+	 * @since 0.3.0
+	 */
+	inline bool push_back(uint16_t value) {
+		if (size_ < CAPACITY) {
+			values_[size_++] = value;
+			return true;
+		} else {
+			return false;
+		}
+	}
+
+	/**
+	 * Remove all of the register values.
+	 *
+	 * @since 0.3.0
+	 */
+	inline void clear() { size_ = 0; }
+
+private:
+	std::array<uint16_t, CAPACITY> values_; /*!< Register values. @since 0.3.0 */
+	uint8_t size_ = 0; /*!< Number of register values. @since 0.3.0 */
 };
 
 /**
- * Register write response message.
+ * Coil or discrete input values.
+ *
+ * Stored inline, packed 8 bits per byte (least significant bit first) as
+ * received from the device, with enough capacity for the largest response.
+ *
+ * @since 0.3.0
+ */
+class BitData {
+public:
+	static constexpr size_t CAPACITY = (MAX_READ_BITS + 7) / 8; /*!< Maximum number of bytes of values. @since 0.3.0 */
+
+	/**
+	 * Iterator over coil or discrete input values.
+	 *
+	 * @since 0.3.0
+	 */
+	class const_iterator {
+	public:
+		/**
+		 * Create an iterator.
+		 *
+		 * @param[in] data Values to iterate over.
+		 * @param[in] index Position of the value.
+		 * @since 0.3.0
+		 */
+		const_iterator(const BitData &data, size_t index) : data_(data), index_(index) {}
+
+		inline bool operator*() const { return data_[index_]; } /*!< Get the current value. @since 0.3.0 */
+		inline const_iterator& operator++() { index_++; return *this; } /*!< Move to the next value. @since 0.3.0 */
+		inline bool operator==(const const_iterator &other) const { return index_ == other.index_; } /*!< Compare iterator positions. @since 0.3.0 */
+		inline bool operator!=(const const_iterator &other) const { return index_ != other.index_; } /*!< Compare iterator positions. @since 0.3.0 */
+
+	private:
+		const BitData &data_; /*!< Values to iterate over. @since 0.3.0 */
+		size_t index_; /*!< Position of the current value. @since 0.3.0 */
+	};
+
+	/**
+	 * Get the number of values.
+	 *
+	 * This is the number of values that were requested, excluding the
+	 * padding in the last byte.
+	 *
+	 * @return Number of values.
+	 * @since 0.3.0
+	 */
+	inline size_t size() const { return bits_; }
+
+	/**
+	 * Determine if there are no values.
+	 *
+	 * @return True if there are no values, otherwise false.
+	 * @since 0.3.0
+	 */
+	inline bool empty() const { return bits_ == 0; }
+
+	/**
+	 * Get a value.
+	 *
+	 * @param[in] index Position of the value.
+	 * @return Coil or discrete input value.
+	 * @since 0.3.0
+	 */
+	inline bool operator[](size_t index) const { return (values_[index / 8] >> (index % 8)) & 1; }
+
+	inline const uint8_t* data() const { return values_.data(); } /*!< Get the packed values. @since 0.3.0 */
+	inline size_t data_size() const { return size_; } /*!< Get the number of bytes of packed values. @since 0.3.0 */
+	inline const_iterator begin() const { return const_iterator{*this, 0}; } /*!< Get an iterator to the first value. @since 0.3.0 */
+	inline const_iterator end() const { return const_iterator{*this, size()}; } /*!< Get an iterator past the last value. @since 0.3.0 */
+
+	/**
+	 * Replace the values.
+	 *
+	 * @param[in] data Packed values.
+	 * @param[in] len Number of bytes of packed values.
+	 * @param[in] bits Number of values.
+	 * @return True if the values were stored, false if there is not enough
+	 *         space or not enough bytes for the number of values.
+	 * @since 0.3.0
+	 */
+	bool assign(const uint8_t *data, size_t len, uint16_t bits);
+
+private:
+	std::array<uint8_t, CAPACITY> values_; /*!< Packed values. @since 0.3.0 */
+	uint8_t size_ = 0; /*!< Number of bytes of packed values. @since 0.3.0 */
+	uint16_t bits_ = 0; /*!< Number of values. @since 0.3.0 */
+};
+
+/**
+ * Response message.
+ *
+ * This will be created when a request is submitted and then later updated with
+ * the outcome. Poll the status() of the response to know when to access data.
+ *
+ * @since 0.1.0
+ */
+class Response {
+public:
+	virtual ~Response() = default;
+
+	Response(const Response&) = delete;
+	Response& operator=(const Response&) = delete;
+
+	/**
+	 * Determine if the request is complete.
+	 *
+	 * @return True if the request is finished, otherwise false.
+	 * @since 0.1.0
+	 */
+	inline bool done() const { return status_ >= ResponseStatus::SUCCESS; }
+
+	/**
+	 * Determine if the request is still pending.
+	 *
+	 * @return True if the request is in progress, otherwise false.
+	 * @since 0.1.0
+	 */
+	inline bool pending() const { return status_ < ResponseStatus::SUCCESS; }
+
+	/**
+	 * Determine if the request was successful.
+	 *
+	 * @return True if the request was successful, otherwise false.
+	 * @since 0.1.0
+	 */
+	bool success() const { return status_ == ResponseStatus::SUCCESS; }
+
+	/**
+	 * Determine if the request returned an exception.
+	 *
+	 * @return True if the request returned an exception, otherwise false.
+	 * @since 0.1.0
+	 */
+	bool exception() const { return status_ == ResponseStatus::EXCEPTION; }
+
+	/**
+	 * Determine if the request failed for a reason other than an exception.
+	 *
+	 * @return True if the request failed (without receiving an exception),
+	 *         otherwise false.
+	 * @since 0.1.0
+	 */
+	bool failed() const { return status_ > ResponseStatus::EXCEPTION; }
+
+	/**
+	 * Get the status of the response message.
+	 *
+	 * @return Status of the response message.
+	 * @since 0.1.0
+	 */
+	inline ResponseStatus status() const { return status_; }
+
+	/**
+	 * Set the status of the response message.
+	 *
+	 * @param[in] status Status of the response message.
+	 * @since 0.1.0
+	 */
+	inline void status(ResponseStatus status) { status_ = status; }
+
+	/**
+	 * Get the exception code from the device response.
+	 *
+	 * Valid only if the status() is ResponseStatus::EXCEPTION or exception()
+	 * returns true.
+	 *
+	 * @return Exception code from the device response.
+	 * @since 0.1.0
+	 */
+	inline uint8_t exception_code() const { return exception_code_; }
+
+	/**
+	 * Set the exception code from the device response.
+	 *
+	 * Valid only if the status() is ResponseStatus::EXCEPTION or exception()
+	 * returns true.
+	 *
+	 * @param[in] exception_code Exception code from the device response.
+	 * @since 0.1.0
+	 */
+	inline void exception_code(uint8_t exception_code) { exception_code_ = exception_code; }
+
+	/**
+	 * Parse a message frame buffer and store the outcome in this response.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] len Size of message frame.
+	 * @return The status result of message parsing.
+	 * @since 0.1.0
+	 */
+	virtual ResponseStatus parse(frame_buffer_t &frame, uint16_t len) = 0;
+
+	/**
+	 * Determine the expected length of a (non-exception) message frame from
+	 * the part of it that has been received so far.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] len Size of message frame received so far (excluding the
+	 *                CRC, if present).
+	 * @return Expected size of the message frame (excluding the CRC), or 0
+	 *         if it is not yet known.
+	 * @since 0.3.0
+	 */
+	virtual uint16_t expected_length(const frame_buffer_t &frame, uint16_t len) const;
+
+protected:
+	Response() = default;
+
+	/**
+	 * Check the length of the message frame is correct and log an error if it
+	 * is not.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] actual Actual length of the message frame.
+	 * @param[in] expected Expected length of the message frame.
+	 * @return True if the message frame length matches, otherwise false.
+	 * @since 0.1.0
+	 */
+	bool check_length(frame_buffer_t &frame, uint16_t actual, uint16_t expected);
+
+private:
+	template<typename T> friend class ResponseHandle;
+
+	/**
+	 * Add a reference to this response.
+	 *
+	 * @since 0.3.0
+	 */
+	inline void acquire() const { references_++; }
+
+	/**
+	 * Remove a reference to this response and return it to the pool if there
+	 * are no references remaining.
+	 *
+	 * @since 0.3.0
+	 */
+	void release() const;
+
+	ResponseStatus status_ = ResponseStatus::QUEUED; /*!< Status of response message. @since 0.1.0 */
+	uint8_t exception_code_ = 0; /*!< Device exception response. @since 0.1.0 */
+	mutable uint16_t references_ = 0; /*!< Number of handles referencing this response. @since 0.3.0 */
+};
+
+/**
+ * Register data response message.
+ *
+ * This will be created when a request is submitted and then later updated with
+ * the outcome. Poll the status() of the response to know when to access data.
+ *
+ * @since 0.1.0
+ */
+class RegisterDataResponse: public Response {
+public:
+	/**
+	 * Data from the device response, which may be fewer or more register values
+	 * than requested.
+	 *
+	 * Valid only if the status() is ResponseStatus::SUCCESS.
+	 *
+	 * @return A reference to the data in the response.
+	 * @since 0.1.0
+	 */
+	inline const RegisterData& data() const { return data_; };
+
+	/**
+	 * Parse a message frame buffer and store the outcome in this response.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] len Size of message frame.
+	 * @return The status result of message parsing.
+	 * @since 0.1.0
+	 */
+	ResponseStatus parse(frame_buffer_t &frame, uint16_t len) override;
+
+	/**
+	 * Determine the expected length of a (non-exception) message frame from
+	 * the part of it that has been received so far.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] len Size of message frame received so far (excluding the
+	 *                CRC, if present).
+	 * @return Expected size of the message frame (excluding the CRC), or 0
+	 *         if it is not yet known.
+	 * @since 0.3.0
+	 */
+	uint16_t expected_length(const frame_buffer_t &frame, uint16_t len) const override;
+
+protected:
+	RegisterData data_; /*!< Data from device response. @since 0.3.0 */
+
+private:
+	friend class BaseClient;
+	friend class RegisterCache;
+	friend class RegisterWriteBehindRequest;
+
+	/**
+	 * Attach another response to this one so that it is completed with a
+	 * subset of the same register values instead of sending another request.
+	 *
+	 * @param[in] response Response to attach.
+	 * @param[in] offset Position of the first register value.
+	 * @param[in] size Number of register values.
+	 * @param[in] callback Function to call when the attached response is
+	 *                     complete.
+	 * @since 0.3.0
+	 */
+	void attach(const ResponseHandle<RegisterDataResponse> &response,
+		uint16_t offset, uint16_t size,
+		const ResponseCallback<RegisterDataResponse> &callback);
+
+	/**
+	 * Complete all attached responses with the outcome of this response.
+	 *
+	 * @since 0.3.0
+	 */
+	void complete_attached();
+
+	ResponseHandle<RegisterDataResponse> attached_; /*!< Next attached response. @since 0.3.0 */
+	ResponseCallback<RegisterDataResponse> attached_callback_; /*!< Function to call when this attached response is complete. @since 0.3.0 */
+	uint16_t attached_offset_ = 0; /*!< Position of the first register value when this response is attached. @since 0.3.0 */
+	uint16_t attached_size_ = 0; /*!< Number of register values when this response is attached. @since 0.3.0 */
+};
+
+/**
+ * Register write response message.
+ *
+ * This will be created when a request is submitted and then later updated with
+ * the outcome. Poll the status() of the response to know when to access data.
+ *
+ * @since 0.1.0
+ */
+class RegisterWriteResponse: public RegisterDataResponse {
+public:
+	/**
+	 * Parse a message frame buffer and store the outcome in this response.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] len Size of message frame.
+	 * @return The status result of message parsing.
+	 * @since 0.1.0
+	 */
+	ResponseStatus parse(frame_buffer_t &frame, uint16_t len) override;
+
+	/**
+	 * Determine the expected length of a (non-exception) message frame from
+	 * the part of it that has been received so far.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] len Size of message frame received so far (excluding the
+	 *                CRC, if present).
+	 * @return Expected size of the message frame (excluding the CRC), or 0
+	 *         if it is not yet known.
+	 * @since 0.3.0
+	 */
+	uint16_t expected_length(const frame_buffer_t &frame, uint16_t len) const override;
+
+	/**
+	 * Get the address from the device response, which should match the address
+	 * that was requested.
+	 *
+	 * Valid only if the status() is ResponseStatus::SUCCESS.
+	 *
+	 * @return Address from the response.
+	 * @since 0.1.0
+	 */
+	uint16_t address() const { return address_; }
+
+private:
+	friend class BaseClient;
+	friend class RegisterWriteBehindRequest;
+
+	uint16_t address_; /*!< Address from device response. @since 0.1.0 */
+};
+
+/**
+ * Coil or discrete input data response message.
+ *
+ * This will be created when a request is submitted and then later updated with
+ * the outcome. Poll the status() of the response to know when to access data.
+ *
+ * @since 0.3.0
+ */
+class BitDataResponse: public Response {
+public:
+	/**
+	 * Data from the device response, with the number of values that were
+	 * requested.
+	 *
+	 * Valid only if the status() is ResponseStatus::SUCCESS.
+	 *
+	 * @return A reference to the data in the response.
+	 * @since 0.3.0
+	 */
+	inline const BitData& data() const { return data_; };
+
+	/**
+	 * Parse a message frame buffer and store the outcome in this response.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] len Size of message frame.
+	 * @return The status result of message parsing.
+	 * @since 0.3.0
+	 */
+	ResponseStatus parse(frame_buffer_t &frame, uint16_t len) override;
+
+	/**
+	 * Determine the expected length of a (non-exception) message frame from
+	 * the part of it that has been received so far.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] len Size of message frame received so far (excluding the
+	 *                CRC, if present).
+	 * @return Expected size of the message frame (excluding the CRC), or 0
+	 *         if it is not yet known.
+	 * @since 0.3.0
+	 */
+	uint16_t expected_length(const frame_buffer_t &frame, uint16_t len) const override;
+
+private:
+	friend class BaseClient;
+
+	BitData data_; /*!< Data from device response. @since 0.3.0 */
+	uint16_t quantity_ = 0; /*!< Number of values requested. @since 0.3.0 */
+};
+
+/**
+ * Register block response message.
+ *
+ * A block read is split into requests of up to MAX_READ_REGISTERS each. The
+ * register values from each request are copied into the caller's storage
+ * and the next request is queued as each one completes. The response keeps
+ * a reference to itself until the block read is complete, so the client
+ * must not be destroyed while it is in progress.
+ *
+ * This will be created when a block read is submitted and then later updated
+ * with the outcome. Poll the status() of the response to know when to access
+ * data.
+ *
+ * @since 0.3.0
+ */
+class RegisterBlockResponse: public Response {
+public:
+	static constexpr size_t MAX_CHUNKS = (MAX_READ_BLOCK_REGISTERS + MAX_READ_REGISTERS - 1) / MAX_READ_REGISTERS; /*!< Maximum number of requests in a block read. @since 0.3.0 */
+	static constexpr uint8_t PIPELINE_DEPTH = 2; /*!< Maximum number of requests to have queued at the same time. @since 0.3.0 */
+
+	/**
+	 * Get the register values (the caller's storage).
+	 *
+	 * Values are valid only for chunks that did not fail.
+	 *
+	 * @return Register values.
+	 * @since 0.3.0
+	 */
+	inline const uint16_t* data() const { return values_; }
+
+	/**
+	 * Get the number of registers requested.
+	 *
+	 * @return Number of registers.
+	 * @since 0.3.0
+	 */
+	inline size_t size() const { return size_; }
+
+	/**
+	 * Get the number of requests that the block read is split into.
+	 *
+	 * @return Number of requests.
+	 * @since 0.3.0
+	 */
+	inline size_t chunks() const { return chunks_; }
+
+	/**
+	 * Determine if one request of the block read failed.
+	 *
+	 * The request at chunk index i reads registers from
+	 * i * MAX_READ_REGISTERS.
+	 *
+	 * @param[in] index Chunk index.
+	 * @return True if the request failed, otherwise false.
+	 * @since 0.3.0
+	 */
+	inline bool chunk_failed(size_t index) const { return (failed_[index / 8] >> (index % 8)) & 1; }
+
+	/**
+	 * Get the number of requests that failed.
+	 *
+	 * @return Number of failed requests.
+	 * @since 0.3.0
+	 */
+	inline size_t failed_chunks() const { return failed_chunks_; }
+
+	/**
+	 * Parse a message frame buffer and store the outcome in this response.
+	 *
+	 * Block reads are not sent directly so this always fails.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] len Size of message frame.
+	 * @return The status result of message parsing.
+	 * @since 0.3.0
+	 */
+	ResponseStatus parse(frame_buffer_t &frame, uint16_t len) override;
+
+private:
+	friend class BaseClient;
+
+	/**
+	 * Queue the next requests of the block read, or finish if there are no
+	 * more requests.
+	 *
+	 * @since 0.3.0
+	 */
+	void queue();
+
+	/**
+	 * Store the outcome of a request.
+	 *
+	 * @param[in] index Chunk index.
+	 * @param[in] response Response to the request.
+	 * @since 0.3.0
+	 */
+	void chunk_complete(uint16_t index, const RegisterDataResponse &response);
+
+	BaseClient *client_ = nullptr; /*!< Client to queue requests on. @since 0.3.0 */
+	ResponseHandle<RegisterBlockResponse> self_; /*!< Reference to this response while requests are outstanding. @since 0.3.0 */
+	ResponseCallback<RegisterBlockResponse> callback_; /*!< Function to call when the response is complete. @since 0.3.0 */
+	uint16_t *values_ = nullptr; /*!< Register values (owned by the caller). @since 0.3.0 */
+	uint32_t size_ = 0; /*!< Number of registers. @since 0.3.0 */
+	uint16_t address_ = 0; /*!< Starting register address. @since 0.3.0 */
+	uint16_t timeout_ms_ = 0; /*!< Timeout for each request. @since 0.3.0 */
+	RequestPriority priority_ = RequestPriority::INTERACTIVE; /*!< Priority of each request. @since 0.3.0 */
+	uint16_t chunks_ = 0; /*!< Number of requests. @since 0.3.0 */
+	uint16_t next_chunk_ = 0; /*!< Next request to queue. @since 0.3.0 */
+	uint16_t failed_chunks_ = 0; /*!< Number of failed requests. @since 0.3.0 */
+	uint8_t device_ = 0; /*!< Remote device address. @since 0.3.0 */
+	uint8_t function_code_ = 0; /*!< Read function code. @since 0.3.0 */
+	uint8_t queued_ = 0; /*!< Number of requests currently queued. @since 0.3.0 */
+	bool queuing_ = false; /*!< Requests are being queued. @since 0.3.0 */
+	ResponseStatus result_ = ResponseStatus::SUCCESS; /*!< Outcome (status of the first failed request). @since 0.3.0 */
+	std::array<uint8_t, (MAX_CHUNKS + 7) / 8> failed_{}; /*!< Failed requests. @since 0.3.0 */
+};
+
+/**
+ * Exception status response message.
+ *
+ * This will be created when a request is submitted and then later updated with
+ * the outcome. Poll the status() of the response to know when to access data.
+ *
+ * @since 0.1.0
+ */
+class ExceptionStatusResponse: public Response {
+public:
+	/**
+	 * Parse a message frame buffer and store the outcome in this response.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] len Size of message frame.
+	 * @return The status result of message parsing.
+	 * @since 0.1.0
+	 */
+	ResponseStatus parse(frame_buffer_t &frame, uint16_t len) override;
+
+	/**
+	 * Determine the expected length of a (non-exception) message frame from
+	 * the part of it that has been received so far.
+	 *
+	 * @param[in] frame Message frame buffer.
+	 * @param[in] len Size of message frame received so far (excluding the
+	 *                CRC, if present).
+	 * @return Expected size of the message frame (excluding the CRC), or 0
+	 *         if it is not yet known.
+	 * @since 0.3.0
+	 */
+	uint16_t expected_length(const frame_buffer_t &frame, uint16_t len) const override;
+
+	/**
+	 * Get the output data from the device response.
+	 *
+	 * Valid only if the status() is ResponseStatus::SUCCESS.
+	 *
+	 * @return Output data from the response.
+	 * @since 0.1.0
+	 */
+	inline uint8_t data() const { return data_; };
+
+private:
+	uint8_t data_; /*!< Output data from device response. @since 0.1.0 */
+};
+
+/**
+ * Fixed capacity pool of response messages.
+ *
+ * Responses are created in place in this pool so that no memory allocation is
+ * required, and returned to it when their last ResponseHandle is released.
+ *
+ * @since 0.3.0
+ */
+class ResponsePool {
+public:
+	static constexpr size_t CAPACITY = UUID_MODBUS_RESPONSE_POOL_SIZE; /*!< Maximum number of responses. @since 0.3.0 */
+
+	/**
+	 * Storage for any type of response.
+	 *
+	 * @since 0.3.0
+	 */
+	using storage_t = std::aligned_storage<
+		MaxSizeOf<RegisterDataResponse, RegisterWriteResponse, BitDataResponse,
+			RegisterBlockResponse, ExceptionStatusResponse>::size,
+		MaxSizeOf<RegisterDataResponse, RegisterWriteResponse, BitDataResponse,
+			RegisterBlockResponse, ExceptionStatusResponse>::align>::type;
+
+	ResponsePool() = delete;
+
+	/**
+	 * Create a new response.
+	 *
+	 * If the pool is exhausted then the exhausted() response for the type is
+	 * returned instead.
+	 *
+	 * @tparam T Type of response.
+	 * @param[in] args Arguments for the response constructor.
+	 * @return Handle to the new response.
+	 * @since 0.3.0
+	 */
+	template<typename T, typename... Args>
+	static ResponseHandle<T> make(Args&&... args) {
+		static_assert(sizeof(T) <= sizeof(storage_t), "Response type too large for pool storage");
+		static_assert(alignof(T) <= alignof(storage_t), "Response type alignment too large for pool storage");
+
+		void *storage = allocate();
+
+		if (storage == nullptr) {
+			return ResponseHandle<T>{&exhausted<T>()};
+		}
+
+		return ResponseHandle<T>{new (storage) T(std::forward<Args>(args)...)};
+	}
+
+	/**
+	 * Get the response that is returned when the pool is exhausted.
+	 *
+	 * There is one of these for each type of response and it is shared by
+	 * every attempt to create a response of that type while the pool is
+	 * exhausted. Its status is set to ResponseStatus::FAILURE_POOL_EXHAUSTED
+	 * when it is created and it must not be modified after that: requests are
+	 * never queued with it and it is never returned to the pool.
+	 *
+	 * @tparam T Type of response.
+	 * @return Response with a status of
+	 *         ResponseStatus::FAILURE_POOL_EXHAUSTED.
+	 * @since 0.3.0
+	 */
+	template<typename T>
+	static T& exhausted() {
+		struct Exhausted: public T {
+			Exhausted() { this->status(ResponseStatus::FAILURE_POOL_EXHAUSTED); }
+		};
+
+		static Exhausted response;
+
+		return response;
+	}
+
+	/**
+	 * Get the number of responses that can be created.
+	 *
+	 * @return Number of unused responses in the pool.
+	 * @since 0.3.0
+	 */
+	static size_t available();
+
+private:
+	friend class Response;
+
+	/**
+	 * Allocate storage for a response.
+	 *
+	 * @return Storage for a response, or nullptr if the pool is exhausted.
+	 * @since 0.3.0
+	 */
+	static void* allocate();
+
+	/**
+	 * Destroy a response and return its storage to the pool.
+	 *
+	 * Responses that were not allocated from the pool are ignored.
+	 *
+	 * @param[in] response Response to destroy.
+	 * @since 0.3.0
+	 */
+	static void release(const Response *response);
+
+	static std::array<storage_t, CAPACITY> responses_; /*!< Storage for responses. @since 0.3.0 */
+	static std::array<bool, CAPACITY> used_; /*!< Storage in use. @since 0.3.0 */
+};
+
+/**
+ * Request message.
+ *
+ * This will be created when a request is submitted and then discarded when the
+ * response is updated with the outcome.
+ *
+ * @since 0.1.0
+ */
+class Request {
+public:
+	virtual ~Request() = default;
+
+public:
+	/**
+	 * Create a new request message (not directly useful).
+	 *
+	 * @param[in] device Destination device address.
+	 * @param[in] function_code Function code of the request.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds.
+	 * @param[in] response Response object.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @since 0.1.0
+	 */
+	Request(uint16_t device, uint8_t function_code, uint16_t timeout_ms,
+		const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback = nullptr);
+
+	/**
+	 * Encode this request and store it in a message frame buffer.
+	 *
+	 * @param[out] frame Message frame buffer.
+	 * @return Size of message frame.
+	 * @since 0.1.0
+	 */
+	virtual uint16_t encode(frame_buffer_t &frame);
+
+	/**
+	 * Get the destination device address.
+	 *
+	 * @return Remote device address.
+	 * @since 0.1.0
+	 */
+	inline uint16_t device() const { return device_; };
+
+	/**
+	 * Get the function code of the request.
+	 *
+	 * @return Request message function code.
+	 * @since 0.1.0
+	 */
+	inline uint8_t function_code() const { return function_code_; };
+
+	/**
+	 * Get the timeout to wait for a response in milliseconds.
+	 *
+	 * @return Request timeout.
+	 * @since 0.1.0
+	 */
+	inline uint16_t timeout_ms() const { return timeout_ms_; };
+
+	/**
+	 * Get the response object.
+	 *
+	 * @return Corresponding response object.
+	 * @since 0.1.0
+	 */
+	inline Response& response() const { return *response_.get(); };
+
+	/**
+	 * Get the function to call when the response is complete.
+	 *
+	 * @return Completion callback.
+	 * @since 0.3.0
+	 */
+	inline const ResponseCallback<Response>& callback() const { return callback_; };
+
+	/**
+	 * Determine if the response is referenced by anything other than this
+	 * request.
+	 *
+	 * @return True if there are other handles to the response, otherwise
+	 *         false.
+	 * @since 0.3.0
+	 */
+	inline bool response_referenced() const { return response_.use_count() > 1; }
+
+	/**
+	 * Combine a write of a single holding register with this request (if it
+	 * has not been transmitted yet).
+	 *
+	 * @param[in] address Register address.
+	 * @param[in] value Register value.
+	 * @return True if the write was combined with this request, otherwise
+	 *         false.
+	 * @since 0.3.0
+	 */
+	virtual bool merge_write(uint16_t address __attribute__((unused)),
+		uint16_t value __attribute__((unused))) { return false; }
+
+	/**
+	 * Update the outcome of the response (and any responses attached to it)
+	 * before this request is removed from the queue.
+	 *
+	 * @since 0.3.0
+	 */
+	virtual void complete() {}
+
+protected:
+	/**
+	 * Change the function code of the request.
+	 *
+	 * @param[in] function_code Request message function code.
+	 * @since 0.3.0
+	 */
+	inline void function_code(uint8_t function_code) { function_code_ = function_code; }
+
+private:
+	const uint16_t device_; /*!< Remote device address. @since 0.1.0 */
+	uint8_t function_code_; /*!< Request message function code. @since 0.1.0 */
+	const uint16_t timeout_ms_; /*!< Request timeout. @since 0.1.0 */
+	const ResponseHandle<Response> response_; /*!< Corresponding response object. @since 0.3.0 */
+	const ResponseCallback<Response> callback_; /*!< Function to call when the response is complete. @since 0.3.0 */
+};
+
+/**
+ * Request message for register functions.
+ *
+ * This will be created when a request is submitted and then discarded when the
+ * response is updated with the outcome.
+ *
+ * @since 0.1.0
+ */
+class RegisterRequest: public Request {
+public:
+	/**
+	 * Create a new register request message (not directly useful).
+	 *
+	 * @param[in] device Destination device address.
+	 * @param[in] function_code Function code of the request.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds.
+	 * @param[in] address Register address.
+	 * @param[in] data Number of registers to read or register value to write.
+	 * @param[in] response Response object.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @since 0.1.0
+	 */
+	RegisterRequest(uint16_t device, uint8_t function_code, uint16_t timeout_ms,
+		uint16_t address, uint16_t data,
+		const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback = nullptr);
+
+	/**
+	 * Encode this request and store it in a message frame buffer.
+	 *
+	 * @param[out] frame Message frame data.
+	 * @return Size of message frame.
+	 * @since 0.1.0
+	 */
+	uint16_t encode(frame_buffer_t &frame) override;
+
+	/**
+	 * Get the register address.
+	 *
+	 * @return Register address.
+	 * @since 0.1.0
+	 */
+	inline uint16_t address() const { return address_; };
+
+	/**
+	 * Get the register size or value.
+	 *
+	 * @return Register size or value.
+	 * @since 0.1.0
+	 */
+	inline uint16_t data() const { return data_; };
+
+private:
+	const uint16_t address_; /*!< Register address. @since 0.1.0 */
+	const uint16_t data_; /*!< Register size or value. @since 0.1.0 */
+};
+
+/**
+ * Register values request message.
+ *
+ * The register values are not copied, they are encoded directly from the
+ * caller's storage when the request is transmitted.
+ *
+ * @since 0.3.0
+ */
+class RegisterValuesRequest: public RegisterRequest {
+public:
+	/**
+	 * Create a new register values request message (not directly useful).
+	 *
+	 * @param[in] device Destination device address.
+	 * @param[in] function_code Function code of the request.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds.
+	 * @param[in] address Starting register address.
+	 * @param[in] values Register values to write (must remain valid until
+	 *                   the response is complete).
+	 * @param[in] size Number of register values.
+	 * @param[in] response Response object.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @since 0.3.0
+	 */
+	RegisterValuesRequest(uint16_t device, uint8_t function_code, uint16_t timeout_ms,
+		uint16_t address, const uint16_t *values, uint16_t size,
+		const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback = nullptr);
+
+	/**
+	 * Encode this request and store it in a message frame buffer.
+	 *
+	 * @param[out] frame Message frame data.
+	 * @return Size of message frame.
+	 * @since 0.3.0
+	 */
+	uint16_t encode(frame_buffer_t &frame) override;
+
+	/**
+	 * Get the register values.
+	 *
+	 * @return Register values.
+	 * @since 0.3.0
+	 */
+	inline const uint16_t* values() const { return values_; };
+
+protected:
+	/**
+	 * Encode the byte count and register values and store them in a message
+	 * frame buffer.
+	 *
+	 * @param[out] frame Message frame data.
+	 * @param[in] len Current size of message frame.
+	 * @return Size of message frame.
+	 * @since 0.3.0
+	 */
+	uint16_t encode_values(frame_buffer_t &frame, uint16_t len) const;
+
+private:
+	const uint16_t *values_; /*!< Register values (owned by the caller). @since 0.3.0 */
+};
+
+/**
+ * Register read/write request message.
+ *
+ * The register values to write are not copied, they are encoded directly
+ * from the caller's storage when the request is transmitted.
+ *
+ * @since 0.3.0
+ */
+class RegisterReadWriteRequest: public RegisterValuesRequest {
+public:
+	/**
+	 * Create a new register read/write request message (not directly useful).
+	 *
+	 * @param[in] device Destination device address.
+	 * @param[in] function_code Function code of the request.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds.
+	 * @param[in] read_address Starting register address to read.
+	 * @param[in] read_size Number of registers to read.
+	 * @param[in] write_address Starting register address to write.
+	 * @param[in] values Register values to write (must remain valid until
+	 *                   the response is complete).
+	 * @param[in] write_size Number of register values to write.
+	 * @param[in] response Response object.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @since 0.3.0
+	 */
+	RegisterReadWriteRequest(uint16_t device, uint8_t function_code,
+		uint16_t timeout_ms, uint16_t read_address, uint16_t read_size,
+		uint16_t write_address, const uint16_t *values, uint16_t write_size,
+		const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback = nullptr);
+
+	/**
+	 * Encode this request and store it in a message frame buffer.
+	 *
+	 * @param[out] frame Message frame data.
+	 * @return Size of message frame.
+	 * @since 0.3.0
+	 */
+	uint16_t encode(frame_buffer_t &frame) override;
+
+	/**
+	 * Get the register address to read.
+	 *
+	 * @return Register address.
+	 * @since 0.3.0
+	 */
+	inline uint16_t read_address() const { return read_address_; };
+
+	/**
+	 * Get the number of registers to read.
+	 *
+	 * @return Register size.
+	 * @since 0.3.0
+	 */
+	inline uint16_t read_size() const { return read_size_; };
+
+private:
+	const uint16_t read_address_; /*!< Register address to read. @since 0.3.0 */
+	const uint16_t read_size_; /*!< Number of registers to read. @since 0.3.0 */
+};
+
+/**
+ * Coil values request message.
+ *
+ * The coil values are not copied, they are encoded directly from the
+ * caller's storage when the request is transmitted.
+ *
+ * @since 0.3.0
+ */
+class BitValuesRequest: public RegisterRequest {
+public:
+	/**
+	 * Create a new coil values request message (not directly useful).
+	 *
+	 * @param[in] device Destination device address.
+	 * @param[in] function_code Function code of the request.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds.
+	 * @param[in] address Starting coil address.
+	 * @param[in] values Packed coil values to write, least significant bit
+	 *                   first (must remain valid until the response is
+	 *                   complete).
+	 * @param[in] size Number of coil values.
+	 * @param[in] response Response object.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @since 0.3.0
+	 */
+	BitValuesRequest(uint16_t device, uint8_t function_code, uint16_t timeout_ms,
+		uint16_t address, const uint8_t *values, uint16_t size,
+		const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback = nullptr);
+
+	/**
+	 * Encode this request and store it in a message frame buffer.
+	 *
+	 * @param[out] frame Message frame data.
+	 * @return Size of message frame.
+	 * @since 0.3.0
+	 */
+	uint16_t encode(frame_buffer_t &frame) override;
+
+	/**
+	 * Get the packed coil values.
+	 *
+	 * @return Coil values.
+	 * @since 0.3.0
+	 */
+	inline const uint8_t* values() const { return values_; };
+
+private:
+	const uint8_t *values_; /*!< Packed coil values (owned by the caller). @since 0.3.0 */
+};
+
+/**
+ * Holding register write request message for write-behind mode.
+ *
+ * The register values are copied so that later writes to the same or
+ * adjacent registers can be combined with this request until it is
+ * transmitted. A single register is written with function code 0x06 and
+ * multiple registers are written with function code 0x10.
+ *
+ * @since 0.3.0
+ */
+class RegisterWriteBehindRequest: public Request {
+public:
+	static constexpr uint16_t CAPACITY = UUID_MODBUS_WRITE_BEHIND_REGISTERS; /*!< Maximum number of register values. @since 0.3.0 */
+
+	/**
+	 * Create a new write-behind request message (not directly useful).
+	 *
+	 * @param[in] device Destination device address.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds.
+	 * @param[in] address Register address.
+	 * @param[in] value Register value.
+	 * @param[in] response Response object.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @since 0.3.0
+	 */
+	RegisterWriteBehindRequest(uint16_t device, uint16_t timeout_ms,
+		uint16_t address, uint16_t value,
+		const ResponseHandle<Response> &response,
+		const ResponseCallback<Response> &callback = nullptr);
+
+	/**
+	 * Encode this request and store it in a message frame buffer.
+	 *
+	 * @param[out] frame Message frame data.
+	 * @return Size of message frame.
+	 * @since 0.3.0
+	 */
+	uint16_t encode(frame_buffer_t &frame) override;
+
+	/**
+	 * Combine a write of a single holding register with this request if the
+	 * register is already being written or is adjacent to the registers
+	 * being written.
+	 *
+	 * @param[in] address Register address.
+	 * @param[in] value Register value.
+	 * @return True if the write was combined with this request, otherwise
+	 *         false.
+	 * @since 0.3.0
+	 */
+	bool merge_write(uint16_t address, uint16_t value) override;
+
+	/**
+	 * Set the address and value of each of the combined writes in their
+	 * responses, because the response to a write of multiple registers only
+	 * has the number of registers written.
+	 *
+	 * @since 0.3.0
+	 */
+	void complete() override;
+
+	/**
+	 * Get the starting register address.
+	 *
+	 * @return Register address.
+	 * @since 0.3.0
+	 */
+	inline uint16_t address() const { return address_; };
+
+	/**
+	 * Get the number of register values.
+	 *
+	 * @return Number of register values.
+	 * @since 0.3.0
+	 */
+	inline uint16_t size() const { return size_; };
+
+	/**
+	 * Get the register values.
+	 *
+	 * @return Register values.
+	 * @since 0.3.0
+	 */
+	inline const uint16_t* values() const { return values_.data(); };
+
+private:
+	const uint16_t first_address_; /*!< Register address of the first write. @since 0.3.0 */
+	uint16_t address_; /*!< Starting register address. @since 0.3.0 */
+	uint16_t size_ = 1; /*!< Number of register values. @since 0.3.0 */
+	std::array<uint16_t, CAPACITY> values_; /*!< Register values. @since 0.3.0 */
+};
+
+/**
+ * Fixed capacity queue of request messages.
+ *
+ * Requests are stored inline so that no memory allocation is required to
+ * queue them. The order of the requests is kept separately so that a request
+ * can be queued ahead of requests with a lower priority. Requests with the
+ * same priority are kept in the order that they were queued.
+ *
+ * @since 0.3.0
+ */
+class RequestQueue {
+public:
+	static constexpr size_t CAPACITY = UUID_MODBUS_REQUEST_QUEUE_SIZE; /*!< Maximum number of requests. @since 0.3.0 */
+	static constexpr uint8_t MAX_OVERTAKEN = 8; /*!< Maximum number of times a request can be overtaken by requests with a higher priority. @since 0.3.0 */
+
+	static_assert(CAPACITY > 0 && CAPACITY <= 256, "Request queue size must be 1 to 256");
+
+	/**
+	 * Storage for any type of request.
+	 *
+	 * @since 0.3.0
+	 */
+	using storage_t = std::aligned_storage<
+		MaxSizeOf<Request, RegisterRequest, RegisterValuesRequest,
+			RegisterReadWriteRequest, BitValuesRequest,
+			RegisterWriteBehindRequest>::size,
+		MaxSizeOf<Request, RegisterRequest, RegisterValuesRequest,
+			RegisterReadWriteRequest, BitValuesRequest,
+			RegisterWriteBehindRequest>::align>::type;
+
+	RequestQueue();
+	~RequestQueue();
+
+	RequestQueue(const RequestQueue&) = delete;
+	RequestQueue& operator=(const RequestQueue&) = delete;
+
+	/**
+	 * Determine if the queue is empty.
+	 *
+	 * @return True if there are no requests in the queue, otherwise false.
+	 * @since 0.3.0
+	 */
+	inline bool empty() const { return size_ == 0; }
+
+	/**
+	 * Determine if the queue is full.
+	 *
+	 * @return True if no more requests can be queued, otherwise false.
+	 * @since 0.3.0
+	 */
+	inline bool full() const { return size_ == CAPACITY; }
+
+	/**
+	 * Get the number of requests in the queue.
+	 *
+	 * @return Number of requests in the queue.
+	 * @since 0.3.0
+	 */
+	inline size_t size() const { return size_; }
+
+	/**
+	 * Get the request at the front of the queue.
+	 *
+	 * The queue must not be empty.
+	 *
+	 * @return Request at the front of the queue.
+	 * @since 0.3.0
+	 */
+	inline Request& front() { return (*this)[0]; }
+
+	/**
+	 * Get the request at the front of the queue.
+	 *
+	 * The queue must not be empty.
+	 *
+	 * @return Request at the front of the queue.
+	 * @since 0.3.0
+	 */
+	inline const Request& front() const { return (*this)[0]; }
+
+	/**
+	 * Get a request in the queue.
+	 *
+	 * @param[in] index Position in the queue (0 is the front).
+	 * @return Request at that position in the queue.
+	 * @since 0.3.0
+	 */
+	inline Request& operator[](size_t index) {
+		return *reinterpret_cast<Request*>(&requests_[order_[index]]);
+	}
+
+	/**
+	 * Get a request in the queue.
+	 *
+	 * @param[in] index Position in the queue (0 is the front).
+	 * @return Request at that position in the queue.
+	 * @since 0.3.0
+	 */
+	inline const Request& operator[](size_t index) const {
+		return *reinterpret_cast<const Request*>(&requests_[order_[index]]);
+	}
+
+	/**
+	 * Get the priority of a request in the queue.
+	 *
+	 * @param[in] index Position in the queue (0 is the front).
+	 * @return Priority of the request at that position in the queue.
+	 * @since 0.3.0
+	 */
+	inline RequestPriority priority(size_t index) const { return priority_[order_[index]]; }
+
+	/**
+	 * Get the time that a request was queued.
+	 *
+	 * @param[in] index Position in the queue (0 is the front).
+	 * @return Time that the request at that position was queued in
+	 *         milliseconds.
+	 * @since 0.3.0
+	 */
+	inline uint32_t queued_ms(size_t index) const { return queued_ms_[order_[index]]; }
+
+	/**
+	 * Get the maximum time that a request can wait in the queue.
+	 *
+	 * @param[in] index Position in the queue (0 is the front).
+	 * @return Maximum time before the request at that position is
+	 *         transmitted in milliseconds (0 = no limit).
+	 * @since 0.3.0
+	 */
+	inline uint32_t timeout_ms(size_t index) const { return timeout_ms_[order_[index]]; }
+	/**
+	 * Set the maximum time that a request can wait in the queue.
+	 *
+	 * @param[in] index Position in the queue (0 is the front).
+	 * @param[in] timeout_ms Maximum time before the request at that position
+	 *                       is transmitted in milliseconds (0 = no limit).
+	 * @since 0.3.0
+	 */
+	inline void timeout_ms(size_t index, uint32_t timeout_ms) { timeout_ms_[order_[index]] = timeout_ms; }
+
+	/**
+	 * Get the maximum time that new requests can wait in the queue.
+	 *
+	 * @return Maximum time before a new request is transmitted in
+	 *         milliseconds (0 = no limit).
+	 * @since 0.3.0
+	 */
+	inline uint32_t default_timeout_ms() const { return default_timeout_ms_; }
+	/**
+	 * Set the maximum time that new requests can wait in the queue.
+	 *
+	 * @param[in] timeout_ms Maximum time before a new request is transmitted
+	 *                       in milliseconds (0 = no limit).
+	 * @since 0.3.0
+	 */
+	inline void default_timeout_ms(uint32_t timeout_ms) { default_timeout_ms_ = timeout_ms; }
+
+	/**
+	 * Create a new request in the queue after all of the requests with the
+	 * same or a higher priority.
+	 *
+	 * Requests that are in progress and requests that have been overtaken
+	 * MAX_OVERTAKEN times are never overtaken.
+	 *
+	 * @tparam T Type of request.
+	 * @param[in] priority Priority of the request.
+	 * @param[in] args Arguments for the request constructor.
+	 * @return True if the request was queued, false if the queue is full.
+	 * @since 0.3.0
+	 */
+	template<typename T, typename... Args>
+	bool emplace(RequestPriority priority, Args&&... args) {
+		static_assert(sizeof(T) <= sizeof(storage_t), "Request type too large for queue storage");
+		static_assert(alignof(T) <= alignof(storage_t), "Request type alignment too large for queue storage");
+
+		if (full()) {
+			return false;
+		}
+
+		uint8_t slot = order_[size_];
+
+		new (&requests_[slot]) T(std::forward<Args>(args)...);
+		priority_[slot] = priority;
+		overtaken_[slot] = 0;
+		queued_ms_[slot] = ::millis();
+		timeout_ms_[slot] = default_timeout_ms_;
+		insert(slot, priority);
+		return true;
+	}
+
+	/**
+	 * Remove the request at the front of the queue.
+	 *
+	 * The queue must not be empty.
+	 *
+	 * @since 0.3.0
+	 */
+	inline void pop_front() { erase(0); }
+
+	/**
+	 * Remove a request from the queue.
+	 *
+	 * @param[in] index Position in the queue (0 is the front).
+	 * @since 0.3.0
+	 */
+	void erase(size_t index);
+
+private:
+	/**
+	 * Move a new request from the back of the queue to its position in the
+	 * queue for its priority.
+	 *
+	 * @param[in] slot Storage position of the request.
+	 * @param[in] priority Priority of the request.
+	 * @since 0.3.0
+	 */
+	void insert(uint8_t slot, RequestPriority priority);
+
+	std::array<storage_t, CAPACITY> requests_; /*!< Storage for requests. @since 0.3.0 */
+	std::array<uint8_t, CAPACITY> order_; /*!< Storage positions of requests in queue order, followed by unused storage positions. @since 0.3.0 */
+	std::array<RequestPriority, CAPACITY> priority_; /*!< Priority of each request (by storage position). @since 0.3.0 */
+	std::array<uint8_t, CAPACITY> overtaken_; /*!< Number of times each request has been overtaken (by storage position). @since 0.3.0 */
+	std::array<uint32_t, CAPACITY> queued_ms_; /*!< Time that each request was queued (by storage position). @since 0.3.0 */
+	std::array<uint32_t, CAPACITY> timeout_ms_; /*!< Maximum time that each request can wait in the queue (by storage position, 0 = no limit). @since 0.3.0 */
+	uint32_t default_timeout_ms_ = 0; /*!< Maximum time that new requests can wait in the queue (0 = no limit). @since 0.3.0 */
+	size_t size_ = 0; /*!< Number of requests in the queue. @since 0.3.0 */
+};
+
+/**
+ * Client used to queue requests and process responses, independent of how
+ * they are sent to devices.
+ *
+ * @since 0.3.0
+ */
+class BaseClient {
+public:
+	static constexpr uint8_t MAX_TIMEOUT_BACKOFF = 8; /*!< Maximum number of times to double the adaptive timeout. @since 0.3.0 */
+	static constexpr uint8_t MAX_RETRY_BACKOFF = 16; /*!< Maximum number of times to double the circuit breaker retry interval. @since 0.3.0 */
+	static constexpr uint32_t WAIT_FOR_INPUT = UINT32_MAX; /*!< No timing event is pending, loop() only needs to be called when data is received or a request is made. @since 0.3.0 */
+
+	/**
+	 * Get the minimum adaptive timeout for unicast requests.
+	 *
+	 * @return Minimum timeout to wait for a response in milliseconds.
+	 * @since 0.3.0
+	 */
+	inline uint16_t min_adaptive_timeout_ms() const { return min_adaptive_timeout_ms_; }
+
+	/**
+	 * Get the maximum adaptive timeout for unicast requests.
+	 *
+	 * @return Maximum timeout to wait for a response in milliseconds (0 =
+	 *         adaptive timeouts are disabled).
+	 * @since 0.3.0
+	 */
+	inline uint16_t max_adaptive_timeout_ms() const { return max_adaptive_timeout_ms_; }
+
+	/**
+	 * Set the bounds of adaptive timeouts for unicast requests.
+	 *
+	 * When enabled, unicast requests without a timeout use a timeout
+	 * calculated from the time between the end of previous requests to the
+	 * same device and the start of their responses (the smoothed round-trip
+	 * time plus four times its mean deviation, like TCP). The timeout is
+	 * doubled after each timeout until another response is received.
+	 * Requests to devices without a round-trip time estimate use the default
+	 * unicast timeout.
+	 *
+	 * Estimates are kept for up to UUID_MODBUS_DEVICE_TABLE_SIZE devices.
+	 *
+	 * @param[in] min_timeout_ms Minimum timeout to wait for a response in
+	 *                           milliseconds.
+	 * @param[in] max_timeout_ms Maximum timeout to wait for a response in
+	 *                           milliseconds (0 = disable adaptive
+	 *                           timeouts).
+	 * @since 0.3.0
+	 */
+	void adaptive_timeout_ms(uint16_t min_timeout_ms, uint16_t max_timeout_ms);
+
+	/**
+	 * Get the smoothed round-trip time of a device.
+	 *
+	 * @param[in] device Device address.
+	 * @return Time between the end of a request and the start of its
+	 *         response in microseconds (0 if unknown).
+	 * @since 0.3.0
+	 */
+	uint32_t round_trip_time_us(uint16_t device) const;
+
+	/**
+	 * Get the number of consecutive timeouts before requests to a device
+	 * fail without being sent.
+	 *
+	 * @return Number of consecutive timeouts (0 = circuit breaker disabled).
+	 * @since 0.3.0
+	 */
+	inline uint8_t circuit_breaker_threshold() const { return circuit_breaker_threshold_; }
+
+	/**
+	 * Get the minimum interval between requests to a device that is not
+	 * responding.
+	 *
+	 * @return Minimum retry interval in milliseconds.
+	 * @since 0.3.0
+	 */
+	inline uint32_t min_circuit_retry_ms() const { return min_circuit_retry_ms_; }
+
+	/**
+	 * Get the maximum interval between requests to a device that is not
+	 * responding.
+	 *
+	 * @return Maximum retry interval in milliseconds.
+	 * @since 0.3.0
+	 */
+	inline uint32_t max_circuit_retry_ms() const { return max_circuit_retry_ms_; }
+
+	/**
+	 * Configure the circuit breaker for devices that are not responding.
+	 *
+	 * When a device has not responded to the specified number of
+	 * consecutive unicast requests, the circuit breaker for that device is
+	 * opened. Queued and new requests to the device then fail with a status
+	 * of ResponseStatus::FAILURE_UNAVAILABLE without being sent.
+	 *
+	 * After the retry interval a single request is sent to the device. If it
+	 * responds then the circuit breaker is closed, otherwise the retry
+	 * interval is doubled (up to the maximum) and the circuit breaker is
+	 * opened again.
+	 *
+	 * The state of up to UUID_MODBUS_DEVICE_TABLE_SIZE devices is kept.
+	 *
+	 * @param[in] threshold Number of consecutive timeouts (0 = disable the
+	 *                      circuit breaker).
+	 * @param[in] min_retry_ms Minimum retry interval in milliseconds.
+	 * @param[in] max_retry_ms Maximum retry interval in milliseconds.
+	 * @since 0.3.0
+	 */
+	void circuit_breaker(uint8_t threshold, uint32_t min_retry_ms, uint32_t max_retry_ms);
+
+	/**
+	 * Get the state of the circuit breaker for a device.
+	 *
+	 * @param[in] device Device address.
+	 * @return State of the circuit breaker (CircuitState::CLOSED if the
+	 *         device is not known).
+	 * @since 0.3.0
+	 */
+	CircuitState circuit_state(uint16_t device) const;
+
+	/**
+	 * Get the number of consecutive requests that a device has not
+	 * responded to.
+	 *
+	 * Only counted when the circuit breaker is enabled.
+	 *
+	 * @param[in] device Device address.
+	 * @return Number of consecutive timeouts.
+	 * @since 0.3.0
+	 */
+	uint8_t consecutive_timeouts(uint16_t device) const;
+
+	/**
+	 * Get the default timeout for new unicast requests.
+	 *
+	 * @return Timeout to wait for a response in milliseconds.
+	 * @since 0.2.0
+	 */
+	inline uint16_t default_unicast_timeout_ms() const { return default_unicast_timeout_ms_; }
+	/**
+	 * Set the default timeout for new unicast requests.
+	 *
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds.
+	 * @since 0.2.0
+	 */
+	inline void default_unicast_timeout_ms(uint16_t timeout_ms) { default_unicast_timeout_ms_ = timeout_ms; }
+
+	/**
+	 * Get the default timeout for new broadcast requests.
+	 *
+	 * @return Delay after a request in milliseconds.
+	 * @since 0.2.0
+	 */
+	inline uint16_t default_broadcast_delay_ms() const { return default_broadcast_timeout_ms_; }
+	/**
+	 * Set the default timeout for new broadcast requests.
+	 *
+	 * @param[in] timeout_ms Delay after a request in milliseconds.
+	 * @since 0.2.0
+	 */
+	inline void default_broadcast_delay_ms(uint16_t timeout_ms) { default_broadcast_timeout_ms_ = timeout_ms; }
+
+	/**
+	 * Determine if writes of single holding registers are in write-behind
+	 * mode.
+	 *
+	 * @return True if write-behind mode is enabled, otherwise false.
+	 * @since 0.3.0
+	 */
+	inline bool write_behind() const { return write_behind_; }
+	/**
+	 * Enable or disable write-behind mode for writes of single holding
+	 * registers.
+	 *
+	 * In write-behind mode, a write that follows a queued write to the same
+	 * device (that has not been transmitted yet) replaces the value of the
+	 * same register or is combined with it if the register is adjacent. All
+	 * of the combined writes have the outcome of the final request. The
+	 * address() of each response is the register that it wrote and the data()
+	 * is the value that was written to that register (which is the value of
+	 * the last write to the same register).
+	 *
+	 * @param[in] enabled Enable write-behind mode.
+	 * @since 0.3.0
+	 */
+	inline void write_behind(bool enabled) { write_behind_ = enabled; }
+
+	/**
+	 * Get the maximum time that requests can wait in the queue.
+	 *
+	 * @return Maximum time before a request is transmitted in milliseconds
+	 *         (0 = no limit).
+	 * @since 0.3.0
+	 */
+	inline uint32_t queue_timeout_ms() const { return requests_.default_timeout_ms(); }
+	/**
+	 * Set the default maximum time that new requests can wait in the queue.
+	 *
+	 * Requests that have not been transmitted within this time of being
+	 * queued are removed from the queue with a status of
+	 * ResponseStatus::FAILURE_EXPIRED. This is in addition to the timeout for
+	 * a response that starts after the request is transmitted.
+	 *
+	 * Requests that are already queued keep the time that they had when they
+	 * were queued.
+	 *
+	 * @param[in] timeout_ms Maximum time before a request is transmitted in
+	 *                       milliseconds (0 = no limit).
+	 * @since 0.3.0
+	 */
+	inline void queue_timeout_ms(uint32_t timeout_ms) { requests_.default_timeout_ms(timeout_ms); }
+	/**
+	 * Set the maximum time that a request can wait in the queue, instead of
+	 * the default.
+	 *
+	 * The time is from when the request was queued. If it has already passed
+	 * then the request expires on the next call to loop(). Requests that
+	 * have been attached to another request (by read coalescing or
+	 * write-behind mode) have the time of the other request.
+	 *
+	 * @param[in] response Response to the request.
+	 * @param[in] timeout_ms Maximum time before the request is transmitted in
+	 *                       milliseconds (0 = no limit).
+	 * @return True if the request is still queued, otherwise false.
+	 * @since 0.3.0
+	 */
+	bool queue_timeout_ms(const Response &response, uint32_t timeout_ms);
+
+	/**
+	 * Cancel a request that has not been transmitted yet.
+	 *
+	 * The request is removed from the queue and the response is completed
+	 * with a status of ResponseStatus::FAILURE_CANCELLED. Requests that have
+	 * been attached to another request (by read coalescing or write-behind
+	 * mode) can't be cancelled.
+	 *
+	 * Queued read requests where the response has no other handles and no
+	 * callback are cancelled automatically. Write requests are always
+	 * transmitted.
+	 *
+	 * @param[in] response Response to the request.
+	 * @return True if the request was cancelled, otherwise false.
+	 * @since 0.3.0
+	 */
+	bool cancel(const Response &response);
+
+	/**
+	 * Read a contiguous block of coils from a remote device.
+	 *
+	 * The response message contains the coil values returned.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] size Quantity of coils (0x0001 to 0x07D0).
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and data in the
+	 *         future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const BitDataResponse> read_coils(uint16_t device,
+		uint16_t address, uint16_t size, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read a contiguous block of coils from a remote device.
+	 *
+	 * The callback is called once when the response is complete (including
+	 * if the request fails immediately, before this function returns).
+	 *
+	 * The response message contains the coil values returned.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] size Quantity of coils (0x0001 to 0x07D0).
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and data in the
+	 *         future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const BitDataResponse> read_coils(uint16_t device,
+		uint16_t address, uint16_t size,
+		const ResponseCallback<BitDataResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read a contiguous block of discrete inputs from a remote device.
+	 *
+	 * The response message contains the discrete input values returned.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] size Quantity of discrete inputs (0x0001 to 0x07D0).
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and data in the
+	 *         future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const BitDataResponse> read_discrete_inputs(uint16_t device,
+		uint16_t address, uint16_t size, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read a contiguous block of discrete inputs from a remote device.
+	 *
+	 * The callback is called once when the response is complete (including
+	 * if the request fails immediately, before this function returns).
+	 *
+	 * The response message contains the discrete input values returned.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] size Quantity of discrete inputs (0x0001 to 0x07D0).
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and data in the
+	 *         future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const BitDataResponse> read_discrete_inputs(uint16_t device,
+		uint16_t address, uint16_t size,
+		const ResponseCallback<BitDataResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Write to a single coil in a remote device.
+	 *
+	 * The response message contains the coil address followed by the coil
+	 * value returned (0xFF00 for on or 0x0000 for off).
+	 *
+	 * For a broadcast request, use timeout_ms to set the turnaround delay.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::BROADCAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Coil address (0x0000 to 0xFFFF).
+	 * @param[in] value Coil value.
+	 * @param[in] timeout_ms Timeout to wait for a response (or turnaround delay) in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and echoed data
+	 *         in the future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterWriteResponse> write_coil(uint16_t device,
+		uint16_t address, bool value, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Write to a single coil in a remote device.
+	 *
+	 * The callback is called once when the response is complete (including
+	 * if the request fails immediately, before this function returns).
+	 *
+	 * The response message contains the coil address followed by the coil
+	 * value returned (0xFF00 for on or 0x0000 for off).
+	 *
+	 * For a broadcast request, use timeout_ms to set the turnaround delay.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::BROADCAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Coil address (0x0000 to 0xFFFF).
+	 * @param[in] value Coil value.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response (or turnaround delay) in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and echoed data
+	 *         in the future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterWriteResponse> write_coil(uint16_t device,
+		uint16_t address, bool value,
+		const ResponseCallback<RegisterWriteResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Write to a contiguous block of coils in a remote device.
+	 *
+	 * The coil values are packed 8 per byte, least significant bit first. They
+	 * are not copied so they must remain valid and unmodified until the
+	 * response is complete.
+	 *
+	 * The response message contains the starting address followed by the
+	 * quantity of coils written.
+	 *
+	 * For a broadcast request, use timeout_ms to set the turnaround delay.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::BROADCAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] values Packed coil values.
+	 * @param[in] size Quantity of coils (0x0001 to 0x07B0).
+	 * @param[in] timeout_ms Timeout to wait for a response (or turnaround delay) in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and echoed data
+	 *         in the future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterWriteResponse> write_coils(uint16_t device,
+		uint16_t address, const uint8_t *values, uint16_t size, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Write to a contiguous block of coils in a remote device.
+	 *
+	 * The coil values are packed 8 per byte, least significant bit first. They
+	 * are not copied so they must remain valid and unmodified until the
+	 * response is complete.
+	 *
+	 * The callback is called once when the response is complete (including
+	 * if the request fails immediately, before this function returns).
+	 *
+	 * The response message contains the starting address followed by the
+	 * quantity of coils written.
+	 *
+	 * For a broadcast request, use timeout_ms to set the turnaround delay.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::BROADCAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] values Packed coil values.
+	 * @param[in] size Quantity of coils (0x0001 to 0x07B0).
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response (or turnaround delay) in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and echoed data
+	 *         in the future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterWriteResponse> write_coils(uint16_t device,
+		uint16_t address, const uint8_t *values, uint16_t size,
+		const ResponseCallback<RegisterWriteResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read a contiguous block of holding registers from a remote device.
+	 *
+	 * The response message contains the register values returned.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] size Quantity of registers (0x0001 to 0x007D).
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and data in the
+	 *         future when processing is complete.
+	 * @since 0.1.0
+	 */
+	ResponseHandle<const RegisterDataResponse> read_holding_registers(uint16_t device,
+		uint16_t address, uint16_t size, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read a contiguous block of holding registers from a remote device.
+	 *
+	 * The callback is called once when the response is complete (including
+	 * if the request fails immediately, before this function returns).
+	 *
+	 * The response message contains the register values returned.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] size Quantity of registers (0x0001 to 0x007D).
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and data in the
+	 *         future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterDataResponse> read_holding_registers(uint16_t device,
+		uint16_t address, uint16_t size,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read a contiguous block of input registers from a remote device.
+	 *
+	 * The response message contains the register values returned.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] size Quantity of registers (0x0001 to 0x007D).
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and data in the
+	 *         future when processing is complete.
+	 * @since 0.1.0
+	 */
+	ResponseHandle<const RegisterDataResponse> read_input_registers(uint16_t device,
+		uint16_t address, uint16_t size, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read a contiguous block of input registers from a remote device.
+	 *
+	 * The callback is called once when the response is complete (including
+	 * if the request fails immediately, before this function returns).
+	 *
+	 * The response message contains the register values returned.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] size Quantity of registers (0x0001 to 0x007D).
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and data in the
+	 *         future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterDataResponse> read_input_registers(uint16_t device,
+		uint16_t address, uint16_t size,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read a contiguous block of holding registers of any size from a remote device.
+	 *
+	 * The block is split into the minimum number of requests of up to
+	 * MAX_READ_REGISTERS each, which are queued as each one completes
+	 * (without waiting for the application) with the same priority. Register
+	 * values are stored directly in the caller's storage, which must remain
+	 * valid until the response is complete.
+	 *
+	 * The response status is ResponseStatus::SUCCESS if every request was
+	 * successful, otherwise it is the status of the first request that failed.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[out] values Storage for the register values.
+	 * @param[in] size Quantity of registers (1 to 0x10000 - address).
+	 * @param[in] timeout_ms Timeout to wait for each response in milliseconds (0 = default).
+	 * @param[in] priority Priority of each request.
+	 * @return A response message that will contain the outcome in the future
+	 *         when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterBlockResponse> read_holding_register_block(uint16_t device,
+		uint16_t address, uint16_t *values, uint32_t size, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read a contiguous block of holding registers of any size from a remote device.
+	 *
+	 * The block is split into the minimum number of requests of up to
+	 * MAX_READ_REGISTERS each, which are queued as each one completes
+	 * (without waiting for the application) with the same priority. Register
+	 * values are stored directly in the caller's storage, which must remain
+	 * valid until the response is complete.
+	 *
+	 * The callback is called once when all of the requests are complete
+	 * (including if the block read fails immediately, before this function
+	 * returns).
+	 *
+	 * The response status is ResponseStatus::SUCCESS if every request was
+	 * successful, otherwise it is the status of the first request that failed.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[out] values Storage for the register values.
+	 * @param[in] size Quantity of registers (1 to 0x10000 - address).
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for each response in milliseconds (0 = default).
+	 * @param[in] priority Priority of each request.
+	 * @return A response message that will contain the outcome in the future
+	 *         when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterBlockResponse> read_holding_register_block(uint16_t device,
+		uint16_t address, uint16_t *values, uint32_t size,
+		const ResponseCallback<RegisterBlockResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read a contiguous block of input registers of any size from a remote device.
+	 *
+	 * The block is split into the minimum number of requests of up to
+	 * MAX_READ_REGISTERS each, which are queued as each one completes
+	 * (without waiting for the application) with the same priority. Register
+	 * values are stored directly in the caller's storage, which must remain
+	 * valid until the response is complete.
+	 *
+	 * The response status is ResponseStatus::SUCCESS if every request was
+	 * successful, otherwise it is the status of the first request that failed.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[out] values Storage for the register values.
+	 * @param[in] size Quantity of registers (1 to 0x10000 - address).
+	 * @param[in] timeout_ms Timeout to wait for each response in milliseconds (0 = default).
+	 * @param[in] priority Priority of each request.
+	 * @return A response message that will contain the outcome in the future
+	 *         when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterBlockResponse> read_input_register_block(uint16_t device,
+		uint16_t address, uint16_t *values, uint32_t size, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read a contiguous block of input registers of any size from a remote device.
+	 *
+	 * The block is split into the minimum number of requests of up to
+	 * MAX_READ_REGISTERS each, which are queued as each one completes
+	 * (without waiting for the application) with the same priority. Register
+	 * values are stored directly in the caller's storage, which must remain
+	 * valid until the response is complete.
+	 *
+	 * The callback is called once when all of the requests are complete
+	 * (including if the block read fails immediately, before this function
+	 * returns).
+	 *
+	 * The response status is ResponseStatus::SUCCESS if every request was
+	 * successful, otherwise it is the status of the first request that failed.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[out] values Storage for the register values.
+	 * @param[in] size Quantity of registers (1 to 0x10000 - address).
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for each response in milliseconds (0 = default).
+	 * @param[in] priority Priority of each request.
+	 * @return A response message that will contain the outcome in the future
+	 *         when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterBlockResponse> read_input_register_block(uint16_t device,
+		uint16_t address, uint16_t *values, uint32_t size,
+		const ResponseCallback<RegisterBlockResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Write to a single holding register in a remote device.
+	 *
+	 * The response message contains the register address followed by the
+	 * register value returned.
+	 *
+	 * For a broadcast request, use timeout_ms to set the turnaround delay.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::BROADCAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Register address (0x0000 to 0xFFFF).
+	 * @param[in] value Register value.
+	 * @param[in] timeout_ms Timeout to wait for a response (or turnaround delay) in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and echoed data
+	 *         in the future when processing is complete.
+	 * @since 0.1.0
+	 */
+	ResponseHandle<const RegisterWriteResponse> write_holding_register(uint16_t device,
+		uint16_t address, uint16_t value, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Write to a single holding register in a remote device.
+	 *
+	 * The callback is called once when the response is complete (including
+	 * if the request fails immediately, before this function returns).
+	 *
+	 * The response message contains the register address followed by the
+	 * register value returned.
+	 *
+	 * For a broadcast request, use timeout_ms to set the turnaround delay.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::BROADCAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Register address (0x0000 to 0xFFFF).
+	 * @param[in] value Register value.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response (or turnaround delay) in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and echoed data
+	 *         in the future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterWriteResponse> write_holding_register(uint16_t device,
+		uint16_t address, uint16_t value,
+		const ResponseCallback<RegisterWriteResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Write to a contiguous block of holding registers in a remote device.
+	 *
+	 * The register values are not copied. They must remain valid and
+	 * unmodified until the response is complete.
+	 *
+	 * The response message contains the starting address followed by the
+	 * quantity of registers written.
+	 *
+	 * For a broadcast request, use timeout_ms to set the turnaround delay.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::BROADCAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] values Register values.
+	 * @param[in] size Quantity of registers (0x0001 to 0x007B).
+	 * @param[in] timeout_ms Timeout to wait for a response (or turnaround delay) in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and echoed data
+	 *         in the future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterWriteResponse> write_holding_registers(uint16_t device,
+		uint16_t address, const uint16_t *values, uint16_t size, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Write to a contiguous block of holding registers in a remote device.
+	 *
+	 * The register values are not copied. They must remain valid and
+	 * unmodified until the response is complete.
+	 *
+	 * The callback is called once when the response is complete (including
+	 * if the request fails immediately, before this function returns).
+	 *
+	 * The response message contains the starting address followed by the
+	 * quantity of registers written.
+	 *
+	 * For a broadcast request, use timeout_ms to set the turnaround delay.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::BROADCAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address (0x0000 to 0xFFFF).
+	 * @param[in] values Register values.
+	 * @param[in] size Quantity of registers (0x0001 to 0x007B).
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response (or turnaround delay) in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and echoed data
+	 *         in the future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterWriteResponse> write_holding_registers(uint16_t device,
+		uint16_t address, const uint16_t *values, uint16_t size,
+		const ResponseCallback<RegisterWriteResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Write to a contiguous block of holding registers and then read a
+	 * contiguous block of holding registers from a remote device in a single
+	 * request.
+	 *
+	 * The register values are not copied. They must remain valid and
+	 * unmodified until the response is complete.
+	 *
+	 * The response message contains the register values read.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] read_address Starting address to read (0x0000 to 0xFFFF).
+	 * @param[in] read_size Quantity of registers to read (0x0001 to 0x007D).
+	 * @param[in] write_address Starting address to write (0x0000 to 0xFFFF).
+	 * @param[in] values Register values to write.
+	 * @param[in] write_size Quantity of registers to write (0x0001 to 0x0079).
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and data in the
+	 *         future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterDataResponse> read_write_holding_registers(uint16_t device,
+		uint16_t read_address, uint16_t read_size, uint16_t write_address,
+		const uint16_t *values, uint16_t write_size, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Write to a contiguous block of holding registers and then read a
+	 * contiguous block of holding registers from a remote device in a single
+	 * request.
+	 *
+	 * The register values are not copied. They must remain valid and
+	 * unmodified until the response is complete.
+	 *
+	 * The callback is called once when the response is complete (including
+	 * if the request fails immediately, before this function returns).
+	 *
+	 * The response message contains the register values read.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] read_address Starting address to read (0x0000 to 0xFFFF).
+	 * @param[in] read_size Quantity of registers to read (0x0001 to 0x007D).
+	 * @param[in] write_address Starting address to write (0x0000 to 0xFFFF).
+	 * @param[in] values Register values to write.
+	 * @param[in] write_size Quantity of registers to write (0x0001 to 0x0079).
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and data in the
+	 *         future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterDataResponse> read_write_holding_registers(uint16_t device,
+		uint16_t read_address, uint16_t read_size, uint16_t write_address,
+		const uint16_t *values, uint16_t write_size,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read exception status from a remote device.
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and output data
+	 *         in the future when processing is complete.
+	 * @since 0.1.0
+	 */
+	ResponseHandle<const ExceptionStatusResponse> read_exception_status(uint16_t device,
+		uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+	/**
+	 * Read exception status from a remote device.
+	 *
+	 * The callback is called once when the response is complete (including
+	 * if the request fails immediately, before this function returns).
+	 *
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response message that will contain the outcome and output data
+	 *         in the future when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const ExceptionStatusResponse> read_exception_status(uint16_t device,
+		const ResponseCallback<ExceptionStatusResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
+
+protected:
+	BaseClient() = default;
+	~BaseClient() = default;
+
+	/**
+	 * Attach a read request to an identical or larger read request that is
+	 * still queued, instead of queuing another request.
+	 *
+	 * @param[in] function_code Read function code.
+	 * @param[in] device Device address.
+	 * @param[in] address Starting address.
+	 * @param[in] size Quantity of registers.
+	 * @param[in] response Response object.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] priority Priority of the request.
+	 * @return True if the read request was attached, otherwise false.
+	 * @since 0.3.0
+	 */
+	bool coalesce_read(uint8_t function_code, uint16_t device,
+		uint16_t address, uint16_t size,
+		const ResponseHandle<RegisterDataResponse> &response,
+		const ResponseCallback<RegisterDataResponse> &callback,
+		RequestPriority priority);
+
+	/**
+	 * Combine a write of a single holding register with the most recent
+	 * request to the same device if it is a write that is still queued.
+	 *
+	 * @param[in] device Device address.
+	 * @param[in] address Register address.
+	 * @param[in] value Register value.
+	 * @param[in] response Response object.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] priority Priority of the request.
+	 * @return True if the write was combined with a queued write, otherwise
+	 *         false.
+	 * @since 0.3.0
+	 */
+	bool coalesce_write(uint16_t device, uint16_t address, uint16_t value,
+		const ResponseHandle<RegisterWriteResponse> &response,
+		const ResponseCallback<RegisterWriteResponse> &callback,
+		RequestPriority priority);
+
+	/**
+	 * Determine if the response to a function can have other responses
+	 * attached to it.
+	 *
+	 * @param[in] function_code Function code of the request.
+	 * @return True if the response is a RegisterDataResponse that other
+	 *         responses can be attached to, otherwise false.
+	 * @since 0.3.0
+	 */
+	static inline bool attachable(uint8_t function_code) {
+		return function_code == FunctionCode::READ_HOLDING_REGISTERS
+			|| function_code == FunctionCode::READ_INPUT_REGISTERS
+			|| function_code == FunctionCode::WRITE_SINGLE_REGISTER
+			|| function_code == FunctionCode::WRITE_MULTIPLE_REGISTERS;
+	}
+
+	/**
+	 * Determine if nothing is waiting for the response to a read request.
+	 *
+	 * @param[in] request Request to check.
+	 * @return True if the request is a read and the response has no other
+	 *         handles, no callback and no attached responses, otherwise
+	 *         false.
+	 * @since 0.3.0
+	 */
+	bool abandoned(const Request &request) const;
+
+	/**
+	 * Remove queued requests that have expired or been abandoned.
+	 *
+	 * @since 0.3.0
+	 */
+	void expire();
+
+	/**
+	 * Remove a request from the queue and then call its callback (and those
+	 * of any attached responses).
+	 *
+	 * The response must be complete.
+	 *
+	 * @param[in] index Position in the queue.
+	 * @since 0.3.0
+	 */
+	void finish(size_t index);
+
+	/**
+	 * State of a device.
+	 *
+	 * @since 0.3.0
+	 */
+	struct DeviceState {
+		uint32_t used_ms = 0; /*!< Time that the state was last updated. @since 0.3.0 */
+		uint32_t srtt_us = 0; /*!< Smoothed round-trip time in microseconds. @since 0.3.0 */
+		uint32_t rttvar_us = 0; /*!< Round-trip time mean deviation in microseconds. @since 0.3.0 */
+		uint8_t device = DeviceAddressType::BROADCAST; /*!< Device address (DeviceAddressType::BROADCAST if unused). @since 0.3.0 */
+		uint8_t backoff = 0; /*!< Number of times the timeout has been doubled. @since 0.3.0 */
+		uint32_t opened_ms = 0; /*!< Time that the circuit breaker was opened. @since 0.3.0 */
+		uint8_t timeouts = 0; /*!< Number of consecutive timeouts. @since 0.3.0 */
+		uint8_t retry_backoff = 0; /*!< Number of times the retry interval has been doubled. @since 0.3.0 */
+		CircuitState circuit = CircuitState::CLOSED; /*!< State of the circuit breaker. @since 0.3.0 */
+	};
+
+	/**
+	 * Find the state of a device.
+	 *
+	 * @param[in] device Device address.
+	 * @return State of the device (or nullptr if it is not known).
+	 * @since 0.3.0
+	 */
+	const DeviceState* find_device(uint16_t device) const;
+
+	/**
+	 * Find or create the state of a device.
+	 *
+	 * Replaces the least recently updated device state if there are no
+	 * unused entries.
+	 *
+	 * @param[in] device Device address.
+	 * @return State of the device.
+	 * @since 0.3.0
+	 */
+	DeviceState& device_state(uint16_t device);
+
+	/**
+	 * Get the timeout for a new unicast request.
+	 *
+	 * @param[in] device Device address.
+	 * @return Timeout to wait for a response in milliseconds.
+	 * @since 0.3.0
+	 */
+	uint16_t unicast_timeout_ms(uint16_t device) const;
+
+	/**
+	 * Update the round-trip time estimate of a device.
+	 *
+	 * @param[in] device Device address.
+	 * @param[in] rtt_us Time between the end of the request and the start of
+	 *                   the response in microseconds.
+	 * @since 0.3.0
+	 */
+	void update_round_trip_time(uint16_t device, uint32_t rtt_us);
+
+	/**
+	 * Record a timeout waiting for a response from a device.
+	 *
+	 * Doubles the adaptive timeout of the device and opens the circuit
+	 * breaker if the device has reached the threshold of consecutive
+	 * timeouts.
+	 *
+	 * @param[in] device Device address.
+	 * @since 0.3.0
+	 */
+	void device_timeout(uint16_t device);
+
+	/**
+	 * Record a response from a device, closing the circuit breaker.
+	 *
+	 * @param[in] device Device address.
+	 * @since 0.3.0
+	 */
+	void device_response(uint16_t device);
+
+	/**
+	 * Determine if requests to a device must fail without being sent
+	 * because the circuit breaker is open, or because it is half-open and
+	 * another request to the device is already in progress.
+	 *
+	 * @param[in] device Device address.
+	 * @return True if the device is unavailable, otherwise false.
+	 * @since 0.3.0
+	 */
+	bool device_unavailable(uint16_t device) const;
+
+	/**
+	 * Mark the circuit breaker of a device as half-open when a request is
+	 * sent to it after the retry interval.
+	 *
+	 * @param[in] device Device address.
+	 * @since 0.3.0
+	 */
+	void device_retry(uint16_t device);
+
+	/**
+	 * Open the circuit breaker of a device again if a request sent after
+	 * the retry interval timed out, doubling the retry interval.
+	 *
+	 * Other failures (e.g. an invalid response) leave the circuit breaker
+	 * half-open so that the next request is sent to the device.
+	 *
+	 * @param[in] device Device address.
+	 * @since 0.3.0
+	 */
+	void device_retry_failed(uint16_t device);
+
+	/**
+	 * Get the current retry interval for a device that is not responding.
+	 *
+	 * @param[in] state State of the device.
+	 * @return Retry interval in milliseconds.
+	 * @since 0.3.0
+	 */
+	uint32_t retry_interval_ms(const DeviceState &state) const;
+
+	/**
+	 * Start a block read.
+	 *
+	 * @param[in] function_code Read function code.
+	 * @param[in] device Device address.
+	 * @param[in] address Starting address.
+	 * @param[out] values Storage for the register values.
+	 * @param[in] size Quantity of registers.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for each response in milliseconds (0 = default).
+	 * @param[in] priority Priority of each request.
+	 * @return A response message that will contain the outcome in the future
+	 *         when processing is complete.
+	 * @since 0.3.0
+	 */
+	ResponseHandle<const RegisterBlockResponse> read_register_block(
+		uint8_t function_code, uint16_t device, uint16_t address,
+		uint16_t *values, uint32_t size,
+		const ResponseCallback<RegisterBlockResponse> &callback,
+		uint16_t timeout_ms, RequestPriority priority);
+
+	/**
+	 * Get the earliest time that a queued request will expire.
+	 *
+	 * @return Time until a queued request expires in microseconds
+	 *         (WAIT_FOR_INPUT if there are no requests that can expire).
+	 * @since 0.3.0
+	 */
+	uint32_t next_expiry_us() const;
+
+	/**
+	 * Populate the response to a request from a received message frame
+	 * (excluding any header or checksum that is specific to how it was
+	 * received).
+	 *
+	 * @param[in] request Request that the message frame is a response to.
+	 * @param[in] frame Message frame buffer, starting with the device
+	 *                  address.
+	 * @param[in] len Size of message frame.
+	 * @param[in] rtt_us Time between the end of the request and the start
+	 *                   of the response in microseconds.
+	 * @since 0.3.0
+	 */
+	void parse_response(Request &request, frame_buffer_t &frame, uint16_t len, uint32_t rtt_us);
+
+	RequestQueue requests_; /*!< Pending requests. @since 0.3.0 */
+	uint16_t default_unicast_timeout_ms_ = DEFAULT_UNICAST_TIMEOUT_MS; /*!< Default timeout for new unicast requests. @since 0.2.0 */
+	uint16_t default_broadcast_timeout_ms_ = DEFAULT_BROADCAST_TIMEOUT_MS; /*!< Default timeout for new broadcast requests. @since 0.2.0 */
+	bool write_behind_ = false; /*!< Combine writes of single holding registers with queued writes. @since 0.3.0 */
+	uint16_t min_adaptive_timeout_ms_ = 0; /*!< Minimum adaptive timeout for unicast requests. @since 0.3.0 */
+	uint16_t max_adaptive_timeout_ms_ = 0; /*!< Maximum adaptive timeout for unicast requests (0 = disabled). @since 0.3.0 */
+	uint8_t circuit_breaker_threshold_ = 0; /*!< Number of consecutive timeouts before the circuit breaker opens (0 = disabled). @since 0.3.0 */
+	uint32_t min_circuit_retry_ms_ = 0; /*!< Minimum retry interval for devices that are not responding. @since 0.3.0 */
+	uint32_t max_circuit_retry_ms_ = 0; /*!< Maximum retry interval for devices that are not responding. @since 0.3.0 */
+	std::array<DeviceState, UUID_MODBUS_DEVICE_TABLE_SIZE> devices_; /*!< State of recently used devices. @since 0.3.0 */
+	uint32_t min_timeout_margin_us_ = INTER_FRAME_TIMEOUT_MS * 1000; /*!< Minimum time to allow for variation in the round-trip time of adaptive timeouts. @since 0.3.0 */
+};
+
+/**
+ * Byte stream of a serial port device.
+ *
+ * Characters are only written when there is space in the transmit buffer
+ * so that writes never block. The line configuration is used to determine
+ * the inter-character and inter-frame timeouts.
+ *
+ * @since 0.3.0
+ */
+class SerialStream {
+public:
+	/**
+	 * Create a new byte stream.
+	 *
+	 * The inter-frame timeout will be INTER_FRAME_TIMEOUT_MS until the line
+	 * configuration is set.
+	 *
+	 * @param[in] serial Serial port device.
+	 * @since 0.3.0
+	 */
+	SerialStream(::HardwareSerial &serial) : serial_(serial) {}
+
+	/**
+	 * Set the line configuration of the serial port device, which is used to
+	 * determine the inter-character and inter-frame timeouts.
+	 *
+	 * Baud rates above FIXED_TIMEOUT_BAUD_RATE use fixed timeouts of
+	 * MIN_INTER_CHARACTER_TIMEOUT_US and MIN_INTER_FRAME_TIMEOUT_US.
+	 *
+	 * @param[in] baud_rate Baud rate of the serial port device.
+	 * @param[in] parity Parity of the serial port device.
+	 * @param[in] stop_bits Number of stop bits of the serial port device.
+	 * @since 0.3.0
+	 */
+	void line_config(uint32_t baud_rate, SerialParity parity, uint8_t stop_bits);
+
+	/**
+	 * Get the inter-character timeout (1.5 character times).
+	 *
+	 * @return Inter-character timeout in microseconds.
+	 * @since 0.3.0
+	 */
+	inline uint32_t inter_character_timeout_us() const { return inter_character_timeout_us_; }
+
+	/**
+	 * Get the inter-frame timeout (3.5 character times).
+	 *
+	 * @return Inter-frame timeout in microseconds.
+	 * @since 0.3.0
+	 */
+	inline uint32_t inter_frame_timeout_us() const { return inter_frame_timeout_us_; }
+
+	/**
+	 * Get the time to transmit one character.
+	 *
+	 * @return Character time in microseconds.
+	 * @since 0.3.0
+	 */
+	inline uint32_t character_time_us() const { return character_time_us_; }
+
+	/**
+	 * Determine if the byte stream is connected.
+	 *
+	 * @return True (a serial port device is always connected).
+	 * @since 0.3.0
+	 */
+	inline bool connected() const { return true; }
+
+	/**
+	 * Close the byte stream (a serial port device can't be closed).
+	 *
+	 * @since 0.3.0
+	 */
+	inline void stop() {}
+
+	/**
+	 * Get the number of bytes available to read.
+	 *
+	 * @return Number of bytes available to read.
+	 * @since 0.3.0
+	 */
+	inline int available() { return serial_.available(); }
+
+	/**
+	 * Read one byte.
+	 *
+	 * @return Byte that was read, or -1 if there is no data available.
+	 * @since 0.3.0
+	 */
+	inline int read() { return serial_.read(); }
+
+	/**
+	 * Read bytes that are available into a buffer.
+	 *
+	 * @param[out] buffer Buffer to read into.
+	 * @param[in] length Maximum number of bytes to read, which must not be
+	 *                   more than are available.
+	 * @return Number of bytes read.
+	 * @since 0.3.0
+	 */
+	size_t read(uint8_t *buffer, size_t length);
+
+	/**
+	 * Write as many bytes as there is space for in the transmit buffer.
+	 *
+	 * @param[in] buffer Buffer to write from.
+	 * @param[in] length Number of bytes to write.
+	 * @return Number of bytes written.
+	 * @since 0.3.0
+	 */
+	inline size_t write(const uint8_t *buffer, size_t length) {
+		int available = serial_.availableForWrite();
+
+		if (available <= 0) {
+			return 0;
+		}
+
+		return serial_.write(buffer, std::min(static_cast<size_t>(available), length));
+	}
+
+private:
+	::HardwareSerial &serial_; /*!< Serial port device. @since 0.1.0 */
+	uint32_t inter_character_timeout_us_ = INTER_FRAME_TIMEOUT_MS * 1000 * 3 / 7; /*!< Inter-character timeout in microseconds. @since 0.3.0 */
+	uint32_t inter_frame_timeout_us_ = INTER_FRAME_TIMEOUT_MS * 1000; /*!< Inter-frame timeout in microseconds. @since 0.3.0 */
+	uint32_t character_time_us_ = INTER_FRAME_TIMEOUT_MS * 1000 * 2 / 7; /*!< Time to transmit one character in microseconds. @since 0.3.0 */
+};
+
+/**
+ * Byte stream of a network connection.
+ *
+ * The timing of individual characters is not preserved, so there is no
+ * inter-frame timeout.
+ *
+ * @since 0.3.0
+ */
+class NetworkStream {
+public:
+	/**
+	 * Create a new byte stream.
+	 *
+	 * @param[in] client Network client, which must be connected to the
+	 *                   server before requests can be sent.
+	 * @since 0.3.0
+	 */
+	NetworkStream(::Client &client) : client_(client) {}
+
+	/**
+	 * Get the inter-frame timeout.
+	 *
+	 * @return 0 (message frames can't be delimited by time).
+	 * @since 0.3.0
+	 */
+	inline uint32_t inter_frame_timeout_us() const { return 0; }
+
+	/**
+	 * Get the time to transmit one character.
+	 *
+	 * @return 0 (there is no fixed character time).
+	 * @since 0.3.0
+	 */
+	inline uint32_t character_time_us() const { return 0; }
+
+	/**
+	 * Determine if the byte stream is connected.
+	 *
+	 * @return True if the network client is connected, otherwise false.
+	 * @since 0.3.0
+	 */
+	inline bool connected() const { return client_.connected(); }
+
+	/**
+	 * Close the network connection.
+	 *
+	 * @since 0.3.0
+	 */
+	inline void stop() { client_.stop(); }
+
+	/**
+	 * Get the number of bytes available to read.
+	 *
+	 * @return Number of bytes available to read.
+	 * @since 0.3.0
+	 */
+	inline int available() { return client_.available(); }
+
+	/**
+	 * Read one byte.
+	 *
+	 * @return Byte that was read, or -1 if there is no data available.
+	 * @since 0.3.0
+	 */
+	inline int read() { return client_.read(); }
+
+	/**
+	 * Read bytes that are available into a buffer.
+	 *
+	 * @param[out] buffer Buffer to read into.
+	 * @param[in] length Maximum number of bytes to read.
+	 * @return Number of bytes read.
+	 * @since 0.3.0
+	 */
+	inline size_t read(uint8_t *buffer, size_t length) {
+		int count = client_.read(buffer, length);
+
+		return count > 0 ? count : 0;
+	}
+
+	/**
+	 * Write as many bytes as the network client will accept.
+	 *
+	 * @param[in] buffer Buffer to write from.
+	 * @param[in] length Number of bytes to write.
+	 * @return Number of bytes written.
+	 * @since 0.3.0
+	 */
+	inline size_t write(const uint8_t *buffer, size_t length) { return client_.write(buffer, length); }
+
+private:
+	::Client &client_; /*!< Network client. @since 0.3.0 */
+};
+
+/**
+ * Modbus RTU framing (message frames with a CRC, delimited by silent
+ * intervals).
+ *
+ * The same buffer is used to transmit requests and receive responses.
+ *
+ * @since 0.3.0
+ */
+class RtuFraming {
+public:
+	static constexpr uint8_t MAX_TRANSACTIONS = 1; /*!< Maximum number of outstanding transactions (message frames have no transaction identifier). @since 0.3.0 */
+	static constexpr bool SILENT_INTERVAL = true; /*!< Message frames are delimited by the inter-frame timeout if the byte stream has one. @since 0.3.0 */
+	static constexpr uint8_t CHARACTERS_PER_BYTE = 1; /*!< Number of characters used to transmit each byte of a message. @since 0.3.0 */
+	static constexpr uint8_t FRAME_OVERHEAD = 3; /*!< Number of characters in a message frame in addition to the PDU (device address and CRC). @since 0.3.0 */
+
+	/**
+	 * Encode a request message frame to be transmitted.
+	 *
+	 * @param[in] request Request to encode.
+	 * @param[in] transaction Transaction identifier (unused).
+	 * @return True if the request was encoded, false if it is too long.
+	 * @since 0.3.0
+	 */
+	bool encode(Request &request, uint16_t transaction);
+
+	/**
+	 * Determine if there is a request message frame to transmit.
+	 *
+	 * @return True if there is data to transmit, otherwise false.
+	 * @since 0.3.0
+	 */
+	inline bool tx_pending() const { return tx_pos_ < tx_size_; }
+
+	/**
+	 * Get the remaining data of the request message frame to transmit.
+	 *
+	 * @param[out] len Number of bytes to transmit.
+	 * @return Data to transmit.
+	 * @since 0.3.0
+	 */
+	inline const uint8_t *tx_data(size_t &len) const {
+		len = tx_size_ - tx_pos_;
+		return &frame_[tx_pos_];
+	}
+
+	/**
+	 * Record that data of the request message frame has been transmitted.
+	 *
+	 * @param[in] len Number of bytes transmitted.
+	 * @since 0.3.0
+	 */
+	void tx_advance(size_t len);
+
+	/**
+	 * Get the amount of data received for the current message frame.
+	 *
+	 * @return Number of bytes received.
+	 * @since 0.3.0
+	 */
+	inline uint16_t rx_size() const { return rx_pos_; }
+
+	/**
+	 * Get the space to read received data into.
+	 *
+	 * @param[out] len Maximum number of bytes to read (0 if the buffer is
+	 *                 full and data must be discarded).
+	 * @return Buffer to read into.
+	 * @since 0.3.0
+	 */
+	inline uint8_t *rx_space(size_t &len) {
+		len = frame_.size() - rx_pos_;
+		return &frame_[rx_pos_];
+	}
+
+	/**
+	 * Record that data has been read into the receive buffer.
+	 *
+	 * @param[in] len Number of bytes read.
+	 * @return State of the current message frame (never COMPLETE because
+	 *         the end of the frame is not marked).
+	 * @since 0.3.0
+	 */
+	FrameState rx_advance(size_t len);
+
+	/**
+	 * Determine if the current message frame has been fully received based
+	 * on the expected length of the response, without waiting for the
+	 * inter-frame timeout.
+	 *
+	 * @param[in] request Request that the message frame is a response to.
+	 * @return True if the message frame is complete and has a valid CRC,
+	 *         otherwise false.
+	 * @since 0.3.0
+	 */
+	bool rx_complete(const Request &request) const;
+
+	/**
+	 * Check the current message frame and remove the CRC.
+	 *
+	 * @param[out] len Size of message frame.
+	 * @param[out] transaction Transaction identifier (always 0).
+	 * @return ResponseStatus::SUCCESS if the message frame is valid,
+	 *         otherwise the reason it is invalid.
+	 * @since 0.3.0
+	 */
+	ResponseStatus decode(uint16_t &len, uint16_t &transaction);
+
+	/**
+	 * Get the current message frame.
+	 *
+	 * @return Message frame buffer, starting with the device address.
+	 * @since 0.3.0
+	 */
+	inline frame_buffer_t &rx_frame() { return frame_; }
+
+	/**
+	 * Log the contents of the current message frame.
+	 *
+	 * @since 0.3.0
+	 */
+	void rx_log() const;
+
+	/**
+	 * Discard the current message frame.
+	 *
+	 * @since 0.3.0
+	 */
+	inline void rx_reset() { rx_pos_ = 0; }
+
+private:
+	frame_buffer_t frame_; /*!< Current message frame. @since 0.1.0 */
+	uint16_t tx_pos_ = 0; /*!< Position in request message frame. @since 0.3.0 */
+	uint16_t tx_size_ = 0; /*!< Size of request message frame to transmit. @since 0.1.0 */
+	uint16_t rx_pos_ = 0; /*!< Position in response message frame. @since 0.3.0 */
+	CRC16 crc_; /*!< Running CRC of the current message frame (excluding the last two bytes when receiving). @since 0.3.0 */
+};
+
+/**
+ * Modbus ASCII framing (message frames encoded as hexadecimal characters
+ * with an LRC, starting with ':' and ending with CR LF).
+ *
+ * Requests are encoded as they are transmitted and responses are decoded as
+ * they are received, so the same buffer is used to transmit requests and
+ * receive responses. The end of a response is identified by the delimiter,
+ * so there is no need to wait for a timeout.
+ *
+ * @since 0.3.0
+ */
+class AsciiFraming {
+public:
+	static constexpr uint8_t MAX_TRANSACTIONS = 1; /*!< Maximum number of outstanding transactions (message frames have no transaction identifier). @since 0.3.0 */
+	static constexpr bool SILENT_INTERVAL = false; /*!< Message frames are delimited by characters. @since 0.3.0 */
+	static constexpr uint8_t CHARACTERS_PER_BYTE = 2; /*!< Number of characters used to transmit each byte of a message. @since 0.3.0 */
+	static constexpr uint8_t FRAME_OVERHEAD = 7; /*!< Number of characters in a message frame in addition to the PDU (start, device address, LRC and end). @since 0.3.0 */
+
+	/**
+	 * Encode a request message frame to be transmitted.
+	 *
+	 * @param[in] request Request to encode.
+	 * @param[in] transaction Transaction identifier (unused).
+	 * @return True if the request was encoded, false if it is too long.
+	 * @since 0.3.0
+	 */
+	bool encode(Request &request, uint16_t transaction);
+
+	/**
+	 * Determine if there is a request message frame to transmit.
+	 *
+	 * @return True if there is data to transmit, otherwise false.
+	 * @since 0.3.0
+	 */
+	inline bool tx_pending() const { return tx_pos_ < tx_size_; }
+
+	/**
+	 * Get the next characters of the request message frame to transmit.
+	 *
+	 * @param[out] len Number of characters to transmit.
+	 * @return Characters to transmit.
+	 * @since 0.3.0
+	 */
+	const uint8_t *tx_data(size_t &len);
+
+	/**
+	 * Record that characters of the request message frame have been
+	 * transmitted.
+	 *
+	 * @param[in] len Number of characters transmitted.
+	 * @since 0.3.0
+	 */
+	void tx_advance(size_t len);
+
+	/**
+	 * Get the amount of data received for the current message frame.
+	 *
+	 * @return Number of characters received since the start of the frame
+	 *         (characters before the start of a frame are ignored).
+	 * @since 0.3.0
+	 */
+	inline uint16_t rx_size() const { return rx_pos_; }
+
+	/**
+	 * Get the space to read received characters into.
+	 *
+	 * @param[out] len Maximum number of characters to read.
+	 * @return Buffer to read into.
+	 * @since 0.3.0
+	 */
+	inline uint8_t *rx_space(size_t &len) {
+		len = rx_chars_.size();
+		return rx_chars_.data();
+	}
+
+	/**
+	 * Decode characters that have been read.
+	 *
+	 * Any characters that are received after the end of a message frame in
+	 * the same read are discarded because only one response can be
+	 * outstanding.
+	 *
+	 * @param[in] len Number of characters read.
+	 * @return State of the current message frame (COMPLETE when the end of
+	 *         the frame has been received).
+	 * @since 0.3.0
+	 */
+	FrameState rx_advance(size_t len);
+
+	/**
+	 * Determine if the current message frame has been fully received based
+	 * on the expected length of the response.
+	 *
+	 * @param[in] request Request that the message frame is a response to.
+	 * @return False (the end of the message frame is marked).
+	 * @since 0.3.0
+	 */
+	inline bool rx_complete(const Request &request __attribute__((unused))) const { return false; }
+
+	/**
+	 * Check the current message frame and remove the LRC.
+	 *
+	 * @param[out] len Size of message frame.
+	 * @param[out] transaction Transaction identifier (always 0).
+	 * @return ResponseStatus::SUCCESS if the message frame is valid,
+	 *         otherwise the reason it is invalid.
+	 * @since 0.3.0
+	 */
+	ResponseStatus decode(uint16_t &len, uint16_t &transaction);
+
+	/**
+	 * Get the current message frame.
+	 *
+	 * @return Message frame buffer, starting with the device address.
+	 * @since 0.3.0
+	 */
+	inline frame_buffer_t &rx_frame() { return frame_; }
+
+	/**
+	 * Log the contents of the current message frame.
+	 *
+	 * @since 0.3.0
+	 */
+	void rx_log() const;
+
+	/**
+	 * Discard the current message frame.
+	 *
+	 * @since 0.3.0
+	 */
+	inline void rx_reset() {
+		rx_pos_ = 0;
+		rx_len_ = 0;
+	}
+
+private:
+	static constexpr size_t CHUNK_SIZE = 32; /*!< Number of characters to encode or decode at a time. @since 0.3.0 */
+
+	/**
+	 * Get a character of the request message frame.
+	 *
+	 * @param[in] pos Position in the request message frame.
+	 * @return Character at that position.
+	 * @since 0.3.0
+	 */
+	uint8_t tx_char(uint16_t pos) const;
+
+	frame_buffer_t frame_; /*!< Current message frame (decoded). @since 0.3.0 */
+	std::array<uint8_t, CHUNK_SIZE> tx_chars_; /*!< Encoded characters being transmitted. @since 0.3.0 */
+	uint16_t tx_pos_ = 0; /*!< Position in request message frame (in characters). @since 0.3.0 */
+	uint16_t tx_size_ = 0; /*!< Size of request message frame to transmit (in characters). @since 0.3.0 */
+	std::array<uint8_t, CHUNK_SIZE> rx_chars_; /*!< Characters received that have not been decoded. @since 0.3.0 */
+	uint16_t rx_pos_ = 0; /*!< Number of characters received since the start of the frame (0 if no frame has started). @since 0.3.0 */
+	uint16_t rx_len_ = 0; /*!< Number of bytes decoded (including the LRC). @since 0.3.0 */
+	uint8_t rx_lrc_ = 0; /*!< Sum of all bytes decoded (0 if the LRC is valid). @since 0.3.0 */
+	uint8_t rx_value_ = 0; /*!< Value of the high nibble of the byte being decoded. @since 0.3.0 */
+	bool rx_nibble_ = false; /*!< The high nibble of a byte has been decoded. @since 0.3.0 */
+	bool rx_cr_ = false; /*!< Carriage return received. @since 0.3.0 */
+	bool rx_end_ = false; /*!< End of message frame received. @since 0.3.0 */
+	bool rx_error_ = false; /*!< Invalid characters received. @since 0.3.0 */
+};
+
+/**
+ * Modbus TCP framing (message frames with an MBAP header).
+ *
+ * Requests are transmitted from a separate buffer so that responses can be
+ * received while another request is being transmitted.
+ *
+ * @since 0.3.0
+ */
+class MbapFraming {
+public:
+	static constexpr uint8_t MAX_TRANSACTIONS = UUID_MODBUS_TCP_WINDOW_SIZE; /*!< Maximum number of outstanding transactions. @since 0.3.0 */
+	static constexpr bool SILENT_INTERVAL = false; /*!< Message frames are delimited by the length in the MBAP header. @since 0.3.0 */
+	static constexpr uint8_t CHARACTERS_PER_BYTE = 1; /*!< Number of characters used to transmit each byte of a message. @since 0.3.0 */
+	static constexpr uint8_t FRAME_OVERHEAD = MBAP_HEADER_SIZE; /*!< Number of characters in a message frame in addition to the PDU (MBAP header). @since 0.3.0 */
+
+	static_assert(MAX_TRANSACTIONS > 0, "TCP window size must be at least 1");
+
+	/**
+	 * Encode a request message with an MBAP header to be transmitted.
+	 *
+	 * @param[in] request Request to encode.
+	 * @param[in] transaction Transaction identifier.
+	 * @return True if the request was encoded, false if it is too long.
+	 * @since 0.3.0
+	 */
+	bool encode(Request &request, uint16_t transaction);
+
+	/**
+	 * Determine if there is a request message to transmit.
+	 *
+	 * @return True if there is data to transmit, otherwise false.
+	 * @since 0.3.0
+	 */
+	inline bool tx_pending() const { return tx_pos_ < tx_size_; }
+
+	/**
+	 * Get the remaining data of the MBAP header or request message to
+	 * transmit.
+	 *
+	 * @param[out] len Number of bytes to transmit.
+	 * @return Data to transmit.
+	 * @since 0.3.0
+	 */
+	inline const uint8_t *tx_data(size_t &len) const {
+		if (tx_pos_ < HEADER_SIZE) {
+			len = HEADER_SIZE - tx_pos_;
+			return &tx_header_[tx_pos_];
+		} else {
+			len = tx_size_ - tx_pos_;
+			return &tx_frame_[tx_pos_ - HEADER_SIZE];
+		}
+	}
+
+	/**
+	 * Record that data of the request message has been transmitted.
+	 *
+	 * @param[in] len Number of bytes transmitted.
+	 * @since 0.3.0
+	 */
+	void tx_advance(size_t len);
+
+	/**
+	 * Get the amount of data received for the current message.
+	 *
+	 * @return Number of bytes received (including the MBAP header).
+	 * @since 0.3.0
+	 */
+	inline uint16_t rx_size() const { return rx_pos_; }
+
+	/**
+	 * Get the space to read received data into, which is limited to the
+	 * remainder of the MBAP header or the current message.
+	 *
+	 * @param[out] len Maximum number of bytes to read.
+	 * @return Buffer to read into.
+	 * @since 0.3.0
+	 */
+	inline uint8_t *rx_space(size_t &len) {
+		if (rx_pos_ < HEADER_SIZE) {
+			len = HEADER_SIZE - rx_pos_;
+			return &rx_header_[rx_pos_];
+		} else {
+			len = rx_size_ - rx_pos_;
+			return &rx_frame_[rx_pos_ - HEADER_SIZE];
+		}
+	}
+
+	/**
+	 * Record that data has been read into the receive buffer.
+	 *
+	 * @param[in] len Number of bytes read.
+	 * @return State of the current message (INVALID if the MBAP header is
+	 *         invalid and the start of the next message can't be found).
+	 * @since 0.3.0
+	 */
+	FrameState rx_advance(size_t len);
+
+	/**
+	 * Determine if the current message has been fully received based on
+	 * the expected length of the response.
+	 *
+	 * @param[in] request Request that the message is a response to.
+	 * @return False (the end of the message is determined from the MBAP
+	 *         header).
+	 * @since 0.3.0
+	 */
+	inline bool rx_complete(const Request &request __attribute__((unused))) const { return false; }
+
+	/**
+	 * Get the length and transaction identifier of the current message.
+	 *
+	 * @param[out] len Size of message frame (excluding the MBAP header).
+	 * @param[out] transaction Transaction identifier.
+	 * @return ResponseStatus::SUCCESS (the MBAP header has already been
+	 *         checked).
+	 * @since 0.3.0
+	 */
+	ResponseStatus decode(uint16_t &len, uint16_t &transaction);
+
+	/**
+	 * Get the current message frame.
+	 *
+	 * @return Message frame buffer, starting with the unit identifier.
+	 * @since 0.3.0
+	 */
+	inline frame_buffer_t &rx_frame() { return rx_frame_; }
+
+	/**
+	 * Log the contents of the current message frame.
+	 *
+	 * @since 0.3.0
+	 */
+	void rx_log() const;
+
+	/**
+	 * Discard the current message.
+	 *
+	 * @since 0.3.0
+	 */
+	inline void rx_reset() {
+		rx_pos_ = 0;
+		rx_size_ = 0;
+	}
+
+private:
+	static constexpr uint16_t HEADER_SIZE = MBAP_HEADER_SIZE - 1; /*!< Size of MBAP header before the unit identifier (which is the first byte of the message frame). @since 0.3.0 */
+
+	std::array<uint8_t, HEADER_SIZE> tx_header_; /*!< MBAP header of the request message being transmitted. @since 0.3.0 */
+	frame_buffer_t tx_frame_; /*!< Request message frame being transmitted. @since 0.3.0 */
+	uint16_t tx_pos_ = 0; /*!< Position in request message. @since 0.3.0 */
+	uint16_t tx_size_ = 0; /*!< Size of request message (0 if there is no message to transmit). @since 0.3.0 */
+
+	std::array<uint8_t, HEADER_SIZE> rx_header_; /*!< MBAP header of the response message being received. @since 0.3.0 */
+	frame_buffer_t rx_frame_; /*!< Response message frame being received. @since 0.3.0 */
+	uint16_t rx_pos_ = 0; /*!< Position in response message. @since 0.3.0 */
+	uint16_t rx_size_ = 0; /*!< Size of response message (from the MBAP header). @since 0.3.0 */
+};
+
+/**
+ * Client that sends requests to devices using a framing layer (how message
+ * frames are encoded and delimited) over a byte stream layer (how data is
+ * transmitted and received).
+ *
+ * The layers are combined at compile time. This is instantiated for each
+ * of the combinations of framing and byte stream used by the clients in
+ * this library.
+ *
+ * @tparam Framing Framing layer (RtuFraming, AsciiFraming or MbapFraming).
+ * @tparam ByteStream Byte stream layer (SerialStream or NetworkStream).
+ * @since 0.3.0
+ */
+template<typename Framing, typename ByteStream>
+class FramedClient: public BaseClient {
+public:
+	/**
+	 * Loop function that must be called regularly to send and receive messages.
+	 *
+	 * Completion callbacks for requests are called from this function.
+	 *
+	 * If the byte stream is not connected then outstanding requests fail
+	 * with a status of ResponseStatus::FAILURE_DISCONNECTED. Queued requests
+	 * are sent when it is connected again.
+	 *
+	 * @since 0.3.0
+	 */
+	void loop();
+
+	/**
+	 * Get the time until loop() next needs to be called, so that the caller
+	 * can sleep or do other work in the meantime.
+	 *
+	 * This is the time until the end of the inter-frame gap, the response
+	 * timeout of an outstanding request, or the expiry of a queued request.
+	 * The loop() function must also be called when data is received or
+	 * after making a new request.
+	 *
+	 * @return Time until the next timing event in microseconds (0 =
+	 *         loop() should be called again immediately, WAIT_FOR_INPUT =
+	 *         no timing event is pending).
+	 * @since 0.3.0
+	 */
+	uint32_t next_event_us() const;
+
+	/**
+	 * Get the time to transmit each byte of the PDU of a message.
+	 *
+	 * @return Byte time in microseconds (0 = not known).
+	 * @since 0.3.0
+	 */
+	inline uint32_t byte_time_us() const {
+		return stream_.character_time_us() * Framing::CHARACTERS_PER_BYTE;
+	}
+
+	/**
+	 * Get the time that the framing and the inter-frame gap add to every
+	 * message.
+	 *
+	 * @return Frame overhead in microseconds (0 = not known).
+	 * @since 0.3.0
+	 */
+	inline uint32_t frame_overhead_us() const {
+		return stream_.character_time_us() * Framing::FRAME_OVERHEAD + frame_timeout_us();
+	}
+
+protected:
+	/**
+	 * Create a new client.
+	 *
+	 * @param[in] stream Byte stream to send and receive messages on.
+	 * @since 0.3.0
+	 */
+	FramedClient(const ByteStream &stream) : stream_(stream) {}
+
+	~FramedClient() = default;
+
+	ByteStream stream_; /*!< Byte stream layer. @since 0.3.0 */
+	uint8_t window_ = 1; /*!< Maximum number of outstanding transactions. @since 0.3.0 */
+
+private:
+	/**
+	 * Transaction that has been sent (or is being sent).
+	 *
+	 * @since 0.3.0
+	 */
+	struct Transaction {
+		const Response *response = nullptr; /*!< Response to the request (nullptr if unused). @since 0.3.0 */
+		uint32_t sent_us = 0; /*!< Time that transmission of the request started, then the time that the last character of it will have been transmitted. @since 0.3.0 */
+		uint16_t id = 0; /*!< Transaction identifier. @since 0.3.0 */
+	};
+
+	/**
+	 * Get the inter-frame timeout used to delimit message frames.
+	 *
+	 * @return Inter-frame timeout in microseconds (0 = message frames are
+	 *         not delimited by time).
+	 * @since 0.3.0
+	 */
+	inline uint32_t frame_timeout_us() const {
+		return Framing::SILENT_INTERVAL ? stream_.inter_frame_timeout_us() : 0;
+	}
+
+	/**
+	 * Fail all outstanding transactions because the byte stream is not
+	 * connected.
+	 *
+	 * @since 0.3.0
+	 */
+	void disconnected();
+
+	/**
+	 * Encode the next queued request if the window is not full.
+	 *
+	 * @return True if there may be more requests to encode, otherwise false.
+	 * @since 0.3.0
+	 */
+	bool encode();
+
+	/**
+	 * Transmit the current request message on the byte stream.
+	 *
+	 * @since 0.3.0
+	 */
+	void transmit();
+
+	/**
+	 * Read message frames from the byte stream.
+	 *
+	 * All of the data that is available is read directly into the framing
+	 * layer's buffer using bulk reads and then timestamped once. Message
+	 * frames that are delimited by the framing layer are processed as soon
+	 * as they have been received.
+	 *
+	 * @return Current time from micros().
+	 * @since 0.1.0
+	 */
+	uint32_t input();
+
+	/**
+	 * Identify the end of a message frame that is delimited by time or the
+	 * expected length of the response, and finish outstanding transactions
+	 * that have timed out.
+	 *
+	 * @param[in] now_us Current time from micros().
+	 * @since 0.1.0
+	 */
+	void receive(uint32_t now_us);
+
+	/**
+	 * Match a received message frame to its transaction and populate the
+	 * response.
+	 *
+	 * @since 0.1.0
+	 */
+	void complete();
+
+	/**
+	 * Discard a message frame that was received while no transaction was
+	 * waiting for it.
+	 *
+	 * @since 0.3.0
+	 */
+	void unexpected();
+
+	/**
+	 * Find the transaction waiting for a response.
+	 *
+	 * @param[in] id Transaction identifier (ignored if the framing has no
+	 *               transaction identifiers).
+	 * @return Waiting transaction (or nullptr if there is none).
+	 * @since 0.3.0
+	 */
+	Transaction *waiting(uint16_t id = 0);
+
+	/**
+	 * Find the position of a transaction's request in the queue.
+	 *
+	 * @param[in] transaction Outstanding transaction.
+	 * @return Position of the request in the queue.
+	 * @since 0.3.0
+	 */
+	size_t find_request(const Transaction &transaction) const;
+
+	/**
+	 * Remove a transaction and finish its request.
+	 *
+	 * @param[in] transaction Outstanding transaction.
+	 * @since 0.3.0
+	 */
+	void close(Transaction &transaction);
+
+	Framing framing_; /*!< Framing layer. @since 0.3.0 */
+	std::array<Transaction, Framing::MAX_TRANSACTIONS> transactions_; /*!< Outstanding transactions. @since 0.3.0 */
+	Transaction *tx_transaction_ = nullptr; /*!< Transaction of the request message being transmitted. @since 0.3.0 */
+	uint16_t tx_length_ = 0; /*!< Number of characters of the request message written so far. @since 0.3.0 */
+	uint16_t next_id_ = 0; /*!< Next transaction identifier. @since 0.3.0 */
+	bool frame_gap_ = false; /*!< Waiting for the inter-frame timeout after a message frame was completed early. @since 0.3.0 */
+	uint32_t last_rx_us_ = 0; /*!< Time that data was last received. @since 0.3.0 */
+	uint32_t first_rx_us_ = 0; /*!< Time that the first data of the current message frame was received. @since 0.3.0 */
+};
+
+extern template class FramedClient<RtuFraming, SerialStream>;
+extern template class FramedClient<AsciiFraming, SerialStream>;
+extern template class FramedClient<RtuFraming, NetworkStream>;
+extern template class FramedClient<MbapFraming, NetworkStream>;
+
+/**
+ * Serial client used to process requests.
+ *
+ * Requests are sent using Modbus RTU framing on a serial port device.
+ *
+ * @since 0.1.0
+ */
+class SerialClient: public FramedClient<RtuFraming, SerialStream> {
+public:
+	/**
+	 * Create a new client.
+	 *
+	 * The inter-frame timeout will be INTER_FRAME_TIMEOUT_MS until the line
+	 * configuration is set.
+	 *
+	 * @param[in] serial Serial port device.
+	 * @since 0.1.0
+	 */
+	SerialClient(::HardwareSerial &serial);
+
+	/**
+	 * Create a new client with a known line configuration.
+	 *
+	 * @param[in] serial Serial port device.
+	 * @param[in] baud_rate Baud rate of the serial port device.
+	 * @param[in] parity Parity of the serial port device.
+	 * @param[in] stop_bits Number of stop bits of the serial port device.
+	 * @since 0.3.0
+	 */
+	SerialClient(::HardwareSerial &serial, uint32_t baud_rate,
+		SerialParity parity = SerialParity::EVEN, uint8_t stop_bits = 1);
+
+	~SerialClient() = default;
+
+	/**
+	 * Set the line configuration of the serial port device, which is used to
+	 * determine the inter-character and inter-frame timeouts.
+	 *
+	 * Baud rates above FIXED_TIMEOUT_BAUD_RATE use fixed timeouts of
+	 * MIN_INTER_CHARACTER_TIMEOUT_US and MIN_INTER_FRAME_TIMEOUT_US.
+	 *
+	 * @param[in] baud_rate Baud rate of the serial port device.
+	 * @param[in] parity Parity of the serial port device.
+	 * @param[in] stop_bits Number of stop bits of the serial port device.
+	 * @since 0.3.0
+	 */
+	void line_config(uint32_t baud_rate,
+		SerialParity parity = SerialParity::EVEN, uint8_t stop_bits = 1);
+
+	/**
+	 * Get the inter-character timeout (1.5 character times).
+	 *
+	 * This is not enforced because the timing of individual characters can't
+	 * be observed reliably through the receive buffer of the serial port
+	 * device.
+	 *
+	 * @return Inter-character timeout in microseconds.
+	 * @since 0.3.0
+	 */
+	inline uint32_t inter_character_timeout_us() const { return stream_.inter_character_timeout_us(); }
+
+	/**
+	 * Get the inter-frame timeout (3.5 character times).
+	 *
+	 * @return Inter-frame timeout in microseconds.
+	 * @since 0.3.0
+	 */
+	inline uint32_t inter_frame_timeout_us() const { return stream_.inter_frame_timeout_us(); }
+
+	/**
+	 * Get the time to transmit one character.
+	 *
+	 * @return Character time in microseconds.
+	 * @since 0.3.0
+	 */
+	inline uint32_t character_time_us() const { return stream_.character_time_us(); }
+};
+
+/**
+ * Serial client used to process requests with devices that only support
+ * Modbus ASCII.
+ *
+ * Requests are sent using Modbus ASCII framing on a serial port device.
+ *
+ * @since 0.3.0
+ */
+class AsciiClient: public FramedClient<AsciiFraming, SerialStream> {
+public:
+	/**
+	 * Create a new client.
+	 *
+	 * @param[in] serial Serial port device.
+	 * @since 0.3.0
+	 */
+	AsciiClient(::HardwareSerial &serial);
+
+	/**
+	 * Create a new client with a known line configuration.
+	 *
+	 * @param[in] serial Serial port device.
+	 * @param[in] baud_rate Baud rate of the serial port device.
+	 * @param[in] parity Parity of the serial port device.
+	 * @param[in] stop_bits Number of stop bits of the serial port device.
+	 * @since 0.3.0
+	 */
+	AsciiClient(::HardwareSerial &serial, uint32_t baud_rate,
+		SerialParity parity = SerialParity::EVEN, uint8_t stop_bits = 1);
+
+	~AsciiClient() = default;
+
+	/**
+	 * Set the line configuration of the serial port device, which is used to
+	 * determine how long it takes to transmit requests.
+	 *
+	 * @param[in] baud_rate Baud rate of the serial port device.
+	 * @param[in] parity Parity of the serial port device.
+	 * @param[in] stop_bits Number of stop bits of the serial port device.
+	 * @since 0.3.0
+	 */
+	void line_config(uint32_t baud_rate,
+		SerialParity parity = SerialParity::EVEN, uint8_t stop_bits = 1);
+};
+
+/**
+ * Client used to process requests with serial devices behind a serial device
+ * server that forwards raw Modbus RTU frames over a network connection.
+ *
+ * Requests are sent using Modbus RTU framing (with a CRC) over a connection
+ * that is managed by the caller. The network connection doesn't preserve the
+ * timing between characters, so the end of each response is identified from
+ * its expected length instead of the inter-frame timeout. A response that
+ * doesn't have the expected length fails when the timeout expires.
+ *
+ * @since 0.3.0
+ */
+class RtuTcpClient: public FramedClient<RtuFraming, NetworkStream> {
+public:
+	/**
+	 * Create a new client.
+	 *
+	 * @param[in] client Network client, which must be connected to the
+	 *                   serial device server before requests can be sent.
+	 * @since 0.3.0
+	 */
+	RtuTcpClient(::Client &client);
+
+	~RtuTcpClient() = default;
+};
+
+/**
+ * Modbus TCP client used to process requests.
  *
- * This will be created when a request is submitted and then later updated with
- * the outcome. Poll the status() of the response to know when to access data.
+ * Requests are sent with an MBAP header over a connection that is managed by
+ * the caller. Several requests can be outstanding at the same time (up to the
+ * window size) and responses are matched to them by transaction identifier.
  *
- * @since 0.1.0
+ * @since 0.3.0
  */
-class RegisterWriteResponse: public RegisterDataResponse {
+class TcpClient: public FramedClient<MbapFraming, NetworkStream> {
 public:
+	static constexpr uint8_t MAX_WINDOW = MbapFraming::MAX_TRANSACTIONS; /*!< Maximum number of outstanding transactions. @since 0.3.0 */
+
 	/**
-	 * Parse a message frame buffer and store the outcome in this response.
+	 * Create a new client.
 	 *
-	 * @param[in] frame Message frame buffer.
-	 * @param[in] len Size of message frame.
-	 * @return The status result of message parsing.
-	 * @since 0.1.0
+	 * @param[in] client Network client, which must be connected to the
+	 *                   server before requests can be sent.
+	 * @since 0.3.0
 	 */
-	ResponseStatus parse(frame_buffer_t &frame, uint16_t len) override;
+	TcpClient(::Client &client);
+
+	~TcpClient() = default;
 
 	/**
-	 * Get the address from the device response, which should match the address
-	 * that was requested.
-	 *
-	 * Valid only if the status() is ResponseStatus::SUCCESS.
+	 * Get the maximum number of transactions that can be outstanding at
+	 * the same time.
 	 *
-	 * @return Address from the response.
-	 * @since 0.1.0
+	 * @return Number of outstanding transactions.
+	 * @since 0.3.0
 	 */
-	uint16_t address() const { return address_; }
+	inline uint8_t window() const { return window_; }
 
-private:
-	uint16_t address_; /*!< Address from device response. @since 0.1.0 */
+	/**
+	 * Set the maximum number of transactions that can be outstanding at
+	 * the same time.
+	 *
+	 * Many servers only process one transaction at a time, so the default
+	 * is 1.
+	 *
+	 * @param[in] window Number of outstanding transactions (1 to
+	 *                   MAX_WINDOW).
+	 * @since 0.3.0
+	 */
+	void window(uint8_t window);
 };
 
 /**
- * Exception status response message.
- *
- * This will be created when a request is submitted and then later updated with
- * the outcome. Poll the status() of the response to know when to access data.
+ * Register to be read as part of a RegisterReadPlan.
  *
- * @since 0.1.0
+ * @since 0.3.0
  */
-class ExceptionStatusResponse: public Response {
-public:
-	/**
-	 * Parse a message frame buffer and store the outcome in this response.
-	 *
-	 * @param[in] frame Message frame buffer.
-	 * @param[in] len Size of message frame.
-	 * @return The status result of message parsing.
-	 * @since 0.1.0
-	 */
-	ResponseStatus parse(frame_buffer_t &frame, uint16_t len) override;
+struct RegisterPoint {
+	uint8_t device; /*!< Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST). @since 0.3.0 */
+	uint8_t function_code; /*!< Read function code (FunctionCode::READ_HOLDING_REGISTERS or FunctionCode::READ_INPUT_REGISTERS). @since 0.3.0 */
+	uint16_t address; /*!< Register address. @since 0.3.0 */
+	uint16_t value; /*!< Register value (valid only if the status is ResponseStatus::SUCCESS). @since 0.3.0 */
+	ResponseStatus status; /*!< Status of the read request for this register. @since 0.3.0 */
 
 	/**
-	 * Get the output data from the device response.
-	 *
-	 * Valid only if the status() is ResponseStatus::SUCCESS.
+	 * Create a register to be read.
 	 *
-	 * @return Output data from the response.
-	 * @since 0.1.0
+	 * @param[in] device Device address.
+	 * @param[in] function_code Read function code.
+	 * @param[in] address Register address.
+	 * @since 0.3.0
 	 */
-	inline uint8_t data() const { return data_; };
+	RegisterPoint(uint8_t device = 0, uint8_t function_code = 0, uint16_t address = 0)
+		: device(device), function_code(function_code), address(address),
+		value(0), status(ResponseStatus::QUEUED) {}
 
 private:
-	uint8_t data_; /*!< Output data from device response. @since 0.1.0 */
+	friend class RegisterReadPlan;
+
+	uint32_t cost_us_ = 0; /*!< Minimum time to read this and all previous registers in the plan. @since 0.3.0 */
+	bool block_start_ = false; /*!< First register of a request. @since 0.3.0 */
 };
 
 /**
- * Request message.
+ * Plan for reading scattered registers using the minimum bus time.
  *
- * This will be created when a request is submitted and then discarded when the
- * response is updated with the outcome.
+ * The registers are sorted and then covered with blocks of up to
+ * MAX_READ_REGISTERS, reading unused registers between them when that is
+ * quicker than another request. The read requests are then submitted and the
+ * values are copied back to each register as the responses are received.
  *
- * @since 0.1.0
+ * The registers are stored in the caller's storage, which (along with the
+ * plan) must remain valid until the plan is done.
+ *
+ * @since 0.3.0
  */
-class Request {
+class RegisterReadPlan {
 public:
-	virtual ~Request() = default;
+	static constexpr uint8_t PIPELINE_DEPTH = 2; /*!< Maximum number of requests to have queued at the same time. @since 0.3.0 */
+	static constexpr uint8_t REQUEST_SIZE = 5; /*!< Size of the PDU of a read request. @since 0.3.0 */
+	static constexpr uint8_t RESPONSE_OVERHEAD = 2; /*!< Size of the PDU of a read response with no register values. @since 0.3.0 */
 
-public:
 	/**
-	 * Create a new request message (not directly useful).
+	 * Create a read plan.
 	 *
-	 * @param[in] device Destination device address.
-	 * @param[in] function_code Function code of the request.
-	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds.
-	 * @param[in] response Response object.
-	 * @since 0.1.0
+	 * @param[in] points Registers to read (the order will be changed).
+	 * @param[in] size Number of registers.
+	 * @since 0.3.0
 	 */
-	Request(uint16_t device, uint8_t function_code, uint16_t timeout_ms,
-		const std::shared_ptr<Response> &response);
+	RegisterReadPlan(RegisterPoint *points, size_t size);
+
+	RegisterReadPlan(const RegisterReadPlan&) = delete;
+	RegisterReadPlan& operator=(const RegisterReadPlan&) = delete;
 
 	/**
-	 * Encode this request and store it in a message frame buffer.
+	 * Calculate the read requests with the minimum total bus time.
 	 *
-	 * @param[out] frame Message frame buffer.
-	 * @return Size of message frame.
-	 * @since 0.1.0
+	 * The time for each request is calculated from the message sizes, the
+	 * time to transmit each byte, the overhead of each message frame and the
+	 * turnaround time of the device. Registers with an invalid device or
+	 * function code are not read and have a status of
+	 * ResponseStatus::FAILURE_INVALID.
+	 *
+	 * When the byte time is not known (network clients), the turnaround time
+	 * should be the round-trip time so that fewer requests are preferred.
+	 * Longer requests are used when they take the same total time.
+	 *
+	 * @param[in] byte_time_us Time to transmit each byte of the PDU of a
+	 *                         message in microseconds.
+	 * @param[in] frame_overhead_us Time that the framing and the inter-frame
+	 *                              gap add to every message in microseconds.
+	 * @param[in] turnaround_us Time between the end of a request and the start
+	 *                          of the response in microseconds.
+	 * @return Number of read requests.
+	 * @since 0.3.0
 	 */
-	virtual uint16_t encode(frame_buffer_t &frame);
+	size_t plan(uint32_t byte_time_us, uint32_t frame_overhead_us, uint32_t turnaround_us = 0);
 
 	/**
-	 * Get the destination device address.
+	 * Calculate the read requests with the minimum total bus time using the
+	 * timing of a client.
 	 *
-	 * @return Remote device address.
-	 * @since 0.1.0
+	 * @param[in] client Client to read the registers with.
+	 * @param[in] turnaround_us Time between the end of a request and the start
+	 *                          of the response in microseconds.
+	 * @return Number of read requests.
+	 * @since 0.3.0
 	 */
-	inline uint16_t device() const { return device_; };
+	template<typename Framing, typename ByteStream>
+	inline size_t plan(const FramedClient<Framing, ByteStream> &client, uint32_t turnaround_us = 0) {
+		return plan(client.byte_time_us(), client.frame_overhead_us(), turnaround_us);
+	}
 
 	/**
-	 * Get the function code of the request.
+	 * Submit the read requests.
 	 *
-	 * @return Request message function code.
-	 * @since 0.1.0
+	 * The plan must have been calculated first. Requests are queued as each
+	 * one completes, without waiting for the application, with the same
+	 * priority.
+	 *
+	 * @param[in] client Client to read the registers with.
+	 * @param[in] timeout_ms Timeout to wait for each response in milliseconds (0 = default).
+	 * @param[in] priority Priority of each request.
+	 * @since 0.3.0
 	 */
-	inline uint8_t function_code() const { return function_code_; };
+	void submit(BaseClient &client, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
 
 	/**
-	 * Get the timeout to wait for a response in milliseconds.
+	 * Get the number of read requests.
 	 *
-	 * @return Request timeout.
-	 * @since 0.1.0
+	 * @return Number of read requests in the plan.
+	 * @since 0.3.0
 	 */
-	inline uint16_t timeout_ms() const { return timeout_ms_; };
+	inline size_t blocks() const { return blocks_; }
 
 	/**
-	 * Get the response object.
+	 * Get the total bus time of the read requests.
 	 *
-	 * @return Corresponding response object.
-	 * @since 0.1.0
+	 * @return Estimated bus time in microseconds.
+	 * @since 0.3.0
 	 */
-	inline Response& response() const { return *response_.get(); };
+	inline uint32_t cost_us() const { return valid_ ? points_[valid_ - 1].cost_us_ : 0; }
+
+	/**
+	 * Determine if all of the read requests are complete.
+	 *
+	 * @return True if the plan is finished, otherwise false.
+	 * @since 0.3.0
+	 */
+	inline bool done() const { return completed_ == blocks_; }
+
+	/**
+	 * Get the number of read requests that completed.
+	 *
+	 * @return Number of completed read requests.
+	 * @since 0.3.0
+	 */
+	inline size_t completed() const { return completed_; }
 
 private:
-	const uint16_t device_; /*!< Remote device address. @since 0.1.0 */
-	const uint8_t function_code_; /*!< Request message function code. @since 0.1.0 */
-	const uint16_t timeout_ms_; /*!< Request timeout. @since 0.1.0 */
-	const std::shared_ptr<Response> response_; /*!< Corresponding response object. @since 0.1.0 */
-};
+	/**
+	 * Determine if two registers can be read in the same request.
+	 *
+	 * @param[in] a First register.
+	 * @param[in] b Second register.
+	 * @return True if the device and function code are the same, otherwise
+	 *         false.
+	 * @since 0.3.0
+	 */
+	static inline bool same_group(const RegisterPoint &a, const RegisterPoint &b) {
+		return a.device == b.device && a.function_code == b.function_code;
+	}
 
-/**
- * Request message for register functions.
- *
- * This will be created when a request is submitted and then discarded when the
- * response is updated with the outcome.
- *
- * @since 0.1.0
- */
-class RegisterRequest: public Request {
-public:
 	/**
-	 * Create a new register request message (not directly useful).
+	 * Determine if a register can be the first register of a request.
 	 *
-	 * @param[in] device Destination device address.
-	 * @param[in] function_code Function code of the request.
-	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds.
-	 * @param[in] address Register address.
-	 * @param[in] data Number of registers to read or register value to write.
-	 * @param[in] response Response object.
-	 * @since 0.1.0
+	 * @param[in] index Position of the register.
+	 * @return True if the register is the first of its group or has a
+	 *         different address to the previous register, otherwise false.
+	 * @since 0.3.0
 	 */
-	RegisterRequest(uint16_t device, uint8_t function_code, uint16_t timeout_ms,
-		uint16_t address, uint16_t data,
-		const std::shared_ptr<Response> &response);
+	bool can_start(size_t index) const;
 
 	/**
-	 * Encode this request and store it in a message frame buffer.
+	 * Get the index of the end of a request.
 	 *
-	 * @param[out] frame Message frame data.
-	 * @return Size of message frame.
-	 * @since 0.1.0
+	 * @param[in] start Position of the first register of the request.
+	 * @return Position after the last register of the request.
+	 * @since 0.3.0
 	 */
-	uint16_t encode(frame_buffer_t &frame) override;
+	size_t block_end(size_t start) const;
 
 	/**
-	 * Get the register address.
+	 * Queue the next read requests.
 	 *
-	 * @return Register address.
-	 * @since 0.1.0
+	 * @since 0.3.0
 	 */
-	inline uint16_t address() const { return address_; };
+	void queue();
 
 	/**
-	 * Get the register size or value.
+	 * Store the outcome of a read request.
 	 *
-	 * @return Register size or value.
-	 * @since 0.1.0
+	 * @param[in] start Position of the first register of the request.
+	 * @param[in] response Response to the request.
+	 * @since 0.3.0
 	 */
-	inline uint16_t data() const { return data_; };
+	void block_complete(size_t start, const RegisterDataResponse &response);
+
+	RegisterPoint *points_; /*!< Registers to read (owned by the caller). @since 0.3.0 */
+	size_t size_; /*!< Number of registers. @since 0.3.0 */
+	size_t valid_ = 0; /*!< Number of valid registers (sorted before invalid registers). @since 0.3.0 */
+	size_t blocks_ = 0; /*!< Number of read requests. @since 0.3.0 */
+	size_t completed_ = 0; /*!< Number of completed read requests. @since 0.3.0 */
+	size_t next_ = 0; /*!< Position of the first register of the next read request. @since 0.3.0 */
+	BaseClient *client_ = nullptr; /*!< Client to queue requests on. @since 0.3.0 */
+	uint16_t timeout_ms_ = 0; /*!< Timeout for each request. @since 0.3.0 */
+	RequestPriority priority_ = RequestPriority::INTERACTIVE; /*!< Priority of each request. @since 0.3.0 */
+	uint8_t queued_ = 0; /*!< Number of requests currently queued. @since 0.3.0 */
+	bool queuing_ = false; /*!< Requests are being queued. @since 0.3.0 */
+};
+
+/**
+ * Entry in a RegisterCache.
+ *
+ * @since 0.3.0
+ */
+class RegisterCacheEntry {
+public:
+	RegisterCacheEntry() = default;
 
 private:
-	const uint16_t address_; /*!< Register address. @since 0.1.0 */
-	const uint16_t data_; /*!< Register size or value. @since 0.1.0 */
+	friend class RegisterCache;
+
+	uint32_t expires_ms_ = 0; /*!< Time that the value expires. @since 0.3.0 */
+	uint16_t address_ = 0; /*!< Register address. @since 0.3.0 */
+	uint16_t value_ = 0; /*!< Register value. @since 0.3.0 */
+	uint8_t device_ = DeviceAddressType::BROADCAST; /*!< Device address (DeviceAddressType::BROADCAST if the entry is unused). @since 0.3.0 */
+	uint8_t function_code_ = 0; /*!< Read function code. @since 0.3.0 */
 };
 
 /**
- * Serial client used to process requests.
+ * Cache of register values in front of the read functions of a client.
  *
- * @since 0.1.0
+ * Register values are stored in an open-addressed table (using the caller's
+ * storage) keyed by device, function code and address. A read where every
+ * register has a value that has not expired completes immediately without a
+ * request. Otherwise the read is passed to the client and the values in the
+ * response are stored in the cache with the time to live of that read.
+ *
+ * The cache must not be destroyed while reads are in progress.
+ *
+ * @since 0.3.0
  */
-class SerialClient {
+class RegisterCache {
 public:
+	static constexpr uint8_t MAX_PROBES = 8; /*!< Maximum number of entries to search for a register. @since 0.3.0 */
+	static constexpr uint32_t MAX_TTL_MS = INT32_MAX; /*!< Maximum time to live in milliseconds. @since 0.3.0 */
+
 	/**
-	 * Create a new client.
+	 * Create a register cache.
 	 *
-	 * @param[in] serial Serial port device.
-	 * @since 0.1.0
+	 * @param[in] client Client to read registers with.
+	 * @param[in] entries Storage for cache entries.
+	 * @param[in] size Number of cache entries.
+	 * @since 0.3.0
 	 */
-	SerialClient(::HardwareSerial &serial);
+	RegisterCache(BaseClient &client, RegisterCacheEntry *entries, size_t size);
 
-	~SerialClient() = default;
+	RegisterCache(const RegisterCache&) = delete;
+	RegisterCache& operator=(const RegisterCache&) = delete;
 
 	/**
-	 * Loop function that must be called regularly to send and receive messages.
+	 * Read holding registers (function code 0x03), using cached values if they
+	 * have not expired.
 	 *
-	 * @since 0.1.0
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address.
+	 * @param[in] size Quantity of registers (1 to MAX_READ_REGISTERS).
+	 * @param[in] ttl_ms Time to cache the register values for in milliseconds (0 to MAX_TTL_MS).
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response object to monitor for completion.
+	 * @since 0.3.0
 	 */
-	void loop();
+	ResponseHandle<const RegisterDataResponse> read_holding_registers(uint16_t device,
+		uint16_t address, uint16_t size, uint32_t ttl_ms, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
 
 	/**
-	 * Get the default timeout for new unicast requests.
-	 *
-	 * @return Timeout to wait for a response in milliseconds.
-	 * @since 0.2.0
-	 */
-	inline uint16_t default_unicast_timeout_ms() const { return default_unicast_timeout_ms_; }
-	/**
-	 * Set the default timeout for new unicast requests.
+	 * Read holding registers (function code 0x03), using cached values if they
+	 * have not expired.
 	 *
-	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds.
-	 * @since 0.2.0
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address.
+	 * @param[in] size Quantity of registers (1 to MAX_READ_REGISTERS).
+	 * @param[in] ttl_ms Time to cache the register values for in milliseconds (0 to MAX_TTL_MS).
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response object to monitor for completion.
+	 * @since 0.3.0
 	 */
-	inline void default_unicast_timeout_ms(uint16_t timeout_ms) { default_unicast_timeout_ms_ = timeout_ms; }
+	ResponseHandle<const RegisterDataResponse> read_holding_registers(uint16_t device,
+		uint16_t address, uint16_t size, uint32_t ttl_ms,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
 
 	/**
-	 * Get the default timeout for new broadcast requests.
-	 *
-	 * @return Delay after a request in milliseconds.
-	 * @since 0.2.0
-	 */
-	inline uint16_t default_broadcast_delay_ms() const { return default_broadcast_timeout_ms_; }
-	/**
-	 * Set the default timeout for new broadcast requests.
+	 * Read input registers (function code 0x04), using cached values if they
+	 * have not expired.
 	 *
-	 * @param[in] timeout_ms Delay after a request in milliseconds.
-	 * @since 0.2.0
+	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
+	 * @param[in] address Starting address.
+	 * @param[in] size Quantity of registers (1 to MAX_READ_REGISTERS).
+	 * @param[in] ttl_ms Time to cache the register values for in milliseconds (0 to MAX_TTL_MS).
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response object to monitor for completion.
+	 * @since 0.3.0
 	 */
-	inline void default_broadcast_delay_ms(uint16_t timeout_ms) { default_broadcast_timeout_ms_ = timeout_ms; }
+	ResponseHandle<const RegisterDataResponse> read_input_registers(uint16_t device,
+		uint16_t address, uint16_t size, uint32_t ttl_ms, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
 
 	/**
-	 * Read a contiguous block of holding registers from a remote device.
-	 *
-	 * The response message contains the register values returned.
+	 * Read input registers (function code 0x04), using cached values if they
+	 * have not expired.
 	 *
 	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
-	 * @param[in] address Starting address (0x0000 to 0xFFFF).
-	 * @param[in] size Quantity of registers (0x0001 to 0x007D).
+	 * @param[in] address Starting address.
+	 * @param[in] size Quantity of registers (1 to MAX_READ_REGISTERS).
+	 * @param[in] ttl_ms Time to cache the register values for in milliseconds (0 to MAX_TTL_MS).
+	 * @param[in] callback Function to call when the response is complete.
 	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
-	 * @return A response message that will contain the outcome and data in the
-	 *         future when processing is complete.
-	 * @since 0.1.0
+	 * @param[in] priority Priority of the request.
+	 * @return A response object to monitor for completion.
+	 * @since 0.3.0
 	 */
-	std::shared_ptr<const RegisterDataResponse> read_holding_registers(uint16_t device,
-		uint16_t address, uint16_t size, uint16_t timeout_ms = 0);
+	ResponseHandle<const RegisterDataResponse> read_input_registers(uint16_t device,
+		uint16_t address, uint16_t size, uint32_t ttl_ms,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms = 0,
+		RequestPriority priority = RequestPriority::INTERACTIVE);
 
 	/**
-	 * Read a contiguous block of input registers from a remote device.
-	 *
-	 * The response message contains the register values returned.
+	 * Remove cached register values.
 	 *
-	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
-	 * @param[in] address Starting address (0x0000 to 0xFFFF).
-	 * @param[in] size Quantity of registers (0x0001 to 0x007D).
-	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
-	 * @return A response message that will contain the outcome and data in the
-	 *         future when processing is complete.
-	 * @since 0.1.0
+	 * @param[in] device Device address.
+	 * @param[in] function_code Read function code.
+	 * @param[in] address Starting address.
+	 * @param[in] size Quantity of registers.
+	 * @since 0.3.0
 	 */
-	std::shared_ptr<const RegisterDataResponse> read_input_registers(uint16_t device,
-		uint16_t address, uint16_t size, uint16_t timeout_ms = 0);
+	void invalidate(uint16_t device, uint8_t function_code, uint16_t address, uint16_t size);
 
 	/**
-	 * Write to a single holding register in a remote device.
+	 * Remove all cached register values.
 	 *
-	 * The response message contains the register address followed by the
-	 * register value returned.
-	 *
-	 * For a broadcast request, use timeout_ms to set the turnaround delay.
+	 * @since 0.3.0
+	 */
+	void clear();
+
+	/**
+	 * Get the number of reads that were completed from the cache.
 	 *
-	 * @param[in] device Device address (DeviceAddressTypes::BROADCAST to DeviceAddressTypes::MAX_UNICAST).
-	 * @param[in] address Register address (0x0000 to 0xFFFF).
-	 * @param[in] value Register value.
-	 * @param[in] timeout_ms Timeout to wait for a response (or turnaround delay) in milliseconds (0 = default).
-	 * @return A response message that will contain the outcome and echoed data
-	 *         in the future when processing is complete.
-	 * @since 0.1.0
+	 * @return Number of cache hits.
+	 * @since 0.3.0
 	 */
-	std::shared_ptr<const RegisterWriteResponse> write_holding_register(uint16_t device,
-		uint16_t address, uint16_t value, uint16_t timeout_ms = 0);
+	inline uint32_t hits() const { return hits_; }
 
 	/**
-	 * Read exception status from a remote device.
+	 * Get the number of reads that were passed to the client.
 	 *
-	 * @param[in] device Device address (DeviceAddressTypes::MIN_UNICAST to DeviceAddressTypes::MAX_UNICAST).
-	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
-	 * @return A response message that will contain the outcome and output data
-	 *         in the future when processing is complete.
-	 * @since 0.1.0
+	 * @return Number of cache misses.
+	 * @since 0.3.0
 	 */
-	std::shared_ptr<const ExceptionStatusResponse> read_exception_status(uint16_t device,
-		uint16_t timeout_ms = 0);
+	inline uint32_t misses() const { return misses_; }
 
 private:
 	/**
-	 * Receive messages while idle.
+	 * Read that is in progress on the client.
 	 *
-	 * @since 0.1.0
+	 * @since 0.3.0
 	 */
-	void idle();
+	struct PendingRead {
+		ResponseCallback<RegisterDataResponse> callback; /*!< Function to call when the response is complete. @since 0.3.0 */
+		uint32_t ttl_ms = 0; /*!< Time to cache the register values for. @since 0.3.0 */
+		uint16_t address = 0; /*!< Starting address. @since 0.3.0 */
+		uint8_t device = DeviceAddressType::BROADCAST; /*!< Device address (DeviceAddressType::BROADCAST if unused). @since 0.3.0 */
+		uint8_t function_code = 0; /*!< Read function code. @since 0.3.0 */
+	};
 
 	/**
-	 * Encode the request message at the top of the queue.
+	 * Read registers, using cached values if they have not expired.
 	 *
-	 * @since 0.1.0
+	 * @param[in] function_code Read function code.
+	 * @param[in] device Device address.
+	 * @param[in] address Starting address.
+	 * @param[in] size Quantity of registers.
+	 * @param[in] ttl_ms Time to cache the register values for in milliseconds.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response object to monitor for completion.
+	 * @since 0.3.0
 	 */
-	void encode();
+	ResponseHandle<const RegisterDataResponse> read(uint8_t function_code,
+		uint16_t device, uint16_t address, uint16_t size, uint32_t ttl_ms,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority);
 
 	/**
-	 * Transmit the current message frame on the serial port device.
+	 * Pass a read request to the client.
 	 *
-	 * @since 0.1.0
+	 * @param[in] function_code Read function code.
+	 * @param[in] device Device address.
+	 * @param[in] address Starting address.
+	 * @param[in] size Quantity of registers.
+	 * @param[in] callback Function to call when the response is complete.
+	 * @param[in] timeout_ms Timeout to wait for a response in milliseconds (0 = default).
+	 * @param[in] priority Priority of the request.
+	 * @return A response object to monitor for completion.
+	 * @since 0.3.0
 	 */
-	void transmit();
+	ResponseHandle<const RegisterDataResponse> client_read(uint8_t function_code,
+		uint16_t device, uint16_t address, uint16_t size,
+		const ResponseCallback<RegisterDataResponse> &callback, uint16_t timeout_ms,
+		RequestPriority priority);
 
 	/**
-	 * Read message frames from the serial port device.
+	 * Find the entry for a register.
 	 *
-	 * @return Current time from millis() at the last read event.
-	 * @since 0.1.0
+	 * @param[in] device Device address.
+	 * @param[in] function_code Read function code.
+	 * @param[in] address Register address.
+	 * @return Cache entry (or nullptr if there is no entry for the register).
+	 * @since 0.3.0
 	 */
-	uint32_t input();
+	RegisterCacheEntry* find(uint8_t device, uint8_t function_code, uint16_t address);
 
 	/**
-	 * Receive a message frame and identify the end of a message frame (or
-	 * timeout).
+	 * Store a register value.
 	 *
-	 * @since 0.1.0
+	 * Replaces an existing entry for the register, an unused or expired entry,
+	 * or the entry that expires first.
+	 *
+	 * @param[in] device Device address.
+	 * @param[in] function_code Read function code.
+	 * @param[in] address Register address.
+	 * @param[in] value Register value.
+	 * @param[in] expires_ms Time that the value expires.
+	 * @since 0.3.0
 	 */
-	void receive();
+	void store(uint8_t device, uint8_t function_code, uint16_t address,
+		uint16_t value, uint32_t expires_ms);
 
 	/**
-	 * Finish current request and populate response.
+	 * Get the first entry to search for a register.
 	 *
-	 * @since 0.1.0
+	 * @param[in] device Device address.
+	 * @param[in] function_code Read function code.
+	 * @param[in] address Register address.
+	 * @return Position of the first entry.
+	 * @since 0.3.0
 	 */
-	void complete();
+	size_t slot(uint8_t device, uint8_t function_code, uint16_t address) const;
 
 	/**
-	 * Log the contents of the current message frame.
+	 * Store the values from a completed read and call its callback.
 	 *
-	 * @param[in] prefix Message prefix ("<-" or "->").
-	 * @since 0.1.0
+	 * @param[in] index Position of the pending read.
+	 * @param[in] response Response to the read.
+	 * @since 0.3.0
 	 */
-	void log_frame(const __FlashStringHelper *prefix);
+	void read_complete(size_t index, const RegisterDataResponse &response);
 
 	/**
-	 * Calculate CRC for the current frame;
+	 * Determine if a cache entry has expired.
 	 *
-	 * @return CRC value.
-	 * @since 0.1.0
+	 * @param[in] entry Cache entry.
+	 * @param[in] now_ms Current time.
+	 * @return True if the entry has expired, otherwise false.
+	 * @since 0.3.0
 	 */
-	uint16_t calc_crc() const;
-
-	::HardwareSerial &serial_; /*!< Serial port device. @since 0.1.0 */
-	std::deque<std::unique_ptr<Request>> requests_; /*!< Pending requests. @since 0.1.0 */
-	uint16_t default_unicast_timeout_ms_ = DEFAULT_UNICAST_TIMEOUT_MS; /*!< Default timeout for new unicast requests. @since 0.2.0 */
-	uint16_t default_broadcast_timeout_ms_ = DEFAULT_BROADCAST_TIMEOUT_MS; /*!< Default timeout for new broadcast requests. @since 0.2.0 */
-
-	bool idle_frame_ = false; /*!< Message frame being received while idle. @since 0.1.0 */
-
-	frame_buffer_t frame_; /*!< Current message frame. @since 0.1.0 */
-	uint16_t frame_pos_ = 0; /*!< Position in message frame. @since 0.1.0 */
-
-	uint32_t last_rx_ms_ = 0; /*!< Time that the last character was received. @since 0.1.0 */
+	static inline bool expired(const RegisterCacheEntry &entry, uint32_t now_ms) {
+		return static_cast<int32_t>(entry.expires_ms_ - now_ms) <= 0;
+	}
 
-	uint16_t tx_frame_size_ = 0; /*!< Size of request frame to transmit. @since 0.1.0 */
-	uint32_t last_tx_ms_ = 0; /*!< Time that the last character was transmitted. @since 0.1.0 */
+	BaseClient &client_; /*!< Client to read registers with. @since 0.3.0 */
+	RegisterCacheEntry *entries_; /*!< Cache entries (owned by the caller). @since 0.3.0 */
+	size_t size_; /*!< Number of cache entries. @since 0.3.0 */
+	std::array<PendingRead, RequestQueue::CAPACITY> pending_; /*!< Reads in progress on the client. @since 0.3.0 */
+	uint32_t hits_ = 0; /*!< Number of cache hits. @since 0.3.0 */
+	uint32_t misses_ = 0; /*!< Number of cache misses. @since 0.3.0 */
 };
 
 } // namespace modbus
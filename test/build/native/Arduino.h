@@ -43,6 +43,7 @@ int snprintf_P(char *str, size_t size, const char *format, ...);
 int vsnprintf_P(char *str, size_t size, const char *format, va_list ap);
 
 #define pgm_read_byte(addr) (*reinterpret_cast<const char *>(addr))
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t *>(addr))
 
 void delay(unsigned long millis);
 
@@ -81,6 +82,22 @@ public:
 	virtual int available() = 0;
 	virtual int read() = 0;
 	virtual int peek() = 0;
+
+	virtual size_t readBytes(uint8_t *buffer, size_t length) {
+		size_t count = 0;
+
+		while (count < length) {
+			int value = read();
+
+			if (value < 0) {
+				break;
+			}
+
+			buffer[count++] = value;
+		}
+
+		return count;
+	}
 };
 
 class HardwareSerial: public Stream {
@@ -167,6 +184,7 @@ private:
 extern ModbusDevice Serial1;
 
 unsigned long millis();
+unsigned long micros();
 
 void yield(void);
 
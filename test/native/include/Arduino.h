@@ -20,6 +20,7 @@
 #define ARDUINO_H_
 
 #include <assert.h>
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -37,8 +38,10 @@ class __FlashStringHelper;
 #define vsnprintf_P vsnprintf
 
 #define pgm_read_byte(addr) (*reinterpret_cast<const char *>(addr))
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t *>(addr))
 
 unsigned long millis();
+unsigned long micros();
 
 static __attribute__((unused)) void yield(void) {}
 
@@ -61,6 +64,22 @@ public:
 	virtual int available() = 0;
 	virtual int read() = 0;
 	virtual int peek() = 0;
+
+	virtual size_t readBytes(uint8_t *buffer, size_t length) {
+		size_t count = 0;
+
+		while (count < length) {
+			int value = read();
+
+			if (value < 0) {
+				break;
+			}
+
+			buffer[count++] = value;
+		}
+
+		return count;
+	}
 };
 
 class HardwareSerial: public Stream {
@@ -90,6 +109,19 @@ public:
 		}
 	}
 
+	size_t readBytes(uint8_t *buffer, size_t length) override {
+		auto end = std::find(tx_.begin(), tx_.begin() + std::min(length, tx_.size()), -1);
+		size_t count = std::copy(tx_.begin(), end, buffer) - buffer;
+
+		if (count == 0 && end != tx_.end()) {
+			// Consume the read error
+			++end;
+		}
+
+		tx_.erase(tx_.begin(), end);
+		return count;
+	}
+
 	int peek() override {
 		if (!tx_.empty()) {
 			return tx_.front();
@@ -0,0 +1,201 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+/**
+ * Time to transmit a request, after which the response timeout starts.
+ *
+ * The clients are configured for 10000 baud so that each character takes
+ * exactly 1ms to transmit.
+ */
+static unsigned long transmit_ms(const uuid::modbus::SerialClient &client, size_t length) {
+	return (length * client.character_time_us() + 999) / 1000;
+}
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Read an input register from a device that responds after a delay (from the
+ * end of the transmission of the request).
+ */
+static void read_with_delay(ModbusDevice &device, uuid::modbus::SerialClient &client,
+		unsigned long delay_ms, uint8_t address = 7) {
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+
+	auto resp = client.read_input_registers(address, 0x1234, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	device.rx_.clear();
+
+	std::vector<uint8_t> frame{address, 0x04, 0x02, 0x56, 0x78};
+	uuid::modbus::CRC16 crc;
+
+	crc.update(frame.data(), frame.size());
+	frame.push_back(crc.value() & 0xFF);
+	frame.push_back(crc.value() >> 8);
+
+	fake_millis += transmit_ms(client, 8) + delay_ms;
+	device.tx_.insert(device.tx_.end(), frame.begin(), frame.end());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+}
+
+/**
+ * Wait for a request to time out and return how long it took (from the end of
+ * the transmission of the request).
+ */
+static unsigned long wait_for_timeout(ModbusDevice &device, uuid::modbus::SerialClient &client,
+		uint16_t address) {
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+
+	auto resp = client.read_input_registers(7, address, 1);
+	unsigned long start_ms = fake_millis;
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	device.rx_.clear();
+
+	while (resp->status() == uuid::modbus::ResponseStatus::WAITING) {
+		fake_millis++;
+		client.loop();
+	}
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
+	return fake_millis - start_ms - transmit_ms(client, 8);
+}
+
+/**
+ * The default timeout is used when adaptive timeouts are disabled.
+ */
+void adaptive_disabled() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 10000, uuid::modbus::SerialParity::NONE, 1};
+
+	TEST_ASSERT_EQUAL_INT(0, client.max_adaptive_timeout_ms());
+
+	read_with_delay(device, client, 20);
+	TEST_ASSERT_EQUAL_INT(20000, client.round_trip_time_us(7));
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::DEFAULT_UNICAST_TIMEOUT_MS, wait_for_timeout(device, client, 0x1000));
+}
+
+/**
+ * The timeout is calculated from the round-trip time and is doubled after
+ * each timeout.
+ */
+void adaptive_timeout() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 10000, uuid::modbus::SerialParity::NONE, 1};
+
+	client.adaptive_timeout_ms(50, 1000);
+	TEST_ASSERT_EQUAL_INT(50, client.min_adaptive_timeout_ms());
+	TEST_ASSERT_EQUAL_INT(1000, client.max_adaptive_timeout_ms());
+
+	TEST_ASSERT_EQUAL_INT(0, client.round_trip_time_us(7));
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::DEFAULT_UNICAST_TIMEOUT_MS, wait_for_timeout(device, client, 0x1000));
+
+	read_with_delay(device, client, 20);
+	TEST_ASSERT_EQUAL_INT(20000, client.round_trip_time_us(7));
+
+	// 20ms + 4 * 10ms
+	TEST_ASSERT_EQUAL_INT(60, wait_for_timeout(device, client, 0x1001));
+	TEST_ASSERT_EQUAL_INT(120, wait_for_timeout(device, client, 0x1002));
+
+	read_with_delay(device, client, 20);
+	TEST_ASSERT_EQUAL_INT(20000, client.round_trip_time_us(7));
+
+	// 20ms + 4 * 7.5ms
+	TEST_ASSERT_EQUAL_INT(50, wait_for_timeout(device, client, 0x1003));
+
+	for (int i = 0; i < 20; i++) {
+		read_with_delay(device, client, 5);
+	}
+
+	TEST_ASSERT_EQUAL_INT(50, wait_for_timeout(device, client, 0x1004));
+
+	for (int i = 0; i < uuid::modbus::SerialClient::MAX_TIMEOUT_BACKOFF; i++) {
+		wait_for_timeout(device, client, 0x1005);
+	}
+
+	TEST_ASSERT_EQUAL_INT(1000, wait_for_timeout(device, client, 0x1006));
+}
+
+/**
+ * Round-trip times are kept for a limited number of devices.
+ */
+void adaptive_devices() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 10000, uuid::modbus::SerialParity::NONE, 1};
+
+	client.adaptive_timeout_ms(50, 1000);
+	read_with_delay(device, client, 20);
+
+	read_with_delay(device, client, 30, 8);
+
+	for (uint8_t i = 0; i < UUID_MODBUS_DEVICE_TABLE_SIZE - 2; i++) {
+		read_with_delay(device, client, 10, 9 + i);
+	}
+
+	read_with_delay(device, client, 20, 7);
+	TEST_ASSERT_EQUAL_INT(20000, client.round_trip_time_us(7));
+	TEST_ASSERT_EQUAL_INT(30000, client.round_trip_time_us(8));
+
+	read_with_delay(device, client, 40, 100);
+	TEST_ASSERT_EQUAL_INT(20000, client.round_trip_time_us(7));
+	TEST_ASSERT_EQUAL_INT(0, client.round_trip_time_us(8));
+	TEST_ASSERT_EQUAL_INT(40000, client.round_trip_time_us(100));
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(adaptive_disabled);
+	RUN_TEST(adaptive_timeout);
+	RUN_TEST(adaptive_devices);
+
+	return UNITY_END();
+}
@@ -0,0 +1,240 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+static std::string sent(ModbusDevice &device) {
+	std::string data{device.rx_.begin(), device.rx_.end()};
+
+	device.rx_.clear();
+	return data;
+}
+
+static void receive(ModbusDevice &device, const std::string &data) {
+	device.tx_.insert(device.tx_.end(), data.begin(), data.end());
+}
+
+/**
+ * Requests are encoded as hexadecimal characters with an LRC and the response
+ * is complete as soon as the end of the frame is received.
+ */
+void ascii_read() {
+	ModbusDevice device;
+	uuid::modbus::AsciiClient client{device};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_STRING(":070412340001AE\r\n", sent(device).c_str());
+
+	receive(device, ":070402567825\r\n");
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(1, resp->data().size());
+	TEST_ASSERT_EQUAL_INT(0x5678, resp->data()[0]);
+
+	TEST_ASSERT_EQUAL_INT(2, test_messages.size());
+	TEST_ASSERT_EQUAL_STRING("-> 07 04'12 34 00 01'AE", test_messages[0].c_str());
+	TEST_ASSERT_EQUAL_STRING("<- 07 04'02 56 78'25", test_messages[1].c_str());
+}
+
+/**
+ * Responses are decoded as they are received, ignoring anything before the
+ * start of the frame.
+ */
+void ascii_split() {
+	ModbusDevice device;
+	uuid::modbus::AsciiClient client{device};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	receive(device, "\r\n?:07040");
+	fake_millis += 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	receive(device, "2567825\r");
+	fake_millis += 1000;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	receive(device, "\n");
+	fake_millis += 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(0x5678, resp->data()[0]);
+}
+
+/**
+ * Exception responses are decoded.
+ */
+void ascii_exception() {
+	ModbusDevice device;
+	uuid::modbus::AsciiClient client{device};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	receive(device, ":07840273\r\n");
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::EXCEPTION, resp->status());
+	TEST_ASSERT_EQUAL_INT(2, resp->exception_code());
+}
+
+/**
+ * Responses with an invalid LRC are rejected.
+ */
+void ascii_invalid_lrc() {
+	ModbusDevice device;
+	uuid::modbus::AsciiClient client{device};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	test_messages.clear();
+
+	receive(device, ":070402567826\r\n");
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CRC, resp->status());
+
+	TEST_ASSERT_EQUAL_INT(2, test_messages.size());
+	TEST_ASSERT_EQUAL_STRING("Received frame with invalid LRC 26 from device 7 with function 04, expected 25",
+		test_messages[1].c_str());
+}
+
+/**
+ * Responses with invalid characters are rejected.
+ */
+void ascii_invalid_character() {
+	ModbusDevice device;
+	uuid::modbus::AsciiClient client{device};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	receive(device, ":0704025678G25\r\n");
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CRC, resp->status());
+
+	resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	receive(device, ":07040256782\r\n");
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CRC, resp->status());
+
+	resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	receive(device, ":070402567825\n");
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CRC, resp->status());
+}
+
+/**
+ * An incomplete response fails when the timeout expires.
+ */
+void ascii_incomplete() {
+	ModbusDevice device;
+	uuid::modbus::AsciiClient client{device};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1, 100);
+
+	client.loop();
+	receive(device, ":0704025678");
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	// The timeout starts after the 17 characters of the request have been
+	// transmitted at the default character time
+	fake_millis += 99 + 25;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	fake_millis += 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TOO_SHORT, resp->status());
+}
+
+/**
+ * Requests are transmitted as space becomes available.
+ */
+void ascii_transmit_partial() {
+	ModbusDevice device;
+	uuid::modbus::AsciiClient client{device};
+
+	device.available_write_ = 5;
+
+	auto resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::TRANSMIT, resp->status());
+	TEST_ASSERT_EQUAL_STRING(":0704", sent(device).c_str());
+
+	device.available_write_ = 512;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_STRING("12340001AE\r\n", sent(device).c_str());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(ascii_read);
+	RUN_TEST(ascii_split);
+	RUN_TEST(ascii_exception);
+	RUN_TEST(ascii_invalid_lrc);
+	RUN_TEST(ascii_invalid_character);
+	RUN_TEST(ascii_incomplete);
+	RUN_TEST(ascii_transmit_partial);
+
+	return UNITY_END();
+}
@@ -0,0 +1,185 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+/**
+ * Time to transmit a request, after which the response timeout starts.
+ */
+static unsigned long transmit_ms(const uuid::modbus::SerialClient &client, size_t length) {
+	return (length * client.character_time_us() + 999) / 1000;
+}
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * The callback is called once when a response is received.
+ */
+void callback_success() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	unsigned int calls = 0;
+	uint16_t value = 0;
+
+	auto resp = client.read_input_registers(7, 0x1234, 1,
+		[&calls, &value] (const uuid::modbus::RegisterDataResponse &response) {
+			calls++;
+			TEST_ASSERT_TRUE(response.success());
+			value = response.data()[0];
+		});
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+	TEST_ASSERT_EQUAL_INT(0, calls);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_INT(0, calls);
+	device.rx_.clear();
+
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB2 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(1, calls);
+	TEST_ASSERT_EQUAL_INT(0x5678, value);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(1, calls);
+}
+
+/**
+ * The callback is called when there is no response.
+ */
+void callback_timeout() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uuid::modbus::ResponseStatus status = uuid::modbus::ResponseStatus::QUEUED;
+
+	client.write_holding_register(7, 0x1234, 0x5678,
+		[&status] (const uuid::modbus::RegisterWriteResponse &response) {
+			status = response.status();
+		}, 100);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, status);
+
+	fake_millis += 100 + transmit_ms(client, 8);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, status);
+}
+
+/**
+ * The callback is called before returning when the request fails immediately.
+ */
+void callback_invalid() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uuid::modbus::ResponseStatus status = uuid::modbus::ResponseStatus::QUEUED;
+
+	auto resp = client.read_exception_status(0,
+		[&status] (const uuid::modbus::ExceptionStatusResponse &response) {
+			status = response.status();
+		});
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, status);
+}
+
+static unsigned int function_calls = 0;
+
+static void count_response(const uuid::modbus::Response &response) {
+	function_calls++;
+}
+
+/**
+ * A callback for a less specific type of response can be used, and it can
+ * queue another request from the callback.
+ */
+void callback_function() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	static uuid::modbus::SerialClient *current_client;
+	static uuid::modbus::ResponseHandle<const uuid::modbus::RegisterDataResponse> next;
+
+	function_calls = 0;
+	current_client = &client;
+
+	client.read_holding_registers(0, 0x1234, 1, count_response);
+	TEST_ASSERT_EQUAL_INT(1, function_calls);
+
+	for (size_t i = 0; i < uuid::modbus::RequestQueue::CAPACITY - 1; i++) {
+		client.write_holding_register(0, i, i);
+	}
+
+	auto resp = client.write_holding_register(0, 0x1234, 0x5678,
+		[] (const uuid::modbus::RegisterWriteResponse &response) {
+			count_response(response);
+			next = current_client->read_input_registers(7, 0x1234, 1, count_response);
+		});
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+
+	for (size_t i = 0; i < uuid::modbus::RequestQueue::CAPACITY; i++) {
+		fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+		client.loop();
+		fake_millis += uuid::modbus::DEFAULT_BROADCAST_TIMEOUT_MS + transmit_ms(client, 8);
+		client.loop();
+	}
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(2, function_calls);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, next->status());
+
+	next.reset();
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(callback_success);
+	RUN_TEST(callback_timeout);
+	RUN_TEST(callback_invalid);
+	RUN_TEST(callback_function);
+
+	return UNITY_END();
+}
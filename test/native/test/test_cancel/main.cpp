@@ -0,0 +1,226 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Queued requests can be cancelled but requests that have been transmitted
+ * can't.
+ */
+void cancel_queued() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uuid::modbus::ResponseStatus status = uuid::modbus::ResponseStatus::QUEUED;
+
+	auto resp1 = client.read_input_registers(7, 0x1234, 1);
+	auto resp2 = client.write_holding_register(7, 0x5678, 1,
+		[&status] (const uuid::modbus::RegisterWriteResponse &response) {
+			status = response.status();
+		});
+	auto resp3 = client.read_input_registers(7, 0x4321, 1);
+
+	TEST_ASSERT_TRUE(client.cancel(*resp2));
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CANCELLED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CANCELLED, status);
+	TEST_ASSERT_FALSE(client.cancel(*resp2));
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	TEST_ASSERT_FALSE(client.cancel(*resp1));
+	device.rx_.clear();
+
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB2 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp3->status());
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x43, device.rx_[2]);
+	TEST_ASSERT_EQUAL_UINT8(0x21, device.rx_[3]);
+}
+
+/**
+ * Read requests are cancelled when nothing is waiting for the response, but
+ * write requests are still transmitted.
+ */
+void cancel_abandoned() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.read_input_registers(7, 0x1234, 1);
+	client.write_holding_register(7, 0x5678, 1);
+	auto resp = client.read_input_registers(7, 0x4321, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x06, device.rx_[1]);
+	TEST_ASSERT_EQUAL_UINT8(0x56, device.rx_[2]);
+	TEST_ASSERT_EQUAL_UINT8(0x78, device.rx_[3]);
+	device.rx_.clear();
+
+	resp.reset();
+
+	fake_millis += uuid::modbus::DEFAULT_UNICAST_TIMEOUT_MS;
+	client.loop();
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(0, device.rx_.size());
+}
+
+/**
+ * Read requests are not cancelled when another response is attached to
+ * them.
+ */
+void cancel_attached() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.read_input_registers(7, 0x1234, 2);
+	auto resp = client.read_input_registers(7, 0x1235, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x12, device.rx_[2]);
+	TEST_ASSERT_EQUAL_UINT8(0x34, device.rx_[3]);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+	TEST_ASSERT_FALSE(client.cancel(*resp));
+}
+
+/**
+ * Requests that have been waiting in the queue for too long are removed.
+ */
+void queue_timeout() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uuid::modbus::ResponseStatus status = uuid::modbus::ResponseStatus::QUEUED;
+
+	TEST_ASSERT_EQUAL_INT(0, client.queue_timeout_ms());
+	client.queue_timeout_ms(100);
+	TEST_ASSERT_EQUAL_INT(100, client.queue_timeout_ms());
+
+	auto resp1 = client.read_input_registers(7, 0x1234, 1);
+	fake_millis += 50;
+	auto resp2 = client.read_input_registers(7, 0x4321, 1,
+		[&status] (const uuid::modbus::RegisterDataResponse &response) {
+			status = response.status();
+		});
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	device.rx_.clear();
+
+	fake_millis += 99;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+
+	fake_millis += 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_EXPIRED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_EXPIRED, status);
+}
+
+/**
+ * The time that a request can wait in the queue can be set for each request,
+ * overriding the default.
+ */
+void queue_timeout_request() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.queue_timeout_ms(100);
+
+	auto resp1 = client.read_input_registers(7, 0x1234, 1);
+	auto resp2 = client.read_input_registers(7, 0x4321, 1);
+	auto resp3 = client.read_input_registers(7, 0x5678, 1);
+	client.queue_timeout_ms(0);
+	auto resp4 = client.read_input_registers(7, 0x8765, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	device.rx_.clear();
+
+	TEST_ASSERT_FALSE(client.queue_timeout_ms(*resp1, 30));
+	TEST_ASSERT_TRUE(client.queue_timeout_ms(*resp2, 30));
+	TEST_ASSERT_TRUE(client.queue_timeout_ms(*resp4, 60));
+
+	fake_millis += 29;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+
+	fake_millis += 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_EXPIRED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp3->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp4->status());
+
+	fake_millis += 30;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp3->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_EXPIRED, resp4->status());
+
+	fake_millis += 40;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_EXPIRED, resp3->status());
+	TEST_ASSERT_FALSE(client.queue_timeout_ms(*resp3, 0));
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(cancel_queued);
+	RUN_TEST(cancel_abandoned);
+	RUN_TEST(cancel_attached);
+	RUN_TEST(queue_timeout);
+	RUN_TEST(queue_timeout_request);
+
+	return UNITY_END();
+}
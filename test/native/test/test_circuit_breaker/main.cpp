@@ -0,0 +1,299 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+/**
+ * Time to transmit a request, after which the response timeout starts.
+ */
+static unsigned long transmit_ms(const uuid::modbus::SerialClient &client, size_t length) {
+	return (length * client.character_time_us() + 999) / 1000;
+}
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Send a read request to a device that doesn't respond.
+ */
+static void read_timeout(ModbusDevice &device, uuid::modbus::SerialClient &client,
+		uint8_t address = 7) {
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+
+	auto resp = client.read_input_registers(address, 0x1234, 1, 10);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_FALSE(device.rx_.empty());
+	device.rx_.clear();
+
+	fake_millis += 10 + transmit_ms(client, 8);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
+}
+
+/**
+ * Send a read request to a device that responds.
+ */
+static void read_response(ModbusDevice &device, uuid::modbus::SerialClient &client,
+		uint8_t address = 7) {
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+
+	auto resp = client.read_input_registers(address, 0x1234, 1, 10);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_FALSE(device.rx_.empty());
+	device.rx_.clear();
+
+	std::vector<uint8_t> frame{address, 0x04, 0x02, 0x56, 0x78};
+	uuid::modbus::CRC16 crc;
+
+	crc.update(frame.data(), frame.size());
+	frame.push_back(crc.value() & 0xFF);
+	frame.push_back(crc.value() >> 8);
+
+	fake_millis += 1;
+	device.tx_.insert(device.tx_.end(), frame.begin(), frame.end());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+}
+
+/**
+ * Send a read request to a device that is unavailable.
+ */
+static void read_unavailable(ModbusDevice &device, uuid::modbus::SerialClient &client,
+		uint8_t address = 7) {
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+
+	auto resp = client.read_input_registers(address, 0x1234, 1, 10);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_UNAVAILABLE, resp->status());
+	TEST_ASSERT_TRUE(device.rx_.empty());
+}
+
+/**
+ * Requests are always sent when the circuit breaker is disabled.
+ */
+void circuit_disabled() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	TEST_ASSERT_EQUAL_INT(0, client.circuit_breaker_threshold());
+
+	for (int i = 0; i < 10; i++) {
+		read_timeout(device, client);
+	}
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::CLOSED, client.circuit_state(7));
+	TEST_ASSERT_EQUAL_INT(0, client.consecutive_timeouts(7));
+}
+
+/**
+ * Requests fail without being sent after consecutive timeouts.
+ */
+void circuit_open() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.circuit_breaker(3, 100, 1000);
+	TEST_ASSERT_EQUAL_INT(3, client.circuit_breaker_threshold());
+	TEST_ASSERT_EQUAL_INT(100, client.min_circuit_retry_ms());
+	TEST_ASSERT_EQUAL_INT(1000, client.max_circuit_retry_ms());
+
+	read_timeout(device, client);
+	read_timeout(device, client);
+	read_response(device, client);
+	TEST_ASSERT_EQUAL_INT(0, client.consecutive_timeouts(7));
+
+	read_timeout(device, client);
+	read_timeout(device, client);
+	TEST_ASSERT_EQUAL_INT(2, client.consecutive_timeouts(7));
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::CLOSED, client.circuit_state(7));
+
+	read_timeout(device, client);
+	TEST_ASSERT_EQUAL_INT(3, client.consecutive_timeouts(7));
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::OPEN, client.circuit_state(7));
+
+	read_unavailable(device, client);
+
+	// Other devices are not affected
+	read_response(device, client, 8);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::CLOSED, client.circuit_state(8));
+}
+
+/**
+ * Queued requests fail when the circuit breaker opens.
+ */
+void circuit_queued() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.circuit_breaker(1, 100, 1000);
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+
+	auto resp1 = client.read_input_registers(7, 0x1000, 1, 10);
+	auto resp2 = client.read_input_registers(7, 0x1001, 1, 10);
+	auto resp3 = client.read_input_registers(8, 0x1002, 1, 10);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	device.rx_.clear();
+
+	fake_millis += 10 + transmit_ms(client, 8);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_UNAVAILABLE, resp2->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp3->status());
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.front());
+	device.rx_.clear();
+}
+
+/**
+ * A single request is sent after the retry interval, which is doubled each
+ * time the device doesn't respond.
+ */
+void circuit_retry() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.circuit_breaker(1, 100, 300);
+
+	read_timeout(device, client);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::OPEN, client.circuit_state(7));
+
+	unsigned long opened_ms = fake_millis;
+
+	fake_millis = opened_ms + 99 - uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	read_unavailable(device, client);
+
+	fake_millis = opened_ms + 100;
+	auto resp1 = client.read_input_registers(7, 0x1000, 1, 10);
+	auto resp2 = client.read_input_registers(7, 0x1001, 1, 10);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::HALF_OPEN, client.circuit_state(7));
+	device.rx_.clear();
+
+	fake_millis += 10 + transmit_ms(client, 8);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_UNAVAILABLE, resp2->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::OPEN, client.circuit_state(7));
+	TEST_ASSERT_EQUAL_INT(2, client.consecutive_timeouts(7));
+
+	// Retry interval is doubled
+	opened_ms = fake_millis;
+	fake_millis = opened_ms + 199 - uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	read_unavailable(device, client);
+	fake_millis = opened_ms + 200 - uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	read_timeout(device, client);
+
+	// Retry interval is limited to the maximum
+	opened_ms = fake_millis;
+	fake_millis = opened_ms + 299 - uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	read_unavailable(device, client);
+	fake_millis = opened_ms + 300 - uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	read_response(device, client);
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::CLOSED, client.circuit_state(7));
+	TEST_ASSERT_EQUAL_INT(0, client.consecutive_timeouts(7));
+	read_response(device, client);
+}
+
+/**
+ * The circuit breaker stays half-open when the request sent after the retry
+ * interval fails without a timeout, so that the next request is sent.
+ */
+void circuit_retry_invalid() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.circuit_breaker(1, 100, 300);
+
+	read_timeout(device, client);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::OPEN, client.circuit_state(7));
+
+	fake_millis += 100;
+	auto resp = client.read_input_registers(7, 0x1234, 1, 10);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::HALF_OPEN, client.circuit_state(7));
+	device.rx_.clear();
+
+	// Invalid CRC
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB3 });
+	fake_millis += 1;
+	client.loop();
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CRC, resp->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::HALF_OPEN, client.circuit_state(7));
+
+	read_response(device, client);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CircuitState::CLOSED, client.circuit_state(7));
+	TEST_ASSERT_EQUAL_INT(0, client.consecutive_timeouts(7));
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(circuit_disabled);
+	RUN_TEST(circuit_open);
+	RUN_TEST(circuit_queued);
+	RUN_TEST(circuit_retry);
+	RUN_TEST(circuit_retry_invalid);
+
+	return UNITY_END();
+}
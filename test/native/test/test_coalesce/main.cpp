@@ -0,0 +1,213 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * A read that is contained in a queued read is completed from the same
+ * response without sending another request.
+ */
+void coalesce_contained() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	unsigned int calls = 0;
+
+	auto resp1 = client.read_holding_registers(7, 0x0010, 5);
+	auto resp2 = client.read_holding_registers(7, 0x0012, 2,
+		[&calls] (const uuid::modbus::RegisterDataResponse &response) {
+			calls++;
+		});
+	auto resp3 = client.read_holding_registers(7, 0x0010, 5);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp3->status());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x84, device.rx_[6]);
+	TEST_ASSERT_EQUAL_UINT8(0x6A, device.rx_[7]);
+	device.rx_.clear();
+
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x03, 0x0A, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04,
+		0x00, 0x05, 0xC6, 0xE2 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp2->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp3->status());
+	TEST_ASSERT_EQUAL_INT(1, calls);
+
+	TEST_ASSERT_EQUAL_INT(5, resp1->data().size());
+	TEST_ASSERT_EQUAL_INT(2, resp2->data().size());
+	TEST_ASSERT_EQUAL_UINT16(0x0003, resp2->data()[0]);
+	TEST_ASSERT_EQUAL_UINT16(0x0004, resp2->data()[1]);
+	TEST_ASSERT_EQUAL_INT(5, resp3->data().size());
+	TEST_ASSERT_EQUAL_UINT16(0x0005, resp3->data()[4]);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(0, device.rx_.size());
+}
+
+/**
+ * Attached reads get the same exception response.
+ */
+void coalesce_exception() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	auto resp1 = client.read_holding_registers(7, 0x0010, 5);
+	auto resp2 = client.read_holding_registers(7, 0x0011, 1);
+
+	client.loop();
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), { 0x07, 0x83, 0x02, 0x20, 0xF0 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::EXCEPTION, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::EXCEPTION, resp2->status());
+	TEST_ASSERT_EQUAL_INT(0x02, resp2->exception_code());
+	TEST_ASSERT_EQUAL_INT(0, resp2->data().size());
+}
+
+/**
+ * Fill the queue with reads from another device.
+ */
+static void fill_queue(uuid::modbus::SerialClient &client, size_t count,
+		std::vector<uuid::modbus::ResponseHandle<const uuid::modbus::RegisterDataResponse>> &resps) {
+	for (size_t i = 0; i < count; i++) {
+		resps.push_back(client.read_input_registers(9, 0x1000 + i, 1));
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resps.back()->status());
+	}
+}
+
+/**
+ * Reads are attached even when the queue is full.
+ */
+void coalesce_queue_full() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	std::vector<uuid::modbus::ResponseHandle<const uuid::modbus::RegisterDataResponse>> resps;
+
+	auto resp1 = client.read_holding_registers(7, 0x0010, 5);
+	fill_queue(client, uuid::modbus::RequestQueue::CAPACITY - 1, resps);
+
+	auto resp2 = client.read_holding_registers(7, 0x0010, 5);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+
+	auto resp3 = client.read_holding_registers(7, 0x0014, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp3->status());
+}
+
+/**
+ * Reads are not attached to requests that have already been sent, to
+ * requests for a different device or function, or to requests for a range
+ * that does not contain them.
+ */
+void coalesce_mismatch() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	std::vector<uuid::modbus::ResponseHandle<const uuid::modbus::RegisterDataResponse>> resps;
+
+	auto resp1 = client.read_holding_registers(7, 0x0010, 5);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	fill_queue(client, uuid::modbus::RequestQueue::CAPACITY - 1, resps);
+
+	auto resp2 = client.read_holding_registers(7, 0x0010, 5);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_QUEUE_FULL, resp2->status());
+	resp2.reset();
+
+	auto resp3 = client.read_holding_registers(9, 0x1000, 2);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_QUEUE_FULL, resp3->status());
+	resp3.reset();
+
+	auto resp4 = client.read_holding_registers(9, 0x1001, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_QUEUE_FULL, resp4->status());
+	resp4.reset();
+
+	auto resp5 = client.read_input_registers(8, 0x1001, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_QUEUE_FULL, resp5->status());
+	resp5.reset();
+
+	auto resp6 = client.read_input_registers(9, 0x1001, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp6->status());
+}
+
+/**
+ * Reads queued after a write to the same device are not attached to reads
+ * queued before the write.
+ */
+void coalesce_after_write() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	std::vector<uuid::modbus::ResponseHandle<const uuid::modbus::RegisterDataResponse>> resps;
+
+	auto resp1 = client.read_holding_registers(7, 0x0010, 5);
+	auto resp2 = client.write_holding_register(7, 0x0011, 0x1234);
+	fill_queue(client, uuid::modbus::RequestQueue::CAPACITY - 2, resps);
+
+	auto resp3 = client.read_holding_registers(7, 0x0011, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_QUEUE_FULL, resp3->status());
+
+	auto resp4 = client.read_input_registers(9, 0x1000, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp4->status());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(coalesce_contained);
+	RUN_TEST(coalesce_exception);
+	RUN_TEST(coalesce_queue_full);
+	RUN_TEST(coalesce_mismatch);
+	RUN_TEST(coalesce_after_write);
+
+	return UNITY_END();
+}
@@ -0,0 +1,312 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Read 10 coils.
+ */
+void read_coils_10() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	auto resp = client.read_coils(7, 0x0013, 10);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x07, device.rx_[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x01, device.rx_[1]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[2]);
+	TEST_ASSERT_EQUAL_UINT8(0x13, device.rx_[3]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[4]);
+	TEST_ASSERT_EQUAL_UINT8(0x0A, device.rx_[5]);
+	TEST_ASSERT_EQUAL_UINT8(0x4D, device.rx_[6]);
+	TEST_ASSERT_EQUAL_UINT8(0xAE, device.rx_[7]);
+
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x01, 0x02, 0xCD, 0x01, 0xA4, 0xAC });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_TRUE(resp->success());
+
+	TEST_ASSERT_EQUAL_INT(10, resp->data().size());
+	TEST_ASSERT_EQUAL_INT(2, resp->data().data_size());
+	TEST_ASSERT_EQUAL_UINT8(0xCD, resp->data().data()[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x01, resp->data().data()[1]);
+
+	const bool expected[] = {
+		true, false, true, true, false, false, true, true,
+		true, false };
+	size_t i = 0;
+
+	for (bool value : resp->data()) {
+		TEST_ASSERT_EQUAL_INT(expected[i], value);
+		TEST_ASSERT_EQUAL_INT(expected[i], resp->data()[i]);
+		i++;
+	}
+	TEST_ASSERT_EQUAL_INT(10, i);
+}
+
+/**
+ * Read 22 discrete inputs.
+ */
+void read_discrete_inputs_22() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	auto resp = client.read_discrete_inputs(7, 0x00C4, 22);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x02, device.rx_[1]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[2]);
+	TEST_ASSERT_EQUAL_UINT8(0xC4, device.rx_[3]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[4]);
+	TEST_ASSERT_EQUAL_UINT8(0x16, device.rx_[5]);
+
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x02, 0x03, 0xAC, 0xDB, 0x35, 0x22, 0xEE });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+
+	TEST_ASSERT_EQUAL_INT(22, resp->data().size());
+	TEST_ASSERT_FALSE(resp->data()[0]);
+	TEST_ASSERT_TRUE(resp->data()[2]);
+	TEST_ASSERT_TRUE(resp->data()[8]);
+	TEST_ASSERT_FALSE(resp->data()[10]);
+	TEST_ASSERT_TRUE(resp->data()[16]);
+	TEST_ASSERT_TRUE(resp->data()[21]);
+}
+
+/**
+ * Read 3 coils, excluding the padding in the response.
+ */
+void read_coils_3() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	auto resp = client.read_coils(7, 0x0013, 3);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x01, 0x01, 0xFD, 0x90, 0x81 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(3, resp->data().size());
+	TEST_ASSERT_FALSE(resp->data().empty());
+
+	size_t i = 0;
+
+	for (bool value : resp->data()) {
+		TEST_ASSERT_EQUAL_INT(i != 1, value);
+		i++;
+	}
+	TEST_ASSERT_EQUAL_INT(3, i);
+}
+
+/**
+ * A response without enough bytes for the number of coils is invalid.
+ */
+void read_coils_too_few_bytes() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	auto resp = client.read_coils(7, 0x0013, 10);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x01, 0x01, 0xCD, 0x90, 0x95 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_LENGTH, resp->status());
+}
+
+/**
+ * Read an invalid number of coils.
+ */
+void read_coils_invalid_size() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	auto resp = client.read_coils(7, 0x0013, 0);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.read_coils(7, 0x0013, uuid::modbus::MAX_READ_BITS + 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.read_discrete_inputs(0, 0x0013, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.read_discrete_inputs(7, 0x0013, uuid::modbus::MAX_READ_BITS);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+}
+
+/**
+ * Write a single coil.
+ */
+void write_coil() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	auto resp = client.write_coil(7, 0x00AC, true);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x07, device.rx_[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x05, device.rx_[1]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[2]);
+	TEST_ASSERT_EQUAL_UINT8(0xAC, device.rx_[3]);
+	TEST_ASSERT_EQUAL_UINT8(0xFF, device.rx_[4]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[5]);
+
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x05, 0x00, 0xAC, 0xFF, 0x00, 0x4C, 0x7D });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(0x00AC, resp->address());
+	TEST_ASSERT_EQUAL_INT(0xFF00, resp->data()[0]);
+}
+
+/**
+ * Write 10 coils.
+ */
+void write_coils_10() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	const uint8_t values[] = { 0xCD, 0xFD };
+
+	auto resp = client.write_coils(7, 0x0013, values, 10);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	TEST_ASSERT_EQUAL_INT(11, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x07, device.rx_[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x0F, device.rx_[1]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[2]);
+	TEST_ASSERT_EQUAL_UINT8(0x13, device.rx_[3]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[4]);
+	TEST_ASSERT_EQUAL_UINT8(0x0A, device.rx_[5]);
+	TEST_ASSERT_EQUAL_UINT8(0x02, device.rx_[6]);
+	TEST_ASSERT_EQUAL_UINT8(0xCD, device.rx_[7]);
+	TEST_ASSERT_EQUAL_UINT8(0x01, device.rx_[8]);
+	TEST_ASSERT_EQUAL_UINT8(0x59, device.rx_[9]);
+	TEST_ASSERT_EQUAL_UINT8(0x6B, device.rx_[10]);
+
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x0F, 0x00, 0x13, 0x00, 0x0A, 0x24, 0x6F });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(0x0013, resp->address());
+	TEST_ASSERT_EQUAL_INT(10, resp->data()[0]);
+}
+
+/**
+ * Write an invalid number of coils.
+ */
+void write_coils_invalid_size() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uint8_t values[(uuid::modbus::MAX_WRITE_BITS + 8) / 8] = { 0 };
+
+	auto resp = client.write_coils(7, 0x0013, values, 0);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.write_coils(7, 0x0013, values, uuid::modbus::MAX_WRITE_BITS + 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.write_coils(7, 0x0013, nullptr, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.write_coils(7, 0x0013, values, uuid::modbus::MAX_WRITE_BITS);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_INT(9 + uuid::modbus::MAX_WRITE_BITS / 8, device.rx_.size());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(read_coils_10);
+	RUN_TEST(read_discrete_inputs_22);
+	RUN_TEST(read_coils_3);
+	RUN_TEST(read_coils_too_few_bytes);
+	RUN_TEST(read_coils_invalid_size);
+
+	RUN_TEST(write_coil);
+	RUN_TEST(write_coils_10);
+	RUN_TEST(write_coils_invalid_size);
+
+	return UNITY_END();
+}
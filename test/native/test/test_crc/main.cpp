@@ -27,6 +27,10 @@ unsigned long millis() {
 	return fake_millis;
 }
 
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
 namespace uuid {
 
 uint64_t get_uptime_ms() {
@@ -47,7 +51,7 @@ void test() {
 	ModbusDevice device;
 	uuid::modbus::SerialClient client{device};
 
-	client.read_exception_status(2);
+	auto resp = client.read_exception_status(2);
 	client.loop();
 
 	TEST_ASSERT_EQUAL_INT(4, device.rx_.size());
@@ -57,8 +61,18 @@ void test() {
 	TEST_ASSERT_EQUAL_UINT8(0x12, device.rx_[3]);
 }
 
+/**
+ * The CRC-16/MODBUS check value for "123456789" is 0x4B37.
+ */
+void check_value() {
+	static const uint8_t data[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+	TEST_ASSERT_EQUAL_UINT16(0x4B37, uuid::modbus::CRC16::calculate(data, sizeof(data)));
+}
+
 int main(int argc, char *argv[]) {
 	UNITY_BEGIN();
 	RUN_TEST(test);
+	RUN_TEST(check_value);
 	return UNITY_END();
 }
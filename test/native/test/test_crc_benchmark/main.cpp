@@ -0,0 +1,168 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+static constexpr unsigned int ITERATIONS = 2000;
+static volatile uint16_t sink;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Bit-by-bit implementation used before the lookup table.
+ */
+static uint16_t bitwise_crc(const uint8_t *data, size_t len) {
+	uint16_t crc = 0xFFFF;
+
+	for (size_t i = 0; i < len; i++) {
+		crc = crc ^ data[i];
+
+		for (uint8_t b = 0; b < 8; b++) {
+			if (crc & 0x0001) {
+				crc >>= 1;
+				crc ^= 0xA001;
+			} else {
+				crc >>= 1;
+			}
+		}
+	}
+
+	return crc;
+}
+
+static std::vector<uint8_t> test_frame() {
+	std::vector<uint8_t> frame(uuid::modbus::MAX_MESSAGE_SIZE);
+	uint32_t seed = 0x12345678;
+
+	for (auto &value : frame) {
+		seed = seed * 1103515245 + 12345;
+		value = seed >> 24;
+	}
+
+	return frame;
+}
+
+/**
+ * Every single byte value produces the same CRC as the bitwise implementation.
+ */
+void single_bytes() {
+	for (uint16_t i = 0; i <= 0xFF; i++) {
+		uint8_t value = i;
+
+		TEST_ASSERT_EQUAL_INT(bitwise_crc(&value, 1),
+			uuid::modbus::CRC16::calculate(&value, 1));
+	}
+}
+
+/**
+ * Every prefix of a maximum size frame produces the same CRC as the bitwise
+ * implementation.
+ */
+void all_lengths() {
+	auto frame = test_frame();
+
+	for (size_t len = 0; len <= frame.size(); len++) {
+		TEST_ASSERT_EQUAL_INT(bitwise_crc(frame.data(), len),
+			uuid::modbus::CRC16::calculate(frame.data(), len));
+	}
+}
+
+/**
+ * Incremental updates produce the same CRC as a single calculation.
+ */
+void incremental() {
+	auto frame = test_frame();
+	uuid::modbus::CRC16 crc;
+
+	for (auto value : frame) {
+		crc.update(value);
+	}
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CRC16::calculate(frame.data(), frame.size()),
+		crc.value());
+
+	crc.reset();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::CRC16::INITIAL, crc.value());
+}
+
+/**
+ * Compare the time taken by the lookup table and bitwise implementations.
+ */
+void benchmark() {
+	auto frame = test_frame();
+	char message[128];
+
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < ITERATIONS; i++) {
+		sink = bitwise_crc(frame.data(), frame.size());
+	}
+	auto bitwise = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < ITERATIONS; i++) {
+		sink = uuid::modbus::CRC16::calculate(frame.data(), frame.size());
+	}
+	auto table = std::chrono::steady_clock::now() - start;
+
+	snprintf(message, sizeof(message), "CRC of %u byte frame: bitwise %.1fns, table (%u entries) %.1fns",
+		(unsigned int)frame.size(),
+		std::chrono::duration<double, std::nano>(bitwise).count() / ITERATIONS,
+		UUID_MODBUS_CRC_TABLE_SIZE,
+		std::chrono::duration<double, std::nano>(table).count() / ITERATIONS);
+	TEST_MESSAGE(message);
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+	RUN_TEST(single_bytes);
+	RUN_TEST(all_lengths);
+	RUN_TEST(incremental);
+	RUN_TEST(benchmark);
+	return UNITY_END();
+}
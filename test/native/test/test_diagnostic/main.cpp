@@ -27,6 +27,10 @@ unsigned long millis() {
 	return fake_millis;
 }
 
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
 namespace uuid {
 
 uint64_t get_uptime_ms() {
@@ -38,6 +42,13 @@ uint64_t get_uptime_ms() {
 
 std::vector<std::string> test_messages;
 
+/**
+ * Time to transmit a request, after which the response timeout starts.
+ */
+static unsigned long transmit_ms(const uuid::modbus::SerialClient &client, size_t length) {
+	return (length * client.character_time_us() + 999) / 1000;
+}
+
 void setUp() {
 	test_messages.clear();
 	fake_millis = 0;
@@ -68,12 +79,6 @@ void read_exception_status() {
 	device.tx_.insert(device.tx_.end(), {
 		0x0B, 0x07, 0x6D, 0xC3, 0xDF });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -218,7 +223,7 @@ void read_exception_status_no_response() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(10000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(10000 + transmit_ms(client, 4), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -249,7 +254,7 @@ void read_exception_status_no_response_explicit_timeout() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(8000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(8000 + transmit_ms(client, 4), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -282,7 +287,7 @@ void read_exception_status_no_response_implicit_default_timeout() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(8000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(8000 + transmit_ms(client, 4), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -315,7 +320,7 @@ void read_exception_status_no_response_explicit_default_timeout() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(8000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(8000 + transmit_ms(client, 4), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -0,0 +1,235 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+static uuid::modbus::RegisterRequest read_request(uint16_t device) {
+	return uuid::modbus::RegisterRequest{device,
+		uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 100, 0x1234, 1,
+		uuid::modbus::ResponsePool::make<uuid::modbus::RegisterDataResponse>()};
+}
+
+/**
+ * RTU requests are encoded with a CRC and can be transmitted in parts.
+ */
+void rtu_encode() {
+	uuid::modbus::RtuFraming framing;
+	auto request = read_request(7);
+	size_t len;
+
+	TEST_ASSERT_FALSE(framing.tx_pending());
+	TEST_ASSERT_TRUE(framing.encode(request, 0));
+	TEST_ASSERT_TRUE(framing.tx_pending());
+
+	const uint8_t *data = framing.tx_data(len);
+	TEST_ASSERT_EQUAL_INT(8, len);
+	TEST_ASSERT_EQUAL_UINT8(0x07, data[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x04, data[1]);
+	TEST_ASSERT_EQUAL_UINT8(0x12, data[2]);
+	TEST_ASSERT_EQUAL_UINT8(0x34, data[3]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, data[4]);
+	TEST_ASSERT_EQUAL_UINT8(0x01, data[5]);
+	TEST_ASSERT_EQUAL_UINT8(0x75, data[6]);
+	TEST_ASSERT_EQUAL_UINT8(0x1A, data[7]);
+
+	framing.tx_advance(5);
+	TEST_ASSERT_TRUE(framing.tx_pending());
+
+	data = framing.tx_data(len);
+	TEST_ASSERT_EQUAL_INT(3, len);
+	TEST_ASSERT_EQUAL_UINT8(0x01, data[0]);
+
+	framing.tx_advance(3);
+	TEST_ASSERT_FALSE(framing.tx_pending());
+
+	TEST_ASSERT_EQUAL_INT(1, test_messages.size());
+	TEST_ASSERT_EQUAL_STRING("-> 07 04'12 34 00 01'75 1A", test_messages[0].c_str());
+}
+
+/**
+ * RTU responses are complete when they reach the expected length with a
+ * valid CRC.
+ */
+void rtu_receive() {
+	uuid::modbus::RtuFraming framing;
+	auto request = read_request(7);
+	const std::vector<uint8_t> response{ 0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB2 };
+	uint16_t len;
+	uint16_t transaction;
+	size_t space;
+
+	uint8_t *buffer = framing.rx_space(space);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::MAX_MESSAGE_SIZE + 1, space);
+	std::copy(response.begin(), response.begin() + 4, buffer);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::FrameState::PARTIAL, framing.rx_advance(4));
+	TEST_ASSERT_EQUAL_INT(4, framing.rx_size());
+	TEST_ASSERT_FALSE(framing.rx_complete(request));
+
+	buffer = framing.rx_space(space);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::MAX_MESSAGE_SIZE + 1 - 4, space);
+	std::copy(response.begin() + 4, response.end(), buffer);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::FrameState::PARTIAL, framing.rx_advance(3));
+	TEST_ASSERT_TRUE(framing.rx_complete(request));
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, framing.decode(len, transaction));
+	TEST_ASSERT_EQUAL_INT(5, len);
+	TEST_ASSERT_EQUAL_INT(0, transaction);
+	TEST_ASSERT_EQUAL_UINT8(0x56, framing.rx_frame()[3]);
+
+	framing.rx_reset();
+	TEST_ASSERT_EQUAL_INT(0, framing.rx_size());
+}
+
+/**
+ * RTU responses with an invalid CRC are rejected.
+ */
+void rtu_invalid_crc() {
+	uuid::modbus::RtuFraming framing;
+	auto request = read_request(7);
+	const std::vector<uint8_t> response{ 0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB3 };
+	uint16_t len;
+	uint16_t transaction;
+	size_t space;
+
+	std::copy(response.begin(), response.end(), framing.rx_space(space));
+	framing.rx_advance(response.size());
+	TEST_ASSERT_FALSE(framing.rx_complete(request));
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CRC, framing.decode(len, transaction));
+}
+
+/**
+ * MBAP requests are encoded with a header containing the transaction
+ * identifier and length.
+ */
+void mbap_encode() {
+	uuid::modbus::MbapFraming framing;
+	auto request = read_request(7);
+	size_t len;
+
+	TEST_ASSERT_TRUE(framing.encode(request, 0x1234));
+
+	const uint8_t *data = framing.tx_data(len);
+	TEST_ASSERT_EQUAL_INT(6, len);
+	TEST_ASSERT_EQUAL_UINT8(0x12, data[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x34, data[1]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, data[2]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, data[3]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, data[4]);
+	TEST_ASSERT_EQUAL_UINT8(0x06, data[5]);
+
+	framing.tx_advance(len);
+	TEST_ASSERT_TRUE(framing.tx_pending());
+
+	data = framing.tx_data(len);
+	TEST_ASSERT_EQUAL_INT(6, len);
+	TEST_ASSERT_EQUAL_UINT8(0x07, data[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x04, data[1]);
+	TEST_ASSERT_EQUAL_UINT8(0x12, data[2]);
+	TEST_ASSERT_EQUAL_UINT8(0x34, data[3]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, data[4]);
+	TEST_ASSERT_EQUAL_UINT8(0x01, data[5]);
+
+	framing.tx_advance(len);
+	TEST_ASSERT_FALSE(framing.tx_pending());
+}
+
+/**
+ * MBAP responses are complete when the length in the header has been
+ * received.
+ */
+void mbap_receive() {
+	uuid::modbus::MbapFraming framing;
+	const std::vector<uint8_t> response{ 0x12, 0x34, 0x00, 0x00, 0x00, 0x05,
+		0x07, 0x04, 0x02, 0x56, 0x78 };
+	uint16_t len;
+	uint16_t transaction;
+	size_t space;
+	size_t pos = 0;
+	uuid::modbus::FrameState state = uuid::modbus::FrameState::PARTIAL;
+
+	while (pos < response.size()) {
+		uint8_t *buffer = framing.rx_space(space);
+
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::FrameState::PARTIAL, state);
+		TEST_ASSERT_EQUAL_INT(pos < 6 ? 6 - pos : response.size() - pos, space);
+		std::copy(response.begin() + pos, response.begin() + pos + space, buffer);
+		state = framing.rx_advance(space);
+		pos += space;
+	}
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::FrameState::COMPLETE, state);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, framing.decode(len, transaction));
+	TEST_ASSERT_EQUAL_INT(5, len);
+	TEST_ASSERT_EQUAL_INT(0x1234, transaction);
+	TEST_ASSERT_EQUAL_UINT8(0x07, framing.rx_frame()[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x78, framing.rx_frame()[4]);
+}
+
+/**
+ * MBAP headers with an unknown protocol are invalid.
+ */
+void mbap_invalid() {
+	uuid::modbus::MbapFraming framing;
+	const std::vector<uint8_t> header{ 0x12, 0x34, 0x00, 0x01, 0x00, 0x05 };
+	size_t space;
+
+	std::copy(header.begin(), header.end(), framing.rx_space(space));
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::FrameState::INVALID, framing.rx_advance(header.size()));
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(rtu_encode);
+	RUN_TEST(rtu_receive);
+	RUN_TEST(rtu_invalid_crc);
+	RUN_TEST(mbap_encode);
+	RUN_TEST(mbap_receive);
+	RUN_TEST(mbap_invalid);
+
+	return UNITY_END();
+}
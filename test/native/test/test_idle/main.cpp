@@ -28,6 +28,10 @@ unsigned long millis() {
 	return fake_millis;
 }
 
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
 namespace uuid {
 
 uint64_t get_uptime_ms() {
@@ -216,12 +220,6 @@ void queue_request_before_message_at_idle() {
 	device.tx_.insert(device.tx_.end(), {
 		0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB2 });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -292,12 +290,6 @@ void queue_request_while_message_at_idle() {
 	device.tx_.insert(device.tx_.end(), {
 		0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB2 });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -28,6 +28,10 @@ unsigned long millis() {
 	return fake_millis;
 }
 
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
 namespace uuid {
 
 uint64_t get_uptime_ms() {
@@ -364,6 +368,52 @@ void invalid_crc() {
 	TEST_ASSERT_EQUAL_INT(0, resp->data().size());
 }
 
+/**
+ * A response with the wrong CRC received in multiple parts.
+ */
+void invalid_crc_in_parts() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+	TEST_ASSERT_TRUE(resp->pending());
+	TEST_ASSERT_FALSE(resp->done());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_TRUE(resp->pending());
+	TEST_ASSERT_FALSE(resp->done());
+
+	device.rx_.clear();
+	test_messages.clear();
+
+	for (uint8_t value : { 0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB3 }) {
+		device.tx_.push_back(value);
+
+		client.loop();
+		fake_millis += 1;
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+		TEST_ASSERT_TRUE(resp->pending());
+		TEST_ASSERT_FALSE(resp->done());
+	}
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CRC, resp->status());
+	TEST_ASSERT_FALSE(resp->pending());
+	TEST_ASSERT_TRUE(resp->done());
+	TEST_ASSERT_TRUE(resp->failed());
+	TEST_ASSERT_FALSE(resp->success());
+
+	TEST_ASSERT_EQUAL_INT(2, test_messages.size());
+	TEST_ASSERT_EQUAL_STRING("<- 07 04'02 56 78'0E B3", test_messages[0].c_str());
+	TEST_ASSERT_EQUAL_STRING("Received frame with invalid CRC B30E from device 7 with function 04, expected B20E",
+		test_messages[1].c_str());
+
+	TEST_ASSERT_EQUAL_INT(0, resp->data().size());
+}
+
 /**
  * A response from the wrong device.
  */
@@ -621,6 +671,7 @@ int main(int argc, char *argv[]) {
 	RUN_TEST(long_response_1000);
 
 	RUN_TEST(invalid_crc);
+	RUN_TEST(invalid_crc_in_parts);
 
 	RUN_TEST(wrong_device_address);
 	RUN_TEST(wrong_function_code);
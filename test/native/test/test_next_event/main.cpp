@@ -0,0 +1,150 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * There is no timing event while there are no requests.
+ */
+void next_event_idle() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.loop();
+	TEST_ASSERT_EQUAL_UINT32(uuid::modbus::SerialClient::WAIT_FOR_INPUT, client.next_event_us());
+
+	// Unexpected frame while idle
+	device.tx_.insert(device.tx_.end(), { 0x07, 0x04 });
+	client.loop();
+	TEST_ASSERT_EQUAL_UINT32(uuid::modbus::INTER_FRAME_TIMEOUT_MS * 1000, client.next_event_us());
+
+	fake_millis += 2;
+	TEST_ASSERT_EQUAL_UINT32((uuid::modbus::INTER_FRAME_TIMEOUT_MS - 2) * 1000, client.next_event_us());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	TEST_ASSERT_EQUAL_UINT32(0, client.next_event_us());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_UINT32(uuid::modbus::SerialClient::WAIT_FOR_INPUT, client.next_event_us());
+}
+
+/**
+ * The next timing event is the response timeout and then the inter-frame
+ * timeout while receiving the response.
+ */
+void next_event_response() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+
+	auto resp = client.read_input_registers(7, 0x1234, 1, 100);
+	TEST_ASSERT_EQUAL_UINT32(0, client.next_event_us());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	// The response timeout starts after the request has been transmitted
+	TEST_ASSERT_EQUAL_UINT32(100000 + 8 * client.character_time_us(), client.next_event_us());
+
+	fake_millis += 30;
+	TEST_ASSERT_EQUAL_UINT32(70000 + 8 * client.character_time_us(), client.next_event_us());
+
+	// Incomplete response
+	device.tx_.insert(device.tx_.end(), { 0x07, 0x04, 0x02 });
+	client.loop();
+	TEST_ASSERT_EQUAL_UINT32(uuid::modbus::INTER_FRAME_TIMEOUT_MS * 1000, client.next_event_us());
+
+	// Complete response
+	device.tx_.insert(device.tx_.end(), { 0x56, 0x78, 0x0E, 0xB2 });
+	fake_millis += 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+
+	// Inter-frame gap before the next request
+	TEST_ASSERT_EQUAL_UINT32(uuid::modbus::INTER_FRAME_TIMEOUT_MS * 1000, client.next_event_us());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	TEST_ASSERT_EQUAL_UINT32(0, client.next_event_us());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_UINT32(uuid::modbus::SerialClient::WAIT_FOR_INPUT, client.next_event_us());
+}
+
+/**
+ * The next timing event includes the expiry of queued requests.
+ */
+void next_event_expiry() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.queue_timeout_ms(50);
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+
+	auto resp1 = client.read_input_registers(7, 0x1234, 1, 100);
+	auto resp2 = client.read_input_registers(7, 0x1235, 1, 100);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	TEST_ASSERT_EQUAL_UINT32(50000, client.next_event_us());
+
+	fake_millis += 50;
+	TEST_ASSERT_EQUAL_UINT32(0, client.next_event_us());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_EXPIRED, resp2->status());
+	TEST_ASSERT_EQUAL_UINT32(50000 + 8 * client.character_time_us(), client.next_event_us());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(next_event_idle);
+	RUN_TEST(next_event_response);
+	RUN_TEST(next_event_expiry);
+
+	return UNITY_END();
+}
@@ -0,0 +1,158 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Responses are returned to the pool when the last handle is released.
+ */
+void pool_release() {
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponsePool::CAPACITY, uuid::modbus::ResponsePool::available());
+
+	{
+		ModbusDevice device;
+		uuid::modbus::SerialClient client{device};
+
+		auto resp = client.read_input_registers(7, 0x1234, 1);
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+		TEST_ASSERT_EQUAL_INT(2, resp.use_count());
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponsePool::CAPACITY - 1, uuid::modbus::ResponsePool::available());
+
+		auto copy = resp;
+		TEST_ASSERT_EQUAL_INT(3, resp.use_count());
+		TEST_ASSERT_TRUE(copy == resp);
+
+		auto moved = std::move(copy);
+		TEST_ASSERT_EQUAL_INT(3, resp.use_count());
+		TEST_ASSERT_FALSE(copy);
+		TEST_ASSERT_TRUE(moved == resp);
+
+		moved.reset();
+		resp.reset();
+		TEST_ASSERT_FALSE(resp);
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponsePool::CAPACITY - 1, uuid::modbus::ResponsePool::available());
+	}
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponsePool::CAPACITY, uuid::modbus::ResponsePool::available());
+}
+
+/**
+ * Requests fail when the pool is exhausted and succeed again when responses
+ * are released.
+ */
+void pool_exhausted() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	std::vector<uuid::modbus::ResponseHandle<const uuid::modbus::RegisterDataResponse>> resps;
+
+	for (size_t i = 0; i < uuid::modbus::ResponsePool::CAPACITY; i++) {
+		resps.push_back(client.read_input_registers(7, 0x1000 + i, 1));
+		TEST_ASSERT_TRUE(resps.back()->status() != uuid::modbus::ResponseStatus::FAILURE_POOL_EXHAUSTED);
+	}
+
+	TEST_ASSERT_EQUAL_INT(0, uuid::modbus::ResponsePool::available());
+
+	auto resp = client.read_holding_registers(7, 0x2000, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_POOL_EXHAUSTED, resp->status());
+	TEST_ASSERT_TRUE(resp->done());
+	TEST_ASSERT_TRUE(resp->failed());
+
+	auto resp2 = client.write_holding_register(7, 0x2000, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_POOL_EXHAUSTED, resp2->status());
+
+	auto resp3 = client.read_exception_status(7);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_POOL_EXHAUSTED, resp3->status());
+
+	/* Not queued, so it is released immediately */
+	resps.pop_back();
+	TEST_ASSERT_EQUAL_INT(1, uuid::modbus::ResponsePool::available());
+
+	auto resp4 = client.read_holding_registers(7, 0x3000, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_QUEUE_FULL, resp4->status());
+	TEST_ASSERT_EQUAL_INT(0, uuid::modbus::ResponsePool::available());
+}
+
+/**
+ * The response returned when the pool is exhausted is shared, is never
+ * returned to the pool and keeps its status.
+ */
+void pool_exhausted_shared() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	std::vector<uuid::modbus::ResponseHandle<const uuid::modbus::RegisterDataResponse>> resps;
+
+	for (size_t i = 0; i < uuid::modbus::ResponsePool::CAPACITY; i++) {
+		resps.push_back(client.read_input_registers(7, 0x1000 + i, 1));
+	}
+
+	auto resp1 = client.read_holding_registers(7, 0x2000, 1);
+	auto resp2 = client.read_holding_registers(8, 0x2000, 1);
+	TEST_ASSERT_TRUE(resp1 == resp2);
+	TEST_ASSERT_TRUE(resp1.get() == &uuid::modbus::ResponsePool::exhausted<uuid::modbus::RegisterDataResponse>());
+
+	auto resp3 = client.write_holding_register(7, 0x2000, 1);
+	TEST_ASSERT_TRUE(static_cast<const void*>(resp1.get()) != static_cast<const void*>(resp3.get()));
+
+	resp1.reset();
+	resp2.reset();
+	resp3.reset();
+	TEST_ASSERT_EQUAL_INT(0, uuid::modbus::ResponsePool::available());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_POOL_EXHAUSTED,
+		uuid::modbus::ResponsePool::exhausted<uuid::modbus::RegisterDataResponse>().status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_POOL_EXHAUSTED,
+		uuid::modbus::ResponsePool::exhausted<uuid::modbus::RegisterWriteResponse>().status());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(pool_release);
+	RUN_TEST(pool_exhausted);
+	RUN_TEST(pool_exhausted_shared);
+
+	return UNITY_END();
+}
@@ -0,0 +1,245 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+/**
+ * Time to transmit a request, after which the response timeout starts.
+ */
+static unsigned long transmit_ms(const uuid::modbus::SerialClient &client, size_t length) {
+	return (length * client.character_time_us() + 999) / 1000;
+}
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Requests are rejected when the queue is full.
+ */
+void queue_full() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	std::vector<uuid::modbus::ResponseHandle<const uuid::modbus::RegisterDataResponse>> resps;
+
+	for (size_t i = 0; i < uuid::modbus::RequestQueue::CAPACITY; i++) {
+		resps.push_back(client.read_input_registers(7, 0x1000 + i, 1));
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resps.back()->status());
+	}
+
+	auto resp = client.read_input_registers(7, 0x2000, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_QUEUE_FULL, resp->status());
+	TEST_ASSERT_FALSE(resp->pending());
+	TEST_ASSERT_TRUE(resp->done());
+	TEST_ASSERT_TRUE(resp->failed());
+
+	auto resp2 = client.write_holding_register(7, 0x2000, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_QUEUE_FULL, resp2->status());
+
+	auto resp3 = client.read_exception_status(7);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_QUEUE_FULL, resp3->status());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resps[0]->status());
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	device.rx_.clear();
+
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB2 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resps[0]->status());
+
+	resp = client.read_input_registers(7, 0x2000, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+}
+
+/**
+ * Requests are processed in the order that they were queued, including when
+ * the queue wraps around.
+ */
+void queue_order() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	for (uint16_t i = 0; i < uuid::modbus::RequestQueue::CAPACITY * 3; i++) {
+		auto resp = client.write_holding_register(0, i, i);
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+
+		fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+		client.loop();
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+		TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+		TEST_ASSERT_EQUAL_UINT8(i >> 8, device.rx_[2]);
+		TEST_ASSERT_EQUAL_UINT8(i & 0xFF, device.rx_[3]);
+		device.rx_.clear();
+
+		fake_millis += uuid::modbus::DEFAULT_BROADCAST_TIMEOUT_MS + transmit_ms(client, 8);
+		client.loop();
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	}
+}
+
+/**
+ * Process the broadcast write at the front of the queue and return the
+ * address that was written.
+ */
+static uint16_t process_write(ModbusDevice &device, uuid::modbus::SerialClient &client) {
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	uint16_t address = (device.rx_[2] << 8) | device.rx_[3];
+	device.rx_.clear();
+
+	fake_millis += uuid::modbus::DEFAULT_BROADCAST_TIMEOUT_MS + transmit_ms(client, 8);
+	client.loop();
+	return address;
+}
+
+/**
+ * Requests are processed in order of priority and then in the order that they
+ * were queued.
+ */
+void queue_priority() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.write_holding_register(0, 0, 0, 0, uuid::modbus::RequestPriority::BULK);
+	client.write_holding_register(0, 1, 0, 0, uuid::modbus::RequestPriority::BULK);
+	client.write_holding_register(0, 2, 0, 0, uuid::modbus::RequestPriority::BULK);
+	client.write_holding_register(0, 10, 0);
+	client.write_holding_register(0, 20, 0, 0, uuid::modbus::RequestPriority::CONTROL);
+	client.write_holding_register(0, 11, 0, 0, uuid::modbus::RequestPriority::INTERACTIVE);
+	client.write_holding_register(0, 21, 0, 0, uuid::modbus::RequestPriority::CONTROL);
+
+	TEST_ASSERT_EQUAL_INT(20, process_write(device, client));
+	TEST_ASSERT_EQUAL_INT(21, process_write(device, client));
+	TEST_ASSERT_EQUAL_INT(10, process_write(device, client));
+	TEST_ASSERT_EQUAL_INT(11, process_write(device, client));
+	TEST_ASSERT_EQUAL_INT(0, process_write(device, client));
+	TEST_ASSERT_EQUAL_INT(1, process_write(device, client));
+	TEST_ASSERT_EQUAL_INT(2, process_write(device, client));
+}
+
+/**
+ * Requests that are in progress are not overtaken.
+ */
+void queue_priority_in_progress() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	auto resp = client.write_holding_register(0, 0, 0, 0, uuid::modbus::RequestPriority::BULK);
+	client.write_holding_register(0, 1, 0, 0, uuid::modbus::RequestPriority::BULK);
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	device.rx_.clear();
+
+	client.write_holding_register(0, 20, 0, 0, uuid::modbus::RequestPriority::CONTROL);
+
+	fake_millis += uuid::modbus::DEFAULT_BROADCAST_TIMEOUT_MS + transmit_ms(client, 8);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+
+	TEST_ASSERT_EQUAL_INT(20, process_write(device, client));
+	TEST_ASSERT_EQUAL_INT(1, process_write(device, client));
+}
+
+/**
+ * Requests with a lower priority are not overtaken indefinitely.
+ */
+void queue_starvation() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.write_holding_register(0, 0, 0, 0, uuid::modbus::RequestPriority::BULK);
+	client.write_holding_register(0, 1, 0, 0, uuid::modbus::RequestPriority::BULK);
+
+	for (uint16_t i = 0; i < uuid::modbus::RequestQueue::CAPACITY - 2; i++) {
+		client.write_holding_register(0, 100 + i, 0, 0, uuid::modbus::RequestPriority::CONTROL);
+	}
+
+	for (uint16_t i = 0; i < uuid::modbus::RequestQueue::MAX_OVERTAKEN; i++) {
+		TEST_ASSERT_EQUAL_INT(100 + i, process_write(device, client));
+	}
+
+	TEST_ASSERT_EQUAL_INT(0, process_write(device, client));
+	TEST_ASSERT_EQUAL_INT(1, process_write(device, client));
+
+	for (uint16_t i = uuid::modbus::RequestQueue::MAX_OVERTAKEN; i < uuid::modbus::RequestQueue::CAPACITY - 2; i++) {
+		TEST_ASSERT_EQUAL_INT(100 + i, process_write(device, client));
+	}
+}
+
+/**
+ * Queued requests are destroyed with the client.
+ */
+void queue_destroyed() {
+	uuid::modbus::ResponseHandle<const uuid::modbus::RegisterDataResponse> resp;
+
+	{
+		ModbusDevice device;
+		uuid::modbus::SerialClient client{device};
+
+		resp = client.read_input_registers(7, 0x1234, 1);
+		TEST_ASSERT_EQUAL_INT(2, resp.use_count());
+	}
+
+	TEST_ASSERT_EQUAL_INT(1, resp.use_count());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(queue_full);
+	RUN_TEST(queue_order);
+	RUN_TEST(queue_priority);
+	RUN_TEST(queue_priority_in_progress);
+	RUN_TEST(queue_starvation);
+	RUN_TEST(queue_destroyed);
+
+	return UNITY_END();
+}
@@ -0,0 +1,281 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Check that the next request is a read of the expected registers and respond
+ * with the value of each register set to 0x1000 plus its address.
+ */
+static void serve(ModbusDevice &device, uint8_t function_code, uint16_t address, uint16_t size) {
+	const std::vector<uint8_t> request{device.rx_.begin(), device.rx_.end()};
+	std::vector<uint8_t> response{0x07, function_code, static_cast<uint8_t>(size * 2)};
+
+	TEST_ASSERT_EQUAL_INT(8, request.size());
+	TEST_ASSERT_EQUAL_UINT8(function_code, request[1]);
+	TEST_ASSERT_EQUAL_INT(address, (request[2] << 8) | request[3]);
+	TEST_ASSERT_EQUAL_INT(size, (request[4] << 8) | request[5]);
+	device.rx_.clear();
+
+	for (uint16_t i = 0; i < size; i++) {
+		uint16_t value = 0x1000 + address + i;
+
+		response.push_back(value >> 8);
+		response.push_back(value & 0xFF);
+	}
+
+	uint16_t crc = uuid::modbus::CRC16::calculate(response.data(), response.size());
+
+	response.push_back(crc & 0xFF);
+	response.push_back(crc >> 8);
+	device.tx_.insert(device.tx_.end(), response.begin(), response.end());
+}
+
+/**
+ * Nearby registers are merged and distant registers are read separately.
+ */
+void plan_merge() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 9600};
+	uuid::modbus::RegisterPoint points[] = {
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0020},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0012},
+		{7, uuid::modbus::FunctionCode::READ_HOLDING_REGISTERS, 0x0100},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0010},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0012},
+		{0, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0010},
+		{7, uuid::modbus::FunctionCode::WRITE_SINGLE_REGISTER, 0x0010},
+	};
+	uuid::modbus::RegisterReadPlan plan{points, 7};
+
+	/* 9 unused registers are quicker to read than another request */
+	TEST_ASSERT_EQUAL_INT(3, plan.plan(client));
+	TEST_ASSERT_EQUAL_INT(3, plan.blocks());
+	TEST_ASSERT_EQUAL_INT(3 * (13 * 1146 + 2 * 4011) + (3 + 1 + 1) * 2 * 1146, plan.cost_us());
+	TEST_ASSERT_FALSE(plan.done());
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::FunctionCode::READ_HOLDING_REGISTERS, points[0].function_code);
+	TEST_ASSERT_EQUAL_INT(0x0100, points[0].address);
+	TEST_ASSERT_EQUAL_INT(0x0010, points[1].address);
+	TEST_ASSERT_EQUAL_INT(0x0012, points[2].address);
+	TEST_ASSERT_EQUAL_INT(0x0012, points[3].address);
+	TEST_ASSERT_EQUAL_INT(0x0020, points[4].address);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, points[5].status);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, points[6].status);
+
+	plan.submit(client);
+
+	client.loop();
+	serve(device, 0x03, 0x0100, 1);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, points[0].status);
+	TEST_ASSERT_EQUAL_INT(0x1100, points[0].value);
+	TEST_ASSERT_EQUAL_INT(1, plan.completed());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	serve(device, 0x04, 0x0010, 3);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, points[1].status);
+	TEST_ASSERT_EQUAL_INT(0x1010, points[1].value);
+	TEST_ASSERT_EQUAL_INT(0x1012, points[2].value);
+	TEST_ASSERT_EQUAL_INT(0x1012, points[3].value);
+	TEST_ASSERT_FALSE(plan.done());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	serve(device, 0x04, 0x0020, 1);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(0x1020, points[4].value);
+	TEST_ASSERT_TRUE(plan.done());
+}
+
+/**
+ * Registers that are close together are read in one request when the cost
+ * of a gap is high.
+ */
+void plan_turnaround() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 9600};
+	uuid::modbus::RegisterPoint points[] = {
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0010},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0020},
+	};
+	uuid::modbus::RegisterReadPlan plan{points, 2};
+
+	TEST_ASSERT_EQUAL_INT(2, plan.plan(client));
+	TEST_ASSERT_EQUAL_INT(1, plan.plan(client, 20000));
+}
+
+/**
+ * Requests are limited to the maximum number of registers, split to
+ * minimise the total time (instead of filling the first request).
+ */
+void plan_max_registers() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 9600};
+	uuid::modbus::RegisterPoint points[] = {
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 5},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 120},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 124},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 125},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 126},
+	};
+	uuid::modbus::RegisterReadPlan plan{points, 6};
+
+	TEST_ASSERT_EQUAL_INT(2, plan.plan(client, 1000000));
+
+	plan.submit(client);
+
+	client.loop();
+	serve(device, 0x04, 0, 6);
+	client.loop();
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	serve(device, 0x04, 120, 7);
+}
+
+/**
+ * Every request is queued with the priority that the plan was submitted
+ * with.
+ */
+void plan_priority() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 9600};
+	uuid::modbus::RegisterPoint points[] = {
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0000},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0100},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0200},
+	};
+	uuid::modbus::RegisterReadPlan plan{points, 3};
+
+	TEST_ASSERT_EQUAL_INT(3, plan.plan(client));
+
+	plan.submit(client, 0, uuid::modbus::RequestPriority::BULK);
+
+	client.loop();
+	serve(device, 0x04, 0x0000, 1);
+	client.loop();
+
+	/* The remaining plan requests are overtaken */
+	auto resp = client.read_input_registers(7, 0x0300, 1);
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	serve(device, 0x04, 0x0300, 1);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(0x1300, resp->data()[0]);
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	serve(device, 0x04, 0x0100, 1);
+	client.loop();
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	serve(device, 0x04, 0x0200, 1);
+	client.loop();
+	TEST_ASSERT_TRUE(plan.done());
+	TEST_ASSERT_EQUAL_INT(0x1200, points[2].value);
+}
+
+/**
+ * Modbus ASCII requests are costed with two characters for every byte and
+ * no inter-frame gap.
+ */
+void plan_ascii() {
+	ModbusDevice device;
+	uuid::modbus::AsciiClient client{device, 9600};
+	uuid::modbus::RegisterPoint points[] = {
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0010},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0x0020},
+	};
+	uuid::modbus::RegisterReadPlan plan{points, 2};
+
+	TEST_ASSERT_EQUAL_INT(2 * 1146, client.byte_time_us());
+	TEST_ASSERT_EQUAL_INT(7 * 1146, client.frame_overhead_us());
+
+	/* 15 unused registers (60 characters) take longer than a request (28 characters) */
+	TEST_ASSERT_EQUAL_INT(2, plan.plan(client));
+	TEST_ASSERT_EQUAL_INT(2 * (28 + 4) * 1146, plan.cost_us());
+}
+
+/**
+ * When only the turnaround time is known, as few requests as possible are
+ * used.
+ */
+void plan_unknown_byte_time() {
+	uuid::modbus::RegisterPoint points[] = {
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 0},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 64},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 124},
+		{7, uuid::modbus::FunctionCode::READ_INPUT_REGISTERS, 125},
+		{7, uuid::modbus::FunctionCode::READ_HOLDING_REGISTERS, 0},
+	};
+	uuid::modbus::RegisterReadPlan plan{points, 5};
+
+	TEST_ASSERT_EQUAL_INT(3, plan.plan(0, 0));
+	TEST_ASSERT_EQUAL_INT(0, plan.cost_us());
+
+	TEST_ASSERT_EQUAL_INT(3, plan.plan(0, 0, 5000));
+	TEST_ASSERT_EQUAL_INT(3 * 5000, plan.cost_us());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(plan_merge);
+	RUN_TEST(plan_turnaround);
+	RUN_TEST(plan_max_registers);
+	RUN_TEST(plan_priority);
+	RUN_TEST(plan_ascii);
+	RUN_TEST(plan_unknown_byte_time);
+
+	return UNITY_END();
+}
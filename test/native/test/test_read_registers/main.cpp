@@ -27,6 +27,10 @@ unsigned long millis() {
 	return fake_millis;
 }
 
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
 namespace uuid {
 
 uint64_t get_uptime_ms() {
@@ -38,6 +42,13 @@ uint64_t get_uptime_ms() {
 
 std::vector<std::string> test_messages;
 
+/**
+ * Time to transmit a request, after which the response timeout starts.
+ */
+static unsigned long transmit_ms(const uuid::modbus::SerialClient &client, size_t length) {
+	return (length * client.character_time_us() + 999) / 1000;
+}
+
 void setUp() {
 	test_messages.clear();
 	fake_millis = 0;
@@ -87,12 +98,6 @@ void read_input_1() {
 	device.tx_.insert(device.tx_.end(), {
 		0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB2 });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -132,12 +137,6 @@ void read_input_2() {
 	device.tx_.insert(device.tx_.end(), {
 		0x07, 0x04, 0x04, 0xAB, 0xCD, 0xEF, 0x12, 0xE0, 0x62 });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -181,12 +180,6 @@ void read_input_125() {
 	}
 	device.tx_.insert(device.tx_.end(), {0x45, 0xA9});
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -214,6 +207,23 @@ void read_input_126() {
 	TEST_ASSERT_TRUE(resp->failed());
 }
 
+/**
+ * A response with more registers than can be stored is invalid.
+ */
+void read_holding_response_too_large() {
+	auto resp = uuid::modbus::ResponsePool::make<uuid::modbus::RegisterDataResponse>();
+	uuid::modbus::frame_buffer_t frame{};
+
+	frame[0] = 0x07;
+	frame[1] = 0x03;
+	frame[2] = (uuid::modbus::MAX_READ_REGISTERS + 1) * 2;
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_LENGTH,
+		resp->parse(frame, 3 + frame[2]));
+	TEST_ASSERT_EQUAL_STRING("Invalid message for function 03 from device 7, byte count 252 is too large",
+		test_messages.back().c_str());
+}
+
 /**
  * Try to read from the broadcast device address.
  */
@@ -408,12 +418,6 @@ void read_wrong_length_odd_number() {
 	device.tx_.insert(device.tx_.end(), {
 		0x07, 0x04, 0x05 /* should be 0x04 */, 0xAB, 0xCD, 0xEF, 0x12, 0x00, 0x62, 0x59 });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_LENGTH, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -453,12 +457,6 @@ void read_exception() {
 	device.tx_.insert(device.tx_.end(), {
 		0x07, 0x84, 0x04, 0xA2, 0xC2 });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::EXCEPTION, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -554,12 +552,6 @@ void read_receive_in_parts() {
 	auto stop_time = fake_millis;
 	TEST_ASSERT_GREATER_THAN(uuid::modbus::INTER_FRAME_TIMEOUT_MS, stop_time - start_time);
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -661,12 +653,6 @@ void read_receive_in_parts_with_errors() {
 	auto stop_time = fake_millis;
 	TEST_ASSERT_GREATER_THAN(uuid::modbus::INTER_FRAME_TIMEOUT_MS, stop_time - start_time);
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -717,12 +703,6 @@ void read_transmit_in_parts() {
 	device.tx_.insert(device.tx_.end(), {
 		0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB2 });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -733,6 +713,73 @@ void read_transmit_in_parts() {
 	TEST_ASSERT_EQUAL_INT(0x5678, resp->data()[0]);
 }
 
+/**
+ * Response is complete as soon as the expected length has been received but
+ * the next request waits for the inter-frame timeout.
+ */
+void read_complete_early() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	auto resp1 = client.read_input_registers(7, 0x1234, 1);
+	auto resp2 = client.read_input_registers(7, 0x5678, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB2 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(1, resp1->data().size());
+	TEST_ASSERT_EQUAL_INT(0x5678, resp1->data()[0]);
+
+	client.loop();
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS - 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(0, device.rx_.size());
+
+	fake_millis += 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp2->status());
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x07, device.rx_[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x04, device.rx_[1]);
+	TEST_ASSERT_EQUAL_UINT8(0x56, device.rx_[2]);
+	TEST_ASSERT_EQUAL_UINT8(0x78, device.rx_[3]);
+}
+
+/**
+ * Response with more data than its header indicates is only complete after the
+ * inter-frame timeout.
+ */
+void read_complete_early_extra_data() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x04, 0x02, 0x56, 0x78, 0x9A, 0xBC, 0x0E, 0xB2 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CRC, resp->status());
+}
+
 /**
  * No response at all to a read input request should result in a timeout.
  */
@@ -756,7 +803,7 @@ void read_input_no_response() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(10000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(10000 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -787,7 +834,7 @@ void read_input_no_response_explicit_timeout() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(8000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(8000 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -820,7 +867,7 @@ void read_input_no_response_implicit_default_timeout() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(8000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(8000 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -853,7 +900,7 @@ void read_input_no_response_explicit_default_timeout() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(8000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(8000 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -905,12 +952,6 @@ void read_holding_1() {
 	device.tx_.insert(device.tx_.end(), {
 		0x07, 0x03, 0x02, 0x56, 0x78, 0x0F, 0xC6 });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -950,12 +991,6 @@ void read_holding_2() {
 	device.tx_.insert(device.tx_.end(), {
 		0x07, 0x03, 0x04, 0xAB, 0xCD, 0xEF, 0x12, 0xE1, 0xD5 });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -999,12 +1034,6 @@ void read_holding_125() {
 	}
 	device.tx_.insert(device.tx_.end(), {0xBD, 0xE2});
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -1085,7 +1114,7 @@ void read_holding_no_response() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(10000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(10000 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -1116,7 +1145,7 @@ void read_holding_no_response_explicit_timeout() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(8000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(8000 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -1149,7 +1178,7 @@ void read_holding_no_response_implicit_default_timeout() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(8000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(8000 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -1182,7 +1211,7 @@ void read_holding_no_response_explicit_default_timeout() {
 		TEST_ASSERT_LESS_THAN(15000, fake_millis);
 	}
 
-	TEST_ASSERT_EQUAL_INT(8000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(8000 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -1211,6 +1240,8 @@ int main(int argc, char *argv[]) {
 	RUN_TEST(read_receive_in_parts);
 	RUN_TEST(read_receive_in_parts_with_errors);
 	RUN_TEST(read_transmit_in_parts);
+	RUN_TEST(read_complete_early);
+	RUN_TEST(read_complete_early_extra_data);
 
 	RUN_TEST(read_input_no_response);
 	RUN_TEST(read_input_no_response_explicit_timeout);
@@ -1222,6 +1253,7 @@ int main(int argc, char *argv[]) {
 	RUN_TEST(read_holding_2);
 	RUN_TEST(read_holding_125);
 	RUN_TEST(read_holding_126);
+	RUN_TEST(read_holding_response_too_large);
 
 	RUN_TEST(read_holding_broadcast);
 	RUN_TEST(read_holding_reserved_device);
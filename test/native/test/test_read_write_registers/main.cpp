@@ -0,0 +1,150 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Write 1 holding register and read 2 holding registers.
+ */
+void read_write_holding() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	const uint16_t values[] = { 0xABCD };
+
+	auto resp = client.read_write_holding_registers(7, 0x0010, 2, 0x1234, values, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+	TEST_ASSERT_TRUE(resp->pending());
+	TEST_ASSERT_FALSE(resp->done());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_TRUE(resp->pending());
+	TEST_ASSERT_FALSE(resp->done());
+
+	TEST_ASSERT_EQUAL_INT(15, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x07, device.rx_[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x17, device.rx_[1]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[2]);
+	TEST_ASSERT_EQUAL_UINT8(0x10, device.rx_[3]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[4]);
+	TEST_ASSERT_EQUAL_UINT8(0x02, device.rx_[5]);
+	TEST_ASSERT_EQUAL_UINT8(0x12, device.rx_[6]);
+	TEST_ASSERT_EQUAL_UINT8(0x34, device.rx_[7]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[8]);
+	TEST_ASSERT_EQUAL_UINT8(0x01, device.rx_[9]);
+	TEST_ASSERT_EQUAL_UINT8(0x02, device.rx_[10]);
+	TEST_ASSERT_EQUAL_UINT8(0xAB, device.rx_[11]);
+	TEST_ASSERT_EQUAL_UINT8(0xCD, device.rx_[12]);
+	TEST_ASSERT_EQUAL_UINT8(0x94, device.rx_[13]);
+	TEST_ASSERT_EQUAL_UINT8(0x38, device.rx_[14]);
+
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x17, 0x04, 0x11, 0x22, 0x33, 0x44, 0x2E, 0xD2 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_FALSE(resp->pending());
+	TEST_ASSERT_TRUE(resp->done());
+	TEST_ASSERT_TRUE(resp->success());
+
+	TEST_ASSERT_EQUAL_INT(2, resp->data().size());
+	TEST_ASSERT_EQUAL_INT(0x1122, resp->data()[0]);
+	TEST_ASSERT_EQUAL_INT(0x3344, resp->data()[1]);
+}
+
+/**
+ * Invalid sizes are rejected.
+ */
+void read_write_holding_invalid_size() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uint16_t values[uuid::modbus::MAX_READ_WRITE_REGISTERS + 1] = { 0 };
+
+	auto resp = client.read_write_holding_registers(7, 0x0010, 0, 0x1234, values, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.read_write_holding_registers(7, 0x0010, uuid::modbus::MAX_READ_REGISTERS + 1, 0x1234, values, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.read_write_holding_registers(7, 0x0010, 1, 0x1234, values, 0);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.read_write_holding_registers(7, 0x0010, 1, 0x1234, values, uuid::modbus::MAX_READ_WRITE_REGISTERS + 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.read_write_holding_registers(7, 0x0010, uuid::modbus::MAX_READ_REGISTERS, 0x1234, values, uuid::modbus::MAX_READ_WRITE_REGISTERS);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_INT(13 + 2 * uuid::modbus::MAX_READ_WRITE_REGISTERS, device.rx_.size());
+}
+
+/**
+ * Requests to the broadcast device are rejected.
+ */
+void read_write_holding_broadcast_device() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	const uint16_t values[] = { 0xABCD };
+
+	auto resp = client.read_write_holding_registers(0, 0x0010, 2, 0x1234, values, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+	TEST_ASSERT_TRUE(resp->done());
+	TEST_ASSERT_TRUE(resp->failed());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(read_write_holding);
+	RUN_TEST(read_write_holding_invalid_size);
+	RUN_TEST(read_write_holding_broadcast_device);
+
+	return UNITY_END();
+}
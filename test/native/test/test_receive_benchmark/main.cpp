@@ -0,0 +1,282 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+static unsigned long fake_millis = 0;
+static unsigned long micros_calls = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	micros_calls++;
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+static constexpr unsigned int ITERATIONS = 2000;
+static constexpr uint16_t REGISTERS = 125;
+static volatile uint16_t sink;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+	micros_calls = 0;
+}
+
+/**
+ * Response to a read of the maximum number of input registers.
+ */
+static std::vector<uint8_t> test_frame() {
+	std::vector<uint8_t> frame{0x01, 0x04, REGISTERS * 2};
+	uint32_t seed = 0x12345678;
+
+	for (uint16_t i = 0; i < REGISTERS * 2; i++) {
+		seed = seed * 1103515245 + 12345;
+		frame.push_back(seed >> 24);
+	}
+
+	uint16_t crc = uuid::modbus::CRC16::calculate(frame.data(), frame.size());
+
+	frame.push_back(crc & 0xFF);
+	frame.push_back(crc >> 8);
+	return frame;
+}
+
+/**
+ * Byte-by-byte implementation used before bulk reads.
+ */
+static uint16_t bytewise_input(ModbusDevice &device, uuid::modbus::frame_buffer_t &frame) {
+	uuid::modbus::CRC16 crc;
+	uint16_t frame_pos = 0;
+	int data = 0;
+
+	do {
+		int available = device.available();
+
+		if (available <= 0) {
+			break;
+		}
+
+		while (available-- > 0) {
+			data = device.read();
+
+			if (data == -1) {
+				break;
+			}
+
+			if (frame_pos < frame.size()) {
+				if (frame_pos >= uuid::modbus::MESSAGE_CRC_SIZE) {
+					crc.update(frame[frame_pos - uuid::modbus::MESSAGE_CRC_SIZE]);
+				}
+
+				frame[frame_pos++] = data;
+			}
+
+			sink = ::micros();
+		}
+	} while (data != -1);
+
+	sink = crc.value();
+	return frame_pos;
+}
+
+/**
+ * Bulk implementation used by FramedClient::input() (without completing the
+ * frame).
+ */
+static uint16_t bulk_input(uuid::modbus::SerialStream &stream, uuid::modbus::RtuFraming &framing) {
+	const uint32_t now_us = ::micros();
+
+	while (true) {
+		int available = stream.available();
+
+		if (available <= 0) {
+			break;
+		}
+
+		size_t space;
+		uint8_t *buffer = framing.rx_space(space);
+
+		if (space == 0) {
+			while (available-- > 0 && stream.read() != -1);
+			continue;
+		}
+
+		size_t len = stream.read(buffer, std::min(static_cast<size_t>(available), space));
+
+		if (len == 0) {
+			break;
+		}
+
+		framing.rx_advance(len);
+	}
+
+	sink = now_us;
+	return framing.rx_size();
+}
+
+/**
+ * A response received in one burst is parsed correctly.
+ */
+void receive_burst() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	auto frame = test_frame();
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+
+	auto resp = client.read_input_registers(1, 0x0000, REGISTERS);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	device.tx_.insert(device.tx_.end(), frame.begin(), frame.end());
+	micros_calls = 0;
+	client.loop();
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(REGISTERS, resp->data().size());
+	TEST_ASSERT_EQUAL_INT((frame[3] << 8) | frame[4], resp->data()[0]);
+	TEST_ASSERT_EQUAL_INT((frame[251] << 8) | frame[252], resp->data()[REGISTERS - 1]);
+	TEST_ASSERT_LESS_THAN(4, micros_calls);
+}
+
+/**
+ * A response received in several bursts is parsed correctly.
+ */
+void receive_split() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	auto frame = test_frame();
+
+	for (size_t split : {1, 2, 3, 100, 253, 254}) {
+		fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+
+		auto resp = client.read_input_registers(1, 0x0000, REGISTERS);
+
+		client.loop();
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+		device.tx_.insert(device.tx_.end(), frame.begin(), frame.begin() + split);
+		client.loop();
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+		device.tx_.insert(device.tx_.end(), frame.begin() + split, frame.end());
+		client.loop();
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+		TEST_ASSERT_EQUAL_INT(REGISTERS, resp->data().size());
+	}
+}
+
+/**
+ * Data that doesn't fit in the frame buffer is discarded.
+ */
+void receive_oversized() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+
+	auto resp = client.read_input_registers(1, 0x0000, REGISTERS);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	device.tx_.insert(device.tx_.end(), uuid::modbus::MAX_MESSAGE_SIZE + 10, 0x01);
+	client.loop();
+	TEST_ASSERT_TRUE(device.tx_.empty());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TOO_LONG, resp->status());
+}
+
+/**
+ * Compare the time taken to receive a frame (and calculate its CRC) with the
+ * byte-by-byte implementation and with the bulk implementation.
+ */
+void benchmark() {
+	ModbusDevice device;
+	uuid::modbus::SerialStream stream{device};
+	uuid::modbus::RtuFraming framing;
+	uuid::modbus::frame_buffer_t buffer;
+	auto frame = test_frame();
+	std::chrono::steady_clock::duration bytewise{};
+	std::chrono::steady_clock::duration bulk{};
+	unsigned long bytewise_micros = 0;
+	unsigned long bulk_micros = 0;
+	char message[160];
+
+	for (unsigned int i = 0; i < ITERATIONS; i++) {
+		device.tx_.insert(device.tx_.end(), frame.begin(), frame.end());
+		micros_calls = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		TEST_ASSERT_EQUAL_INT(frame.size(), bytewise_input(device, buffer));
+		bytewise += std::chrono::steady_clock::now() - start;
+		bytewise_micros += micros_calls;
+
+		device.tx_.insert(device.tx_.end(), frame.begin(), frame.end());
+		framing.rx_reset();
+		micros_calls = 0;
+
+		start = std::chrono::steady_clock::now();
+		TEST_ASSERT_EQUAL_INT(frame.size(), bulk_input(stream, framing));
+		bulk += std::chrono::steady_clock::now() - start;
+		bulk_micros += micros_calls;
+	}
+
+	snprintf(message, sizeof(message),
+		"Receive %u byte frame: bytewise %.1fns/byte (%.1f timer reads), bulk %.1fns/byte (%.1f timer reads)",
+		(unsigned int)frame.size(),
+		std::chrono::duration<double, std::nano>(bytewise).count() / ITERATIONS / frame.size(),
+		(double)bytewise_micros / ITERATIONS,
+		std::chrono::duration<double, std::nano>(bulk).count() / ITERATIONS / frame.size(),
+		(double)bulk_micros / ITERATIONS);
+	TEST_MESSAGE(message);
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+	RUN_TEST(receive_burst);
+	RUN_TEST(receive_split);
+	RUN_TEST(receive_oversized);
+	RUN_TEST(benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,269 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+/**
+ * Time to transmit a request, after which the response timeout starts.
+ */
+static unsigned long transmit_ms(const uuid::modbus::SerialClient &client, size_t length) {
+	return (length * client.character_time_us() + 999) / 1000;
+}
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+static void respond(ModbusDevice &device, uint8_t function_code, uint16_t start, uint16_t size) {
+	std::vector<uint8_t> frame{0x07, function_code, static_cast<uint8_t>(size * 2)};
+
+	for (uint16_t i = 0; i < size; i++) {
+		uint16_t value = start + i;
+
+		frame.push_back(value >> 8);
+		frame.push_back(value & 0xFF);
+	}
+
+	uint16_t crc = uuid::modbus::CRC16::calculate(frame.data(), frame.size());
+
+	frame.push_back(crc & 0xFF);
+	frame.push_back(crc >> 8);
+	device.tx_.insert(device.tx_.end(), frame.begin(), frame.end());
+}
+
+static void check_request(ModbusDevice &device, uint8_t function_code, uint16_t address, uint16_t size) {
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x07, device.rx_[0]);
+	TEST_ASSERT_EQUAL_UINT8(function_code, device.rx_[1]);
+	TEST_ASSERT_EQUAL_UINT8(address >> 8, device.rx_[2]);
+	TEST_ASSERT_EQUAL_UINT8(address & 0xFF, device.rx_[3]);
+	TEST_ASSERT_EQUAL_UINT8(size >> 8, device.rx_[4]);
+	TEST_ASSERT_EQUAL_UINT8(size & 0xFF, device.rx_[5]);
+	device.rx_.clear();
+}
+
+/**
+ * Read 300 input registers in 3 requests.
+ */
+void read_input_block() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	std::vector<uint16_t> values(300);
+	unsigned int calls = 0;
+
+	auto resp = client.read_input_register_block(7, 0x1000, values.data(), values.size(),
+		[&calls] (const uuid::modbus::RegisterBlockResponse &response) {
+			calls++;
+		});
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+	TEST_ASSERT_EQUAL_INT(3, resp->chunks());
+	TEST_ASSERT_EQUAL_INT(300, resp->size());
+
+	client.loop();
+	check_request(device, 0x04, 0x1000, 125);
+	respond(device, 0x04, 0x1000, 125);
+	client.loop();
+	TEST_ASSERT_TRUE(resp->pending());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	check_request(device, 0x04, 0x1000 + 125, 125);
+	respond(device, 0x04, 0x1000 + 125, 125);
+	client.loop();
+	TEST_ASSERT_TRUE(resp->pending());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	check_request(device, 0x04, 0x1000 + 250, 50);
+	respond(device, 0x04, 0x1000 + 250, 50);
+	TEST_ASSERT_EQUAL_INT(0, calls);
+	client.loop();
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(1, calls);
+	TEST_ASSERT_EQUAL_INT(0, resp->failed_chunks());
+	TEST_ASSERT_EQUAL_INT(1, resp.use_count());
+
+	for (uint16_t i = 0; i < values.size(); i++) {
+		TEST_ASSERT_EQUAL_INT(0x1000 + i, values[i]);
+	}
+}
+
+/**
+ * Read a block of holding registers where one request fails.
+ */
+void read_holding_block_chunk_failed() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	std::vector<uint16_t> values(260);
+
+	auto resp = client.read_holding_register_block(7, 0x0000, values.data(), values.size(), 100);
+	TEST_ASSERT_EQUAL_INT(3, resp->chunks());
+
+	client.loop();
+	check_request(device, 0x03, 0, 125);
+	respond(device, 0x03, 0, 125);
+	client.loop();
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	check_request(device, 0x03, 125, 125);
+	fake_millis += 100 + transmit_ms(client, 8);
+	client.loop();
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	check_request(device, 0x03, 250, 10);
+	respond(device, 0x03, 250, 10);
+	client.loop();
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
+	TEST_ASSERT_EQUAL_INT(1, resp->failed_chunks());
+	TEST_ASSERT_FALSE(resp->chunk_failed(0));
+	TEST_ASSERT_TRUE(resp->chunk_failed(1));
+	TEST_ASSERT_FALSE(resp->chunk_failed(2));
+	TEST_ASSERT_EQUAL_INT(124, values[124]);
+	TEST_ASSERT_EQUAL_INT(250, values[250]);
+	TEST_ASSERT_EQUAL_INT(259, values[259]);
+}
+
+/**
+ * The response is released when the block read completes, even if the
+ * caller no longer has a reference to it.
+ */
+void read_block_released() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uint16_t values[10];
+	size_t available = uuid::modbus::ResponsePool::available();
+
+	client.read_input_register_block(7, 0x0000, values, 10);
+	TEST_ASSERT_EQUAL_INT(available - 2, uuid::modbus::ResponsePool::available());
+
+	client.loop();
+	check_request(device, 0x04, 0, 10);
+	respond(device, 0x04, 0x1234, 10);
+	client.loop();
+
+	TEST_ASSERT_EQUAL_INT(available, uuid::modbus::ResponsePool::available());
+	TEST_ASSERT_EQUAL_INT(0x1234, values[0]);
+	TEST_ASSERT_EQUAL_INT(0x123D, values[9]);
+}
+
+/**
+ * Block reads with an invalid size are rejected.
+ */
+void read_block_invalid_size() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uint16_t values[1];
+
+	auto resp = client.read_input_register_block(7, 0x0000, values, 0);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.read_input_register_block(7, 0x0001, values, 0x10000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.read_input_register_block(7, 0x0000, nullptr, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.read_input_register_block(0, 0x0000, values, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.read_input_register_block(7, 0xFFFF, values, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+	TEST_ASSERT_EQUAL_INT(1, resp->chunks());
+}
+
+/**
+ * Every request is queued with the priority that the block read was started
+ * with.
+ */
+void read_block_priority() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	std::vector<uint16_t> values(300);
+
+	auto resp = client.read_input_register_block(7, 0x1000, values.data(),
+		values.size(), 0, uuid::modbus::RequestPriority::BULK);
+
+	client.loop();
+	check_request(device, 0x04, 0x1000, 125);
+	respond(device, 0x04, 0x1000, 125);
+	client.loop();
+
+	/* The remaining block read requests are overtaken */
+	auto resp2 = client.read_input_registers(7, 0x2000, 1);
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	check_request(device, 0x04, 0x2000, 1);
+	respond(device, 0x04, 0x2000, 1);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp2->status());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	check_request(device, 0x04, 0x1000 + 125, 125);
+	respond(device, 0x04, 0x1000 + 125, 125);
+	client.loop();
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	check_request(device, 0x04, 0x1000 + 250, 50);
+	respond(device, 0x04, 0x1000 + 250, 50);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(read_input_block);
+	RUN_TEST(read_holding_block_chunk_failed);
+	RUN_TEST(read_block_released);
+	RUN_TEST(read_block_invalid_size);
+	RUN_TEST(read_block_priority);
+
+	return UNITY_END();
+}
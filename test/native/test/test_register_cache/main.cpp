@@ -0,0 +1,222 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Complete a read of holding registers 0x0010 to 0x0014 from device 7.
+ */
+static void respond(ModbusDevice &device, uuid::modbus::SerialClient &client) {
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	device.rx_.clear();
+
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x03, 0x0A, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04,
+		0x00, 0x05, 0xC6, 0xE2 });
+	client.loop();
+}
+
+/**
+ * Reads that are contained in a previous read complete immediately until the
+ * values expire.
+ */
+void cache_hit() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uuid::modbus::RegisterCacheEntry entries[32];
+	uuid::modbus::RegisterCache cache{client, entries, 32};
+	unsigned int calls = 0;
+
+	auto resp1 = cache.read_holding_registers(7, 0x0010, 5, 1000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp1->status());
+	TEST_ASSERT_EQUAL_INT(0, cache.hits());
+	TEST_ASSERT_EQUAL_INT(1, cache.misses());
+
+	respond(device, client);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+
+	fake_millis += 999;
+	auto resp2 = cache.read_holding_registers(7, 0x0011, 2, 1000,
+		[&calls] (const uuid::modbus::RegisterDataResponse &response) {
+			calls++;
+		});
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp2->status());
+	TEST_ASSERT_EQUAL_INT(1, calls);
+	TEST_ASSERT_EQUAL_INT(2, resp2->data().size());
+	TEST_ASSERT_EQUAL_UINT16(0x0002, resp2->data()[0]);
+	TEST_ASSERT_EQUAL_UINT16(0x0003, resp2->data()[1]);
+	TEST_ASSERT_EQUAL_INT(1, cache.hits());
+	TEST_ASSERT_EQUAL_INT(1, cache.misses());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(0, device.rx_.size());
+
+	auto resp3 = cache.read_input_registers(7, 0x0010, 1, 1000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp3->status());
+	TEST_ASSERT_EQUAL_INT(2, cache.misses());
+
+	auto resp4 = cache.read_holding_registers(7, 0x0014, 2, 1000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp4->status());
+	TEST_ASSERT_EQUAL_INT(3, cache.misses());
+
+	fake_millis += 1;
+	auto resp5 = cache.read_holding_registers(7, 0x0011, 2, 1000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp5->status());
+	TEST_ASSERT_EQUAL_INT(1, cache.hits());
+	TEST_ASSERT_EQUAL_INT(4, cache.misses());
+}
+
+/**
+ * Failed reads are not cached and the callback is still called.
+ */
+void cache_failure() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uuid::modbus::RegisterCacheEntry entries[32];
+	uuid::modbus::RegisterCache cache{client, entries, 32};
+	uuid::modbus::ResponseStatus status = uuid::modbus::ResponseStatus::QUEUED;
+
+	auto resp1 = cache.read_holding_registers(7, 0x0010, 5, 1000,
+		[&status] (const uuid::modbus::RegisterDataResponse &response) {
+			status = response.status();
+		});
+	client.loop();
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), { 0x07, 0x83, 0x02, 0x20, 0xF0 });
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::EXCEPTION, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::EXCEPTION, status);
+
+	auto resp2 = cache.read_holding_registers(7, 0x0010, 1, 1000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(0, cache.hits());
+	TEST_ASSERT_EQUAL_INT(2, cache.misses());
+}
+
+/**
+ * Invalidated values are read again.
+ */
+void cache_invalidate() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uuid::modbus::RegisterCacheEntry entries[32];
+	uuid::modbus::RegisterCache cache{client, entries, 32};
+
+	auto resp1 = cache.read_holding_registers(7, 0x0010, 5, 1000);
+	respond(device, client);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+
+	cache.invalidate(7, uuid::modbus::FunctionCode::READ_HOLDING_REGISTERS, 0x0012, 1);
+
+	auto resp2 = cache.read_holding_registers(7, 0x0010, 2, 1000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp2->status());
+
+	auto resp3 = cache.read_holding_registers(7, 0x0011, 2, 1000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp3->status());
+	resp3.reset();
+
+	cache.clear();
+
+	auto resp4 = cache.read_holding_registers(7, 0x0010, 1, 1000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp4->status());
+	TEST_ASSERT_EQUAL_INT(1, cache.hits());
+	TEST_ASSERT_EQUAL_INT(3, cache.misses());
+}
+
+/**
+ * Values are replaced when the table is full and reads still complete.
+ */
+void cache_full() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uuid::modbus::RegisterCacheEntry entries[2];
+	uuid::modbus::RegisterCache cache{client, entries, 2};
+
+	auto resp1 = cache.read_holding_registers(7, 0x0010, 5, 1000);
+	respond(device, client);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+	TEST_ASSERT_EQUAL_INT(5, resp1->data().size());
+
+	auto resp2 = cache.read_holding_registers(7, 0x0010, 5, 1000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(0, cache.hits());
+}
+
+/**
+ * Invalid reads are rejected.
+ */
+void cache_invalid() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uuid::modbus::RegisterCacheEntry entries[32];
+	uuid::modbus::RegisterCache cache{client, entries, 32};
+
+	auto resp1 = cache.read_holding_registers(0, 0x0010, 1, 1000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp1->status());
+
+	auto resp2 = cache.read_input_registers(7, 0x0010, 0, 1000);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp2->status());
+
+	auto resp3 = cache.read_input_registers(7, 0x0010, 1, uuid::modbus::RegisterCache::MAX_TTL_MS + 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp3->status());
+
+	TEST_ASSERT_EQUAL_INT(0, cache.hits());
+	TEST_ASSERT_EQUAL_INT(0, cache.misses());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(cache_hit);
+	RUN_TEST(cache_failure);
+	RUN_TEST(cache_invalidate);
+	RUN_TEST(cache_full);
+	RUN_TEST(cache_invalid);
+
+	return UNITY_END();
+}
@@ -0,0 +1,319 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <Client.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+#include <deque>
+#include <vector>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Serial device server stub that records the RTU frames written by the
+ * client and replays RTU frames to it, without preserving any timing.
+ */
+class SerialDeviceServer: public ::Client {
+public:
+	int connect(const char *host, uint16_t port) override {
+		connected_ = true;
+		return 1;
+	}
+
+	size_t write(uint8_t c) override {
+		return write(&c, 1);
+	}
+
+	size_t write(const uint8_t *buffer, size_t size) override {
+		if (!connected_) {
+			return 0;
+		}
+
+		rx_.insert(rx_.end(), buffer, buffer + size);
+		return size;
+	}
+
+	int available() override {
+		return tx_.size();
+	}
+
+	int read() override {
+		if (tx_.empty()) {
+			return -1;
+		}
+
+		int value = tx_.front();
+		tx_.pop_front();
+		return value;
+	}
+
+	int read(uint8_t *buffer, size_t size) override {
+		size = std::min(size, tx_.size());
+		std::copy(tx_.begin(), tx_.begin() + size, buffer);
+		tx_.erase(tx_.begin(), tx_.begin() + size);
+		return size;
+	}
+
+	int peek() override {
+		return tx_.empty() ? -1 : tx_.front();
+	}
+
+	void flush() override {
+	}
+
+	void stop() override {
+		connected_ = false;
+		rx_.clear();
+		tx_.clear();
+	}
+
+	uint8_t connected() override {
+		return connected_;
+	}
+
+	operator bool() override {
+		return connected_;
+	}
+
+	/**
+	 * Replay an RTU frame (appending the CRC).
+	 */
+	void replay(std::vector<uint8_t> frame, size_t begin = 0, size_t end = SIZE_MAX) {
+		uint16_t crc = uuid::modbus::CRC16::calculate(frame.data(), frame.size());
+
+		frame.push_back(crc & 0xFF);
+		frame.push_back(crc >> 8);
+
+		end = std::min(end, frame.size());
+		tx_.insert(tx_.end(), frame.begin() + begin, frame.begin() + end);
+	}
+
+	bool connected_ = true;
+	std::vector<uint8_t> rx_;
+	std::deque<uint8_t> tx_;
+};
+
+/**
+ * Requests are sent with a CRC and the response completes as soon as it has
+ * the expected length, so the next request is sent without waiting for an
+ * inter-frame timeout.
+ */
+void rtu_tcp_read() {
+	SerialDeviceServer server;
+	uuid::modbus::RtuTcpClient client{server};
+
+	auto resp1 = client.read_input_registers(7, 0x1234, 1);
+	auto resp2 = client.read_input_registers(7, 0x1235, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+
+	const std::vector<uint8_t> expected{0x07, 0x04, 0x12, 0x34, 0x00, 0x01, 0x75, 0x1A};
+	TEST_ASSERT_EQUAL_INT(expected.size(), server.rx_.size());
+	TEST_ASSERT_TRUE(expected == server.rx_);
+	server.rx_.clear();
+
+	server.replay({0x07, 0x04, 0x02, 0x56, 0x78});
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+	TEST_ASSERT_EQUAL_INT(0x5678, resp1->data()[0]);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+	TEST_ASSERT_EQUAL_UINT32(0, client.next_event_us());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp2->status());
+	TEST_ASSERT_EQUAL_INT(8, server.rx_.size());
+}
+
+/**
+ * The end of the response is identified from its length regardless of the
+ * time between the parts of it that are received.
+ */
+void rtu_tcp_split() {
+	SerialDeviceServer server;
+	uuid::modbus::RtuTcpClient client{server};
+
+	auto resp = client.read_input_registers(7, 0x1234, 2, 1000);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	const std::vector<uint8_t> frame{0x07, 0x04, 0x04, 0x12, 0x34, 0x12, 0x35};
+
+	server.replay(frame, 0, 3);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	fake_millis += 100;
+	server.replay(frame, 3, 8);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	fake_millis += 100;
+	server.replay(frame, 8);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(2, resp->data().size());
+	TEST_ASSERT_EQUAL_INT(0x1234, resp->data()[0]);
+	TEST_ASSERT_EQUAL_INT(0x1235, resp->data()[1]);
+}
+
+/**
+ * Exception responses are identified from their length.
+ */
+void rtu_tcp_exception() {
+	SerialDeviceServer server;
+	uuid::modbus::RtuTcpClient client{server};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	server.replay({0x07, 0x84, 0x02});
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::EXCEPTION, resp->status());
+	TEST_ASSERT_EQUAL_INT(2, resp->exception_code());
+}
+
+/**
+ * A response that doesn't have a valid CRC at the expected length can't be
+ * identified until the timeout expires.
+ */
+void rtu_tcp_invalid_crc() {
+	SerialDeviceServer server;
+	uuid::modbus::RtuTcpClient client{server};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1, 100);
+
+	client.loop();
+	server.tx_.insert(server.tx_.end(), {0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB3});
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	fake_millis += 100;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CRC, resp->status());
+}
+
+/**
+ * An incomplete response fails when the timeout expires.
+ */
+void rtu_tcp_incomplete() {
+	SerialDeviceServer server;
+	uuid::modbus::RtuTcpClient client{server};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1, 100);
+
+	client.loop();
+	server.replay({0x07, 0x04, 0x02, 0x56, 0x78}, 0, 4);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_UINT32(100000, client.next_event_us());
+
+	fake_millis += 100;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_CRC, resp->status());
+}
+
+/**
+ * Data received while idle is discarded before the next request is sent.
+ */
+void rtu_tcp_idle() {
+	SerialDeviceServer server;
+	uuid::modbus::RtuTcpClient client{server};
+
+	server.replay({0x07, 0x04, 0x02, 0x12, 0x34});
+	client.loop();
+
+	auto resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_INT(3, test_messages.size());
+	TEST_ASSERT_EQUAL_STRING("<- 07 04'02 12 34'3C 47", test_messages[0].c_str());
+	TEST_ASSERT_EQUAL_STRING("Received unexpected frame while idle from device 7",
+		test_messages[1].c_str());
+
+	server.replay({0x07, 0x04, 0x02, 0x56, 0x78});
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(0x5678, resp->data()[0]);
+}
+
+/**
+ * Outstanding requests fail when the connection is closed.
+ */
+void rtu_tcp_disconnect() {
+	SerialDeviceServer server;
+	uuid::modbus::RtuTcpClient client{server};
+
+	auto resp1 = client.read_input_registers(7, 0x1234, 1);
+	auto resp2 = client.read_input_registers(7, 0x1235, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+
+	server.stop();
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_DISCONNECTED, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+
+	server.connect("localhost", uuid::modbus::DEFAULT_TCP_PORT);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp2->status());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(rtu_tcp_read);
+	RUN_TEST(rtu_tcp_split);
+	RUN_TEST(rtu_tcp_exception);
+	RUN_TEST(rtu_tcp_invalid_crc);
+	RUN_TEST(rtu_tcp_incomplete);
+	RUN_TEST(rtu_tcp_idle);
+	RUN_TEST(rtu_tcp_disconnect);
+
+	return UNITY_END();
+}
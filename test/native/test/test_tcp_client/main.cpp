@@ -0,0 +1,387 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <Client.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+#include <deque>
+#include <vector>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Loopback Modbus TCP server stub that holds requests from the client until
+ * the test responds to them.
+ */
+class ModbusTcpServer: public ::Client {
+public:
+	int connect(const char *host, uint16_t port) override {
+		connected_ = true;
+		return 1;
+	}
+
+	size_t write(uint8_t c) override {
+		return write(&c, 1);
+	}
+
+	size_t write(const uint8_t *buffer, size_t size) override {
+		if (!connected_) {
+			return 0;
+		}
+
+		rx_.insert(rx_.end(), buffer, buffer + size);
+
+		while (rx_.size() >= 6) {
+			size_t len = 6 + ((rx_[4] << 8) | rx_[5]);
+
+			if (rx_.size() < len) {
+				break;
+			}
+
+			requests_.emplace_back(rx_.begin(), rx_.begin() + len);
+			rx_.erase(rx_.begin(), rx_.begin() + len);
+		}
+
+		return size;
+	}
+
+	int available() override {
+		return tx_.size();
+	}
+
+	int read() override {
+		if (tx_.empty()) {
+			return -1;
+		}
+
+		int value = tx_.front();
+		tx_.pop_front();
+		return value;
+	}
+
+	int read(uint8_t *buffer, size_t size) override {
+		size = std::min(size, tx_.size());
+		std::copy(tx_.begin(), tx_.begin() + size, buffer);
+		tx_.erase(tx_.begin(), tx_.begin() + size);
+		return size;
+	}
+
+	int peek() override {
+		return tx_.empty() ? -1 : tx_.front();
+	}
+
+	void flush() override {
+	}
+
+	void stop() override {
+		connected_ = false;
+		rx_.clear();
+		tx_.clear();
+		requests_.clear();
+	}
+
+	uint8_t connected() override {
+		return connected_;
+	}
+
+	operator bool() override {
+		return connected_;
+	}
+
+	/**
+	 * Build the response to a request, reading registers that contain their
+	 * own address.
+	 */
+	std::vector<uint8_t> response(size_t index = 0) {
+		auto request = requests_[index];
+		std::vector<uint8_t> pdu;
+
+		requests_.erase(requests_.begin() + index);
+
+		if (request[7] == 0x03 || request[7] == 0x04) {
+			uint16_t address = (request[8] << 8) | request[9];
+			uint16_t size = (request[10] << 8) | request[11];
+
+			pdu.push_back(request[7]);
+			pdu.push_back(size * 2);
+
+			for (uint16_t i = 0; i < size; i++) {
+				pdu.push_back((address + i) >> 8);
+				pdu.push_back((address + i) & 0xFF);
+			}
+		} else {
+			pdu.push_back(request[7] | 0x80);
+			pdu.push_back(0x01);
+		}
+
+		std::vector<uint8_t> adu{request[0], request[1], 0x00, 0x00,
+			(uint8_t)((pdu.size() + 1) >> 8), (uint8_t)((pdu.size() + 1) & 0xFF),
+			request[6]};
+
+		adu.insert(adu.end(), pdu.begin(), pdu.end());
+		return adu;
+	}
+
+	/**
+	 * Respond to a request.
+	 */
+	void respond(size_t index = 0) {
+		auto adu = response(index);
+
+		tx_.insert(tx_.end(), adu.begin(), adu.end());
+	}
+
+	bool connected_ = true;
+	std::vector<uint8_t> rx_;
+	std::deque<uint8_t> tx_;
+	std::deque<std::vector<uint8_t>> requests_;
+};
+
+/**
+ * Requests are sent with an MBAP header and the response is matched by
+ * transaction identifier.
+ */
+void tcp_read() {
+	ModbusTcpServer server;
+	uuid::modbus::TcpClient client{server};
+
+	TEST_ASSERT_EQUAL_INT(1, client.window());
+
+	auto resp = client.read_holding_registers(7, 0x1234, 2);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_INT(1, server.requests_.size());
+
+	const std::vector<uint8_t> expected{0x00, 0x00, 0x00, 0x00, 0x00, 0x06,
+		0x07, 0x03, 0x12, 0x34, 0x00, 0x02};
+
+	TEST_ASSERT_EQUAL_INT(expected.size(), server.requests_[0].size());
+	for (size_t i = 0; i < expected.size(); i++) {
+		TEST_ASSERT_EQUAL_UINT8(expected[i], server.requests_[0][i]);
+	}
+
+	server.respond();
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(2, resp->data().size());
+	TEST_ASSERT_EQUAL_INT(0x1234, resp->data()[0]);
+	TEST_ASSERT_EQUAL_INT(0x1235, resp->data()[1]);
+
+	// Exception response
+	auto resp2 = client.write_holding_register(7, 0x1234, 0x5678);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp2->status());
+	TEST_ASSERT_EQUAL_UINT8(0x01, server.requests_[0][1]);
+
+	server.respond();
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::EXCEPTION, resp2->status());
+	TEST_ASSERT_EQUAL_INT(0x01, resp2->exception_code());
+}
+
+/**
+ * Several requests can be outstanding at the same time and responses can be
+ * received in any order.
+ */
+void tcp_pipeline() {
+	ModbusTcpServer server;
+	uuid::modbus::TcpClient client{server};
+
+	client.window(3);
+	TEST_ASSERT_EQUAL_INT(3, client.window());
+
+	auto resp1 = client.read_holding_registers(1, 0x1000, 1);
+	auto resp2 = client.read_input_registers(2, 0x2000, 1);
+	auto resp3 = client.read_holding_registers(3, 0x3000, 1);
+	auto resp4 = client.read_holding_registers(4, 0x4000, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(3, server.requests_.size());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp2->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp3->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp4->status());
+
+	// Each request has a different transaction identifier
+	TEST_ASSERT_EQUAL_UINT8(0, server.requests_[0][1]);
+	TEST_ASSERT_EQUAL_UINT8(1, server.requests_[1][1]);
+	TEST_ASSERT_EQUAL_UINT8(2, server.requests_[2][1]);
+
+	server.respond(2);
+	server.respond(0);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+	TEST_ASSERT_EQUAL_INT(0x1000, resp1->data()[0]);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp2->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp3->status());
+	TEST_ASSERT_EQUAL_INT(0x3000, resp3->data()[0]);
+
+	// The window has space for the next request
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp4->status());
+	TEST_ASSERT_EQUAL_INT(2, server.requests_.size());
+
+	server.respond(1);
+	server.respond(0);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp2->status());
+	TEST_ASSERT_EQUAL_INT(0x2000, resp2->data()[0]);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp4->status());
+	TEST_ASSERT_EQUAL_INT(0x4000, resp4->data()[0]);
+}
+
+/**
+ * Responses are received in parts.
+ */
+void tcp_partial() {
+	ModbusTcpServer server;
+	uuid::modbus::TcpClient client{server};
+
+	auto resp = client.read_input_registers(7, 0x0100, 3);
+
+	client.loop();
+
+	for (auto value : server.response()) {
+		TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+		server.tx_.push_back(value);
+		client.loop();
+	}
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_EQUAL_INT(3, resp->data().size());
+	TEST_ASSERT_EQUAL_INT(0x0102, resp->data()[2]);
+}
+
+/**
+ * Requests time out and late responses are ignored.
+ */
+void tcp_timeout() {
+	ModbusTcpServer server;
+	uuid::modbus::TcpClient client{server};
+
+	auto resp1 = client.read_holding_registers(7, 0x1000, 1, 100);
+	auto resp2 = client.read_holding_registers(7, 0x2000, 1, 100);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	TEST_ASSERT_EQUAL_INT(100000, client.next_event_us());
+
+	fake_millis += 100;
+	TEST_ASSERT_EQUAL_INT(0, client.next_event_us());
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp2->status());
+
+	// Late response to the first request
+	server.respond(0);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp2->status());
+
+	server.respond(0);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp2->status());
+	TEST_ASSERT_EQUAL_INT(0x2000, resp2->data()[0]);
+	TEST_ASSERT_EQUAL_UINT32(uuid::modbus::BaseClient::WAIT_FOR_INPUT, client.next_event_us());
+}
+
+/**
+ * Outstanding requests fail when the connection is closed, and queued
+ * requests are sent when it is connected again.
+ */
+void tcp_disconnect() {
+	ModbusTcpServer server;
+	uuid::modbus::TcpClient client{server};
+
+	auto resp1 = client.read_holding_registers(7, 0x1000, 1);
+	auto resp2 = client.read_holding_registers(7, 0x2000, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+
+	server.stop();
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_DISCONNECTED, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+
+	server.connect("localhost", uuid::modbus::DEFAULT_TCP_PORT);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp2->status());
+
+	server.respond();
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp2->status());
+}
+
+/**
+ * The connection is closed if the MBAP header is invalid.
+ */
+void tcp_invalid_header() {
+	ModbusTcpServer server;
+	uuid::modbus::TcpClient client{server};
+
+	auto resp = client.read_holding_registers(7, 0x1000, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	server.tx_.insert(server.tx_.end(), { 0x00, 0x00, 0x00, 0x01, 0x00, 0x05 });
+	client.loop();
+	TEST_ASSERT_FALSE(server.connected_);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_DISCONNECTED, resp->status());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(tcp_read);
+	RUN_TEST(tcp_pipeline);
+	RUN_TEST(tcp_partial);
+	RUN_TEST(tcp_timeout);
+	RUN_TEST(tcp_disconnect);
+	RUN_TEST(tcp_invalid_header);
+
+	return UNITY_END();
+}
@@ -0,0 +1,207 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_micros = 0;
+
+unsigned long millis() {
+	return fake_micros / 1000;
+}
+
+unsigned long micros() {
+	return fake_micros;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_micros = 0;
+}
+
+/**
+ * Timeouts when the line configuration is not known.
+ */
+void timeouts_default() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::INTER_FRAME_TIMEOUT_MS * 1000, client.inter_frame_timeout_us());
+}
+
+/**
+ * Timeouts at 9600 baud with 11 bits per character.
+ */
+void timeouts_9600_8E1() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 9600, uuid::modbus::SerialParity::EVEN, 1};
+
+	TEST_ASSERT_EQUAL_INT(1719, client.inter_character_timeout_us());
+	TEST_ASSERT_EQUAL_INT(4011, client.inter_frame_timeout_us());
+
+	client.line_config(9600, uuid::modbus::SerialParity::NONE, 2);
+	TEST_ASSERT_EQUAL_INT(1719, client.inter_character_timeout_us());
+	TEST_ASSERT_EQUAL_INT(4011, client.inter_frame_timeout_us());
+}
+
+/**
+ * Timeouts at 9600 baud with 10 bits per character.
+ */
+void timeouts_9600_8N1() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 9600, uuid::modbus::SerialParity::NONE, 1};
+
+	TEST_ASSERT_EQUAL_INT(1563, client.inter_character_timeout_us());
+	TEST_ASSERT_EQUAL_INT(3646, client.inter_frame_timeout_us());
+}
+
+/**
+ * Timeouts at 19200 baud with 11 bits per character.
+ */
+void timeouts_19200_8E1() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 19200};
+
+	TEST_ASSERT_EQUAL_INT(860, client.inter_character_timeout_us());
+	TEST_ASSERT_EQUAL_INT(2006, client.inter_frame_timeout_us());
+}
+
+/**
+ * Timeouts are fixed above 19200 baud.
+ */
+void timeouts_115200_8E1() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 115200};
+
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::MIN_INTER_CHARACTER_TIMEOUT_US, client.inter_character_timeout_us());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::MIN_INTER_FRAME_TIMEOUT_US, client.inter_frame_timeout_us());
+}
+
+/**
+ * End of an unexpected frame is detected after the inter-frame timeout.
+ */
+void frame_end_115200() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 115200};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	device.tx_.insert(device.tx_.end(), {
+		0x08, 0x04, 0x02, 0x56, 0x78, 0x5A, 0xB3 });
+
+	fake_micros += 100;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	fake_micros += uuid::modbus::MIN_INTER_FRAME_TIMEOUT_US - 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	fake_micros += 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_ADDRESS, resp->status());
+}
+
+/**
+ * Next request is transmitted after the inter-frame timeout.
+ */
+void next_request_9600() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 9600};
+
+	auto resp1 = client.read_input_registers(7, 0x1234, 1);
+	auto resp2 = client.read_input_registers(7, 0x5678, 1);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	device.rx_.clear();
+
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x04, 0x02, 0x56, 0x78, 0x0E, 0xB2 });
+
+	fake_micros += 20000;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+
+	fake_micros += 4010;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(0, device.rx_.size());
+
+	fake_micros += 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp2->status());
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+}
+
+/**
+ * Response timeouts are measured in microseconds, from the time that the
+ * request will have been transmitted.
+ */
+void response_timeout() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device, 115200};
+
+	auto resp = client.read_input_registers(7, 0x1234, 1, 100);
+
+	fake_micros = 500;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	fake_micros += 8 * client.character_time_us() + 99999;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	fake_micros += 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_TIMEOUT, resp->status());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(timeouts_default);
+	RUN_TEST(timeouts_9600_8E1);
+	RUN_TEST(timeouts_9600_8N1);
+	RUN_TEST(timeouts_19200_8E1);
+	RUN_TEST(timeouts_115200_8E1);
+
+	RUN_TEST(frame_end_115200);
+	RUN_TEST(next_request_9600);
+	RUN_TEST(response_timeout);
+
+	return UNITY_END();
+}
@@ -0,0 +1,278 @@
+/*
+ * uuid-modbus - Microcontroller Modbus library
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <uuid/modbus.h>
+
+static unsigned long fake_millis = 0;
+
+unsigned long millis() {
+	return fake_millis;
+}
+
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
+namespace uuid {
+
+uint64_t get_uptime_ms() {
+	static uint64_t millis = 0;
+	return ++millis;
+}
+
+} // namespace uuid
+
+std::vector<std::string> test_messages;
+
+void setUp() {
+	test_messages.clear();
+	fake_millis = 0;
+}
+
+/**
+ * Check that a request frame has been transmitted.
+ */
+static void check_request(ModbusDevice &device, const std::vector<int> &request) {
+	TEST_ASSERT_EQUAL_INT(request.size(), device.rx_.size());
+
+	for (size_t i = 0; i < request.size(); i++) {
+		TEST_ASSERT_EQUAL_UINT8(request[i], device.rx_[i]);
+	}
+
+	device.rx_.clear();
+}
+
+/**
+ * Writes to the same register are not combined by default.
+ */
+void write_behind_disabled() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	TEST_ASSERT_FALSE(client.write_behind());
+
+	auto resp1 = client.write_holding_register(7, 0x0010, 1);
+	auto resp2 = client.write_holding_register(7, 0x0010, 5);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+	TEST_ASSERT_EQUAL_INT(8, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x01, device.rx_[5]);
+}
+
+/**
+ * A later write to the same register replaces the value and all of the
+ * callers get the outcome of the final request.
+ */
+void write_behind_replace() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	unsigned int calls = 0;
+
+	client.write_behind(true);
+	TEST_ASSERT_TRUE(client.write_behind());
+
+	auto resp1 = client.write_holding_register(7, 0x0010, 1,
+		[&calls] (const uuid::modbus::RegisterWriteResponse &response) {
+			calls++;
+		});
+	auto resp2 = client.write_holding_register(7, 0x0010, 9,
+		[&calls] (const uuid::modbus::RegisterWriteResponse &response) {
+			calls++;
+			TEST_ASSERT_EQUAL_UINT16(0x0010, response.address());
+		});
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+
+	check_request(device, {0x07, 0x06, 0x00, 0x10, 0x00, 0x09, 0x48, 0x6F});
+
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x06, 0x00, 0x10, 0x00, 0x09, 0x48, 0x6F });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp2->status());
+	TEST_ASSERT_EQUAL_INT(2, calls);
+	TEST_ASSERT_EQUAL_UINT16(0x0010, resp1->address());
+	TEST_ASSERT_EQUAL_UINT16(0x0009, resp1->data()[0]);
+	TEST_ASSERT_EQUAL_UINT16(0x0009, resp2->data()[0]);
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(0, device.rx_.size());
+}
+
+/**
+ * Writes to adjacent registers are combined into one request.
+ */
+void write_behind_adjacent() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.write_behind(true);
+
+	auto resp1 = client.write_holding_register(7, 0x0011, 2);
+	auto resp2 = client.write_holding_register(7, 0x0012, 7);
+	auto resp3 = client.write_holding_register(7, 0x0010, 1);
+	auto resp4 = client.write_holding_register(7, 0x0012, 3);
+
+	client.loop();
+
+	check_request(device, {0x07, 0x10, 0x00, 0x10, 0x00, 0x03, 0x06,
+		0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x32, 0xD2});
+
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x10, 0x00, 0x10, 0x00, 0x03, 0x81, 0xAB });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp2->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp3->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp4->status());
+	TEST_ASSERT_EQUAL_UINT16(0x0011, resp1->address());
+	TEST_ASSERT_EQUAL_INT(1, resp1->data().size());
+	TEST_ASSERT_EQUAL_UINT16(2, resp1->data()[0]);
+	TEST_ASSERT_EQUAL_UINT16(0x0012, resp2->address());
+	TEST_ASSERT_EQUAL_INT(1, resp2->data().size());
+	TEST_ASSERT_EQUAL_UINT16(3, resp2->data()[0]);
+	TEST_ASSERT_EQUAL_UINT16(0x0010, resp3->address());
+	TEST_ASSERT_EQUAL_INT(1, resp3->data().size());
+	TEST_ASSERT_EQUAL_UINT16(1, resp3->data()[0]);
+	TEST_ASSERT_EQUAL_UINT16(0x0012, resp4->address());
+	TEST_ASSERT_EQUAL_INT(1, resp4->data().size());
+	TEST_ASSERT_EQUAL_UINT16(3, resp4->data()[0]);
+}
+
+/**
+ * Each of the combined writes reports its own register and value, not the
+ * number of registers in the response to the combined write.
+ */
+void write_behind_superseded_data() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.write_behind(true);
+
+	auto resp1 = client.write_holding_register(7, 0x0020, 0x1234);
+	auto resp2 = client.write_holding_register(7, 0x0021, 0x5678);
+
+	client.loop();
+
+	check_request(device, {0x07, 0x10, 0x00, 0x20, 0x00, 0x02, 0x04,
+		0x12, 0x34, 0x56, 0x78, 0x94, 0x0B});
+
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x10, 0x00, 0x20, 0x00, 0x02, 0x40, 0x64 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp2->status());
+	TEST_ASSERT_EQUAL_UINT16(0x0020, resp1->address());
+	TEST_ASSERT_EQUAL_INT(1, resp1->data().size());
+	TEST_ASSERT_EQUAL_UINT16(0x1234, resp1->data()[0]);
+	TEST_ASSERT_EQUAL_UINT16(0x0021, resp2->address());
+	TEST_ASSERT_EQUAL_INT(1, resp2->data().size());
+	TEST_ASSERT_EQUAL_UINT16(0x5678, resp2->data()[0]);
+}
+
+/**
+ * All of the combined writes get the same exception response.
+ */
+void write_behind_exception() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.write_behind(true);
+
+	auto resp1 = client.write_holding_register(7, 0x0010, 1);
+	auto resp2 = client.write_holding_register(7, 0x0010, 5);
+
+	client.loop();
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), { 0x07, 0x86, 0x02, 0x23, 0xA0 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::EXCEPTION, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::EXCEPTION, resp2->status());
+	TEST_ASSERT_EQUAL_INT(0x02, resp2->exception_code());
+}
+
+/**
+ * Writes are not combined with a request that has already been sent, with
+ * writes that are not the most recent request to the device or with writes
+ * to registers that are not adjacent.
+ */
+void write_behind_separate() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+
+	client.write_behind(true);
+
+	auto resp1 = client.write_holding_register(7, 0x0010, 1);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp1->status());
+	device.rx_.clear();
+
+	auto resp2 = client.write_holding_register(7, 0x0010, 5);
+	auto resp3 = client.read_holding_registers(7, 0x0010, 1);
+	auto resp4 = client.write_holding_register(7, 0x0010, 6);
+	auto resp5 = client.write_holding_register(8, 0x0010, 6);
+	auto resp6 = client.write_holding_register(8, 0x0012, 6);
+
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x06, 0x00, 0x10, 0x00, 0x01, 0x49, 0xA9 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp1->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp2->status());
+
+	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp2->status());
+	TEST_ASSERT_EQUAL_UINT8(0x05, device.rx_[5]);
+	device.rx_.clear();
+
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x06, 0x00, 0x10, 0x00, 0x05, 0x48, 0x6A });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp2->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp3->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp4->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp5->status());
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp6->status());
+}
+
+int main(int argc, char *argv[]) {
+	UNITY_BEGIN();
+
+	RUN_TEST(write_behind_disabled);
+	RUN_TEST(write_behind_replace);
+	RUN_TEST(write_behind_adjacent);
+	RUN_TEST(write_behind_superseded_data);
+	RUN_TEST(write_behind_exception);
+	RUN_TEST(write_behind_separate);
+
+	return UNITY_END();
+}
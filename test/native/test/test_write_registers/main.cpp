@@ -27,6 +27,10 @@ unsigned long millis() {
 	return fake_millis;
 }
 
+unsigned long micros() {
+	return fake_millis * 1000;
+}
+
 namespace uuid {
 
 uint64_t get_uptime_ms() {
@@ -38,6 +42,13 @@ uint64_t get_uptime_ms() {
 
 std::vector<std::string> test_messages;
 
+/**
+ * Time to transmit a request, after which the response timeout starts.
+ */
+static unsigned long transmit_ms(const uuid::modbus::SerialClient &client, size_t length) {
+	return (length * client.character_time_us() + 999) / 1000;
+}
+
 void setUp() {
 	test_messages.clear();
 	fake_millis = 0;
@@ -72,12 +83,6 @@ void write_holding_1() {
 	device.tx_.insert(device.tx_.end(), {
 		0x07, 0x06, 0x12, 0x34, 0xAB, 0xCD, 0x73, 0xBF });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -208,12 +213,6 @@ void write_exception() {
 	device.tx_.insert(device.tx_.end(), {
 		0x07, 0x86, 0x04, 0xA3, 0xA2 });
 
-	client.loop();
-	fake_millis += uuid::modbus::INTER_FRAME_TIMEOUT_MS;
-	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
-	TEST_ASSERT_TRUE(resp->pending());
-	TEST_ASSERT_FALSE(resp->done());
-
 	client.loop();
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::EXCEPTION, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -257,7 +256,7 @@ void write_holding_broadcast_device() {
 	TEST_ASSERT_EQUAL_UINT8(0xAB, device.rx_[4]);
 	TEST_ASSERT_EQUAL_UINT8(0xCD, device.rx_[5]);
 
-	TEST_ASSERT_EQUAL_INT(1000, fake_millis);
+	TEST_ASSERT_EQUAL_INT(1000 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -299,7 +298,7 @@ void write_holding_broadcast_device_explicit_delay() {
 	TEST_ASSERT_EQUAL_UINT8(0xAB, device.rx_[4]);
 	TEST_ASSERT_EQUAL_UINT8(0xCD, device.rx_[5]);
 
-	TEST_ASSERT_EQUAL_INT(100, fake_millis);
+	TEST_ASSERT_EQUAL_INT(100 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -343,7 +342,7 @@ void write_holding_broadcast_device_implicit_default_delay() {
 	TEST_ASSERT_EQUAL_UINT8(0xAB, device.rx_[4]);
 	TEST_ASSERT_EQUAL_UINT8(0xCD, device.rx_[5]);
 
-	TEST_ASSERT_EQUAL_INT(100, fake_millis);
+	TEST_ASSERT_EQUAL_INT(100 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -387,7 +386,7 @@ void write_holding_broadcast_device_explicit_default_delay() {
 	TEST_ASSERT_EQUAL_UINT8(0xAB, device.rx_[4]);
 	TEST_ASSERT_EQUAL_UINT8(0xCD, device.rx_[5]);
 
-	TEST_ASSERT_EQUAL_INT(100, fake_millis);
+	TEST_ASSERT_EQUAL_INT(100 + transmit_ms(client, 8), fake_millis);
 
 	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
 	TEST_ASSERT_FALSE(resp->pending());
@@ -413,6 +412,127 @@ void write_holding_reserved_device() {
 	TEST_ASSERT_TRUE(resp->failed());
 }
 
+/**
+ * Write 3 holding registers.
+ */
+void write_holding_multiple_3() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	const uint16_t values[] = { 0xABCD, 0xEF12, 0x3456 };
+
+	auto resp = client.write_holding_registers(7, 0x1234, values, 3);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+	TEST_ASSERT_TRUE(resp->pending());
+	TEST_ASSERT_FALSE(resp->done());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_TRUE(resp->pending());
+	TEST_ASSERT_FALSE(resp->done());
+
+	TEST_ASSERT_EQUAL_INT(15, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x07, device.rx_[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x10, device.rx_[1]);
+	TEST_ASSERT_EQUAL_UINT8(0x12, device.rx_[2]);
+	TEST_ASSERT_EQUAL_UINT8(0x34, device.rx_[3]);
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[4]);
+	TEST_ASSERT_EQUAL_UINT8(0x03, device.rx_[5]);
+	TEST_ASSERT_EQUAL_UINT8(0x06, device.rx_[6]);
+	TEST_ASSERT_EQUAL_UINT8(0xAB, device.rx_[7]);
+	TEST_ASSERT_EQUAL_UINT8(0xCD, device.rx_[8]);
+	TEST_ASSERT_EQUAL_UINT8(0xEF, device.rx_[9]);
+	TEST_ASSERT_EQUAL_UINT8(0x12, device.rx_[10]);
+	TEST_ASSERT_EQUAL_UINT8(0x34, device.rx_[11]);
+	TEST_ASSERT_EQUAL_UINT8(0x56, device.rx_[12]);
+	TEST_ASSERT_EQUAL_UINT8(0xC7, device.rx_[13]);
+	TEST_ASSERT_EQUAL_UINT8(0x30, device.rx_[14]);
+
+	device.rx_.clear();
+	device.tx_.insert(device.tx_.end(), {
+		0x07, 0x10, 0x12, 0x34, 0x00, 0x03, 0xC4, 0xD8 });
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+	TEST_ASSERT_FALSE(resp->pending());
+	TEST_ASSERT_TRUE(resp->done());
+	TEST_ASSERT_TRUE(resp->success());
+
+	TEST_ASSERT_EQUAL_INT(1, resp->data().size());
+	TEST_ASSERT_EQUAL_INT(0x1234, resp->address());
+	TEST_ASSERT_EQUAL_INT(3, resp->data()[0]);
+}
+
+/**
+ * Write the maximum number of holding registers.
+ */
+void write_holding_multiple_max() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uint16_t values[uuid::modbus::MAX_WRITE_REGISTERS];
+
+	for (uint16_t i = 0; i < uuid::modbus::MAX_WRITE_REGISTERS; i++) {
+		values[i] = 0x0101 * i;
+	}
+
+	auto resp = client.write_holding_registers(7, 0x1234, values, uuid::modbus::MAX_WRITE_REGISTERS);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_INT(9 + 2 * uuid::modbus::MAX_WRITE_REGISTERS, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[4]);
+	TEST_ASSERT_EQUAL_UINT8(uuid::modbus::MAX_WRITE_REGISTERS, device.rx_[5]);
+	TEST_ASSERT_EQUAL_UINT8(uuid::modbus::MAX_WRITE_REGISTERS * 2, device.rx_[6]);
+	TEST_ASSERT_EQUAL_UINT8(122, device.rx_[7 + 2 * 122]);
+	TEST_ASSERT_EQUAL_UINT8(122, device.rx_[8 + 2 * 122]);
+}
+
+/**
+ * Write too many holding registers.
+ */
+void write_holding_multiple_too_many() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	uint16_t values[uuid::modbus::MAX_WRITE_REGISTERS + 1] = { 0 };
+
+	auto resp = client.write_holding_registers(7, 0x1234, values, uuid::modbus::MAX_WRITE_REGISTERS + 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+	TEST_ASSERT_TRUE(resp->done());
+	TEST_ASSERT_TRUE(resp->failed());
+
+	resp = client.write_holding_registers(7, 0x1234, values, 0);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+
+	resp = client.write_holding_registers(7, 0x1234, nullptr, 1);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::FAILURE_INVALID, resp->status());
+}
+
+/**
+ * Write multiple holding registers to the broadcast device.
+ */
+void write_holding_multiple_broadcast_device() {
+	ModbusDevice device;
+	uuid::modbus::SerialClient client{device};
+	const uint16_t values[] = { 0xABCD, 0xEF12 };
+
+	auto resp = client.write_holding_registers(0, 0x1234, values, 2, 100);
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::QUEUED, resp->status());
+
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+	TEST_ASSERT_EQUAL_INT(13, device.rx_.size());
+	TEST_ASSERT_EQUAL_UINT8(0x00, device.rx_[0]);
+	TEST_ASSERT_EQUAL_UINT8(0x10, device.rx_[1]);
+
+	fake_millis += 99 + transmit_ms(client, 13);
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::WAITING, resp->status());
+
+	fake_millis += 1;
+	client.loop();
+	TEST_ASSERT_EQUAL_INT(uuid::modbus::ResponseStatus::SUCCESS, resp->status());
+}
+
 int main(int argc, char *argv[]) {
 	UNITY_BEGIN();
 
@@ -428,5 +548,10 @@ int main(int argc, char *argv[]) {
 	RUN_TEST(write_holding_broadcast_device_explicit_default_delay);
 	RUN_TEST(write_holding_reserved_device);
 
+	RUN_TEST(write_holding_multiple_3);
+	RUN_TEST(write_holding_multiple_max);
+	RUN_TEST(write_holding_multiple_too_many);
+	RUN_TEST(write_holding_multiple_broadcast_device);
+
 	return UNITY_END();
 }